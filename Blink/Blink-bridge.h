@@ -66,6 +66,7 @@ typedef void (*mosh_state_callback) (const void *context, const void *buffer, si
 #import "BlinkMenu.h"
 #import "GeoManager.h"
 #import "mosh/moshiosbridge.h"
+#import "vt_screen.h"
 
 
 #endif /* Blink_bridge_h */
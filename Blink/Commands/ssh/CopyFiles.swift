@@ -74,6 +74,14 @@ struct BlinkCopyCommand: ParsableCommand {
         help: "Copy only when source is newer than destination, considering the timestamp. This includes -p.")
   var update: Bool = false
 
+  @Flag(name: .long,
+        help: "Transfer as a single tar stream when the remote side has tar. Falls back to file by file otherwise.")
+  var tar: Bool = false
+
+  @Flag(name: [.customShort("C"), .long],
+        help: "Compress the connection.")
+  var compress: Bool = false
+
   @Argument(help: "SOURCE(s)",
             transform: { try FileLocationPath($0) })
   var source: FileLocationPath
@@ -173,6 +181,8 @@ public class BlinkCopy: NSObject {
   var stdout = OutputStream(file: thread_stdout)
   var stderr = OutputStream(file: thread_stderr)
   var command: BlinkCopyCommand!
+  // Connections whose compression follows the link, to record what suited it.
+  var adaptiveConnections: [(alias: String, client: SSHClient)] = []
 
   public func start(_ argc: Int32, argv: [String]) -> Int32 {
     // We can use the same command for different default protocols.
@@ -260,7 +270,7 @@ public class BlinkCopy: NSObject {
             .eraseToAnyPublisher()
         }
         .flatMap {
-          $1.copy(from: $0, args: copyArguments)
+          self.copy(from: $0, to: $1, args: copyArguments)
         }.eraseToAnyPublisher()
     }.sink(receiveCompletion: { completion in
       if case let .failure(error) = completion {
@@ -309,6 +319,13 @@ public class BlinkCopy: NSObject {
 
     // Run everything in its own loop...
     CFRunLoopRunInMode(.defaultMode, TimeInterval(INT_MAX), false)
+
+    for (alias, conn) in adaptiveConnections {
+      if let compression = conn.compressionRecommendation() {
+        BKHosts.setAdaptiveCompression(compression, forHost: alias)
+      }
+    }
+    adaptiveConnections = []
     
     // ...and because of that, make another run after cleanup to let hanging self-loops close.
     sourceTranslator = nil
@@ -317,6 +334,37 @@ public class BlinkCopy: NSObject {
     return rc
   }
 
+  // Trees between a local directory and a host with tar go as a single tar stream.
+  // Updates need to compare every file, so they always go file by file.
+  func copy(from source: [Translator], to dest: Translator, args: CopyArguments) -> CopyProgressInfoPublisher {
+    let fileByFile = dest.copy(from: source, args: args)
+    guard command.tar, !command.update, dest.isDirectory else {
+      return fileByFile
+    }
+
+    let tarCopy: CopyProgressInfoPublisher
+    let remote: SFTPTranslator
+    if let d = dest as? SFTPTranslator, source.allSatisfy({ $0 is BlinkFiles.Local }) {
+      remote = d
+      tarCopy = d.tarPush(source, preserve: args.preserve)
+    } else if dest is BlinkFiles.Local, let s = source.first as? SFTPTranslator,
+              source.allSatisfy({ $0 is SFTPTranslator }) {
+      remote = s
+      tarCopy = s.tarPull(source, into: dest, preserve: args.preserve)
+    } else {
+      return fileByFile
+    }
+
+    return remote.hasTar()
+      .flatMap { hasTar -> CopyProgressInfoPublisher in
+        if hasTar {
+          return tarCopy
+        }
+        print("No tar on the remote side. Copying file by file.", to: &self.stderr)
+        return fileByFile
+      }.eraseToAnyPublisher()
+  }
+
   func localTranslator(to path: String) -> AnyPublisher<Translator, Error> {
     return .just(BlinkFiles.Local())
   }
@@ -325,8 +373,9 @@ public class BlinkCopy: NSObject {
     // At the moment everything is just SSH. At some point we should have a factory.
     let sshCommand: SSHCommand
     var params = [hostPath]
-    let host: BKSSHHost
+    var host: BKSSHHost
     let config: SSHClientConfig
+    let adapts: Bool
 
     do {
       // Pass verbosity
@@ -336,6 +385,10 @@ public class BlinkCopy: NSObject {
       }
       sshCommand = try SSHCommand.parse(params)
       host = try BKConfig().bkSSHHost(sshCommand.hostAlias, extending: sshCommand.bkSSHHost())
+      if command.compress {
+        host.compression = true
+      }
+      adapts = BKHosts.applyAdaptiveCompression(to: &host, alias: sshCommand.hostAlias)
       config = try SSHClientConfigProvider.config(host: host, using: device)
     } catch {
       let message = SSHCommand.message(for: error)
@@ -344,6 +397,11 @@ public class BlinkCopy: NSObject {
 
     return SSHClient.dial(host.hostName ?? sshCommand.hostAlias, with: config)
     //return SSHPool.dial(hostName, with: config, connectionOptions: sshOptions)
+      .handleEvents(receiveOutput: { conn in
+        if adapts {
+          self.adaptiveConnections.append((sshCommand.hostAlias, conn))
+        }
+      })
       .flatMap { $0.requestSFTP() }
       .tryMap  { try SFTPTranslator(on: $0) }
       .eraseToAnyPublisher()
@@ -40,7 +40,15 @@ import SSH
 
 class SSHPool {
   static let shared = SSHPool()
-  private var controls: [SSHClientControl] = []
+  // Connections are added from their own thread and removed from the commands, so
+  // the list is only changed under the lock, and read through a copy.
+  private var _controls: [SSHClientControl] = []
+  private let controlsLock = NSLock()
+  private var controls: [SSHClientControl] {
+    controlsLock.lock()
+    defer { controlsLock.unlock() }
+    return _controls
+  }
   
   private init() {}
 
@@ -84,7 +92,7 @@ class SSHPool {
           },
           receiveValue: { conn in
             let control = SSHClientControl(for: conn, on: host, with: config, running: runLoop, exposed: exposed)
-            SSHPool.shared.controls.append(control)
+            SSHPool.shared.withControls { $0.append(control) }
             pb.send(conn)
           })
 
@@ -104,6 +112,15 @@ class SSHPool {
     shared.control(for: host, with: config)?.connection
   }
 
+  // Any open connection to the host that can be shared, independently of its configuration.
+  static func connection(for host: String, user: String?) -> SSH.SSHClient? {
+    shared.controls.first {
+      $0.exposed && $0.host == host &&
+      (user == nil || $0.config.user == user) &&
+      $0.connection?.isConnected == true
+    }?.connection
+  }
+
   private static func control(on connection: SSH.SSHClient) -> SSHClientControl? {
     shared.controls.first { $0.connection === connection }
   }
@@ -112,6 +129,12 @@ class SSHPool {
     return controls.first { $0.isConnection(for: host, with: config) }
   }
   
+  private func withControls<T>(_ change: (inout [SSHClientControl]) -> T) -> T {
+    controlsLock.lock()
+    defer { controlsLock.unlock() }
+    return change(&_controls)
+  }
+
   private func enforcePersistance(_ control: SSHClientControl) {
     print("Current channels \(control.numChannels)")
     print("\(control.localTunnels)")
@@ -251,16 +274,60 @@ extension SSHPool {
     // For now, we just stop the connection as is
     // We could use a delegate just to notify when a connection is dead, and the control could
     // take care of figuring out when the connection it contains must go.
-    guard
-      let idx = controls.firstIndex(where: { $0 === control })
-    else {
+    let removed = withControls { controls -> Bool in
+      guard
+        let idx = controls.firstIndex(where: { $0 === control })
+      else {
+        return false
+      }
+
+      // Removing references to connection to deinit.
+      // We could also handle the pool with references to the connection.
+      // But the shell or time based persistance may become more difficult.
+      controls.remove(at: idx)
+      return true
+    }
+    guard removed else {
       return
     }
-    
-    // Removing references to connection to deinit.
-    // We could also handle the pool with references to the connection.
-    // But the shell or time based persistance may become more difficult.
-    controls.remove(at: idx)
+    // Completion keeps an SFTP channel on the connection, which holds it alive.
+    if let connection = control.connection {
+      RemotePathCompleter.shared.drop(connection: connection)
+    }
+  }
+}
+
+// Stats
+extension SSHPool {
+  // Snapshot of the live connections, their channels and their counters, and their
+  // recent trace if asked. The list is copied first, as connections come and go from
+  // their own threads.
+  static func stats(withTrace: Bool = false) -> [[String: Any]] {
+    let controls = shared.controls
+    return controls.compactMap { c -> [String: Any]? in
+      guard let conn = c.connection else {
+        return nil
+      }
+      func tunnel(_ info: PortForwardInfo, open: Int, total: Int) -> [String: Any] {
+        ["localPort": info.localPort, "remotePort": info.remotePort,
+         "bindAddress": info.bindAddress, "openConnections": open, "totalConnections": total]
+      }
+      
+      var stats: [String: Any] = [
+        "host": c.host,
+        "connected": conn.isConnected,
+        "shells": c.numShells,
+        "streams": c.streams.count,
+        "socks": c.socks.count,
+        "localForwards": c.localTunnels.map { tunnel($0.key, open: $0.value.openConnections, total: $0.value.totalConnections) },
+        "remoteForwards": c.remoteTunnels.map { tunnel($0.key, open: $0.value.openConnections, total: $0.value.totalConnections) },
+        "channel": conn.stats.snapshot
+      ]
+      if withTrace {
+        stats["trace"] = conn.dumpTrace()
+      }
+      return stats
+    }
   }
 }
 
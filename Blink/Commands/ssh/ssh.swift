@@ -107,9 +107,13 @@ public func blink_ssh_main(argc: Int32, argv: Argv) -> Int32 {
     let host: BKSSHHost
     let hostName: String
     let config: SSHClientConfig
+    // Compression is adapted to the link unless the configuration or the command set it.
+    let adaptsCompression: Bool
     do {
       let commandHost = try cmd.bkSSHHost()
-      host = try BKConfig().bkSSHHost(cmd.hostAlias, extending: commandHost)
+      var configHost = try BKConfig().bkSSHHost(cmd.hostAlias, extending: commandHost)
+      adaptsCompression = BKHosts.applyAdaptiveCompression(to: &configHost, alias: cmd.hostAlias)
+      host = configHost
       hostName = host.hostName ?? cmd.hostAlias
       config = try SSHClientConfigProvider.config(host: host, using: device)
     } catch {
@@ -239,6 +243,11 @@ public func blink_ssh_main(argc: Int32, argv: Argv) -> Int32 {
 
     stream?.cancel()
 
+    if adaptsCompression,
+       let compression = self.connection?.compressionRecommendation() {
+      BKHosts.setAdaptiveCompression(compression, forHost: cmd.hostAlias)
+    }
+
     if let conn = self.connection, cmd.blocks {
       if cmd.startsSession { SSHPool.deregister(shellOn: conn) }
       forwardTunnels.forEach { SSHPool.deregister(localForward:  $0, on: conn) }
@@ -471,7 +480,8 @@ public func blink_ssh_main(argc: Int32, argv: Argv) -> Int32 {
     if constraints != nil {
       let _allIdentities = BKPubKey.all()
       for keyName in bkHost.agentForwardKeys {
-        if let signer = _allIdentities.signerWithID(keyName) {
+        if let card = _allIdentities.first(where: { $0.id == keyName }),
+           let signer = BKSignerCache.shared.signer(for: card) {
           agent.loadKey(signer, aka: keyName, constraints: constraints)
         }
       }
@@ -0,0 +1,172 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+import Foundation
+import ArgumentParser
+
+import ios_system
+
+
+struct Stats: NonStdIOCommand {
+  static var configuration = CommandConfiguration(
+    commandName: "stats",
+    abstract: "Show live performance counters for the session",
+    discussion: "Counters for the terminal and for every SSH connection. Use --watch for a live view, and --json for a snapshot to share. Use --trace to add the recent events of connections logging at debug level."
+  )
+  
+  @OptionGroup var verboseOptions: VerboseOptions
+  var io = NonStdIO.standard
+  
+  @Flag(help: "Print a JSON snapshot of the counters.")
+  var json: Bool = false
+  
+  @Flag(name: .shortAndLong, help: "Refresh the counters until interrupted.")
+  var watch: Bool = false
+  
+  @Option(name: .shortAndLong, help: "Seconds between refreshes.")
+  var interval: Double = 1
+  
+  @Flag(help: "Include the recent trace of each SSH connection. Connections only keep one when logging at debug level.")
+  var trace: Bool = false
+  
+  func run() throws {
+    let session = Unmanaged<MCPSession>.fromOpaque(thread_context).takeUnretainedValue()
+    
+    if json {
+      let data = try JSONSerialization.data(withJSONObject: snapshot(session), options: [.prettyPrinted, .sortedKeys])
+      print(String(decoding: data, as: UTF8.self))
+      return
+    }
+    
+    var previous: [String: Any]? = nil
+    repeat {
+      let current = snapshot(session)
+      if watch {
+        // Clear the screen and go home, like top.
+        print("\u{1B}[H\u{1B}[2J", terminator: "")
+      }
+      print(render(current, previous: previous))
+      previous = current
+      if watch {
+        // Interrupting the command cancels the thread here.
+        usleep(useconds_t(max(interval, 0.1) * 1_000_000))
+      }
+    } while watch
+  }
+  
+  func snapshot(_ session: MCPSession) -> [String: Any] {
+    [
+      "time": Date().timeIntervalSince1970,
+      "terminal": session.device.stats(),
+      "ssh": SSHPool.stats(withTrace: trace)
+    ]
+  }
+  
+  func render(_ current: [String: Any], previous: [String: Any]?) -> String {
+    var lines: [String] = []
+    let elapsed = (current["time"] as? Double ?? 0) - (previous?["time"] as? Double ?? 0)
+    
+    // Rate from the previous snapshot, only when watching.
+    func rate(_ value: Int, _ previousValue: Int?) -> String {
+      guard let previousValue = previousValue, elapsed > 0 else {
+        return ""
+      }
+      return " (\(bytes(Int(Double(value - previousValue) / elapsed)))/s)"
+    }
+    
+    let terminal = current["terminal"] as? [String: Any] ?? [:]
+    let previousTerminal = previous?["terminal"] as? [String: Any]
+    let view = terminal["view"] as? [String: Any] ?? [:]
+    let bytesOut = terminal["bytesOut"] as? Int ?? 0
+    lines.append("TERMINAL")
+    lines.append("  in \(bytes(terminal["bytesIn"] as? Int ?? 0))"
+                 + "  out \(bytes(bytesOut))\(rate(bytesOut, previousTerminal?["bytesOut"] as? Int))"
+                 + "  err \(bytes(terminal["bytesErr"] as? Int ?? 0))")
+    lines.append("  js evals \(view["jsEvalCount"] as? Int ?? 0)"
+                 + "  avg \(ms(view["jsEvalAverageMs"]))  max \(ms(view["jsEvalMaxMs"]))"
+                 + "  buffer \(view["jsBuffer"] as? Int ?? 0) high-water \(view["jsBufferHighWater"] as? Int ?? 0)")
+    
+    let previousConnections = previous?["ssh"] as? [[String: Any]] ?? []
+    for (idx, conn) in (current["ssh"] as? [[String: Any]] ?? []).enumerated() {
+      let channel = conn["channel"] as? [String: Any] ?? [:]
+      let previousChannel = idx < previousConnections.count ? previousConnections[idx]["channel"] as? [String: Any] : nil
+      let bytesRead = channel["bytesRead"] as? Int ?? 0
+      let bytesWritten = channel["bytesWritten"] as? Int ?? 0
+      
+      lines.append("")
+      lines.append("SSH \(conn["host"] ?? "")\((conn["connected"] as? Bool ?? false) ? "" : " (disconnected)")"
+                   + "  shells \(conn["shells"] ?? 0)  streams \(conn["streams"] ?? 0)  socks \(conn["socks"] ?? 0)")
+      lines.append("  read \(bytes(bytesRead))\(rate(bytesRead, previousChannel?["bytesRead"] as? Int))"
+                   + " in \(channel["reads"] ?? 0) (max \(bytes(channel["maxReadSize"] as? Int ?? 0)))"
+                   + "  written \(bytes(bytesWritten))\(rate(bytesWritten, previousChannel?["bytesWritten"] as? Int))"
+                   + " in \(channel["writes"] ?? 0) (max \(bytes(channel["maxWriteSize"] as? Int ?? 0)))")
+      lines.append("  stalls window \(channel["windowStalls"] ?? 0)  read \(channel["readStalls"] ?? 0)")
+      lines.append("  sftp in flight \(channel["sftpInflight"] ?? 0) (max \(channel["sftpMaxInflight"] ?? 0))"
+                   + "  rtt avg \(ms(channel["sftpAverageRTTms"]))  max \(ms(channel["sftpMaxRTTms"]))"
+                   + " over \(channel["sftpResponses"] ?? 0)")
+      for (flag, key) in [("-L", "localForwards"), ("-R", "remoteForwards")] {
+        for fwd in conn[key] as? [[String: Any]] ?? [] {
+          lines.append("  \(flag) \(fwd["localPort"] ?? 0):\(fwd["bindAddress"] ?? ""):\(fwd["remotePort"] ?? 0)"
+                       + "  open \(fwd["openConnections"] ?? 0)  total \(fwd["totalConnections"] ?? 0)")
+        }
+      }
+      if let trace = conn["trace"] as? [String] {
+        lines.append("  trace (\(trace.count) events)")
+        lines.append(contentsOf: trace.map { "    " + $0 })
+      }
+    }
+    
+    return lines.joined(separator: "\n")
+  }
+  
+  func bytes(_ count: Int) -> String {
+    ByteCountFormatter.string(fromByteCount: Int64(count), countStyle: .binary)
+  }
+  
+  func ms(_ value: Any?) -> String {
+    String(format: "%.1fms", value as? Double ?? 0)
+  }
+}
+
+@_cdecl("stats_main")
+public func stats_main(argc: Int32, argv: Argv) -> Int32 {
+  setvbuf(thread_stdin, nil, _IONBF, 0)
+  setvbuf(thread_stdout, nil, _IONBF, 0)
+  setvbuf(thread_stderr, nil, _IONBF, 0)
+
+  let io = NonStdIO.standard
+  io.out = OutputStream(file: thread_stdout)
+  io.err = OutputStream(file: thread_stderr)
+  
+  return Stats.main(Array(argv.args(count: argc)[1...]), io: io)
+}
@@ -192,7 +192,8 @@ struct Complete {
       "open": "open url of file (Experimental). 📤",
       "link-files": "link folders from Files.app (Experimental).",
       "build": "Access to Blink dev machines. ⚒ ",
-      "facecam": "Control facecam widget"
+      "facecam": "Control facecam widget",
+      "stats": "Live performance counters for the session. 📈"
     ]
     
     __commandHintsCache = result
@@ -286,6 +287,20 @@ struct Complete {
       )
     }
     
+    if ["scp", "sftp", "fcp"].contains(cmd), RemotePathCompleter.location(token.query) != nil {
+      let result = RemotePathCompleter.shared.complete(token.query).map { CompleteUtils.encode(str: $0, quote: token.quote) }
+      let hint = !token.canShowHint ? "" : _hint(kind: .file, candidates: Array(result.prefix(5)))
+
+      return (
+        kind: .file,
+        start: token.jsStart,
+        pos: token.jsPos,
+        len: token.jsLen,
+        result: _loopIndex(arr: result, n: n),
+        hint: hint.isEmpty ? "" : token.prefix + hint
+      )
+    }
+
     let kind = _completionKind(cmd)
     let result = _complete(kind: kind, input: token.query).map { CompleteUtils.encode(str: $0, quote: token.quote) }
     let hint = !token.canShowHint ? "" : _hint(kind: kind, candidates: Array(result.prefix(5)))
@@ -371,8 +386,7 @@ struct Complete {
   
   private static func _allBlinkHosts() -> [String] {
     let hosts: Set<String> = Set(
-      (BKHosts.all() ?? [])
-        .compactMap({$0 as? BKHosts})
+      (BKHosts.allHosts() ?? [])
         .compactMap({$0.host})
     )
     
@@ -40,6 +40,7 @@ extension FeatureFlags {
 //  @objc static let checkReceipt          = _enabled(for: .legacy)
   @objc static let earlyAccessFeatures   = _enabled(for: .developer, .testFlight)
 //  @objc static let earlyAccessFeatures   = _enabled(for: .legacy)
+  @objc static let screenDeltas          = _enabled(for: .developer, .testFlight)
 }
 
 struct PublishingOptions: OptionSet, CustomStringConvertible, CustomDebugStringConvertible {
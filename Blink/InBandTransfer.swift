@@ -0,0 +1,442 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+import Foundation
+import Combine
+import BlinkFiles
+
+// In-band file transfer over the terminal stream, for hosts only reachable
+// through sessions that carry nothing but the terminal, like mosh or jump chains.
+//
+// The remote peer talks in OSC sequences on its output, which never reach the renderer:
+//   ESC ] 1337 ; BlinkTransfer=<verb>;<args> BEL
+// and Blink answers with lines on the session input:
+//   #BKT <verb> <args>\n
+//
+// Download (remote to Blink):
+//   remote: send;<b64 name>;<size>    blink: ok <window>
+//   remote: data;<seq>;<z|->;<b64>    blink: ack <seq>, once written to disk.
+//   remote: end;<frames>              blink: done <bytes>
+// Upload (Blink to remote):
+//   remote: recv;<b64 name>           blink: ok <size>
+//   blink: data <seq> <z|-> <b64>     remote: ack;<seq>
+//   blink: end <frames>
+// Either side may send abort with a b64 message. Payloads are deflated when it
+// pays off, and at most <window> frames are in flight without acknowledgement.
+//
+// Anything running on the remote can print these sequences, so no transfer starts
+// until authorize allows it, and downloads never replace an existing file.
+@objc class InBandTransfer: NSObject, TermTransferDelegate {
+  static let window = 16
+  static let chunkSize = 48 * 1024
+  static let maxFrameSize = 1024 * 1024
+
+  enum Event {
+    case started(name: String, upload: Bool)
+    case finished(name: String, bytes: Int)
+    case failed(String)
+  }
+
+  let root: String
+  private let input: (Data) -> Void
+  fileprivate let queue = DispatchQueue(label: "sh.blink.transfer")
+  private var download: Download? = nil
+  private var upload: Upload? = nil
+  // A transfer is waiting for the user.
+  private var pending = false
+  var onEvent: ((Event) -> Void)? = nil
+  // Asked before every transfer, with the name and whether the remote wants to read it.
+  // The reply can come from any thread. Without it, all transfers are refused.
+  var authorize: ((_ name: String, _ upload: Bool, _ reply: @escaping (Bool) -> Void) -> Void)? = nil
+
+  // Files are created and read under root, the input receives the replies.
+  init(root: String, input: @escaping (Data) -> Void) {
+    self.root = root
+    self.input = input
+  }
+
+  @objc convenience init(device: TermDevice) {
+    self.init(root: BlinkPaths.documentsPath()) { [weak device] in device?.writeInData($0) }
+  }
+
+  func transferFrame(_ frame: Data) {
+    guard let str = String(data: frame, encoding: .utf8) else {
+      return
+    }
+    let args = str.split(separator: ";", omittingEmptySubsequences: false).map(String.init)
+    queue.async { self.receive(args) }
+  }
+
+  private func receive(_ args: [String]) {
+    do {
+      switch args[0] {
+      case "send" where args.count == 3:
+        guard download == nil && upload == nil && !pending else {
+          throw TransferError("Transfer in progress")
+        }
+        let name = try Self.fileName(args[1])
+        let size = Int(args[2]) ?? 0
+        try request(name: name, upload: false) {
+          self.download = try Download(transfer: self, name: name, size: size)
+        }
+      case "data" where args.count == 4:
+        guard let download = download, let seq = Int(args[1]) else {
+          throw TransferError("Unexpected data")
+        }
+        try download.receive(seq: seq, payload: Self.decode(flag: args[2], payload: args[3]))
+      case "end" where args.count == 2:
+        guard let download = download, let frames = Int(args[1]) else {
+          throw TransferError("Unexpected end")
+        }
+        try download.end(frames: frames)
+      case "recv" where args.count == 2:
+        guard download == nil && upload == nil && !pending else {
+          throw TransferError("Transfer in progress")
+        }
+        let name = try Self.fileName(args[1])
+        try request(name: name, upload: true) {
+          self.upload = Upload(transfer: self, name: name)
+        }
+      case "ack" where args.count == 2:
+        guard let upload = upload, let seq = Int(args[1]) else {
+          throw TransferError("Unexpected ack")
+        }
+        upload.ack(seq: seq)
+      case "abort":
+        let msg = args.count > 1 ? Data(base64Encoded: args[1]).flatMap { String(data: $0, encoding: .utf8) } : nil
+        finish(error: msg ?? "Aborted by remote", notify: false)
+      default:
+        throw TransferError("Unknown frame \(args[0])")
+      }
+    } catch {
+      finish(error: (error as? TransferError)?.msg ?? error.localizedDescription, notify: true)
+    }
+  }
+
+  private func request(name: String, upload: Bool, start: @escaping () throws -> Void) throws {
+    guard let authorize = authorize else {
+      throw TransferError("Transfers are not allowed")
+    }
+    pending = true
+    authorize(name, upload) { allowed in
+      self.queue.async {
+        // The remote may have aborted while waiting.
+        guard self.pending else {
+          return
+        }
+        self.pending = false
+        do {
+          guard allowed else {
+            throw TransferError("Transfer denied")
+          }
+          try start()
+        } catch {
+          self.finish(error: (error as? TransferError)?.msg ?? error.localizedDescription, notify: true)
+        }
+      }
+    }
+  }
+
+  fileprivate func reply(_ line: String) {
+    input("#BKT \(line)\n".data(using: .utf8)!)
+  }
+
+  // Called on the transfer queue.
+  fileprivate func finish(name: String, bytes: Int) {
+    download = nil
+    upload = nil
+    onEvent?(.finished(name: name, bytes: bytes))
+  }
+
+  fileprivate func finish(error: String, notify: Bool) {
+    download?.cancel()
+    upload?.cancel()
+    download = nil
+    upload = nil
+    pending = false
+    if notify {
+      reply("abort \(Data(error.utf8).base64EncodedString())")
+    }
+    onEvent?(.failed(error))
+  }
+
+  fileprivate func fail(_ error: Error) {
+    queue.async {
+      self.finish(error: (error as? TransferError)?.msg ?? error.localizedDescription, notify: true)
+    }
+  }
+
+  fileprivate func localTranslator() -> AnyPublisher<Translator, Error> {
+    Local().walkTo(root)
+  }
+
+  static func fileName(_ b64: String) throws -> String {
+    guard
+      let data = Data(base64Encoded: b64),
+      let name = String(data: data, encoding: .utf8).map({ ($0 as NSString).lastPathComponent }),
+      !name.isEmpty, name != ".", name != ".."
+    else {
+      throw TransferError("Invalid file name")
+    }
+    return name
+  }
+
+  // Create the file under a name that is not taken yet, adding a number if needed.
+  // O_EXCL makes sure an existing file is never truncated, even if it appears meanwhile.
+  static func createUnique(_ name: String, in root: String) throws -> String {
+    let base = (name as NSString).deletingPathExtension
+    let ext = (name as NSString).pathExtension
+    for i in 1...1000 {
+      let candidate = i == 1 ? name : ext.isEmpty ? "\(base) \(i)" : "\(base) \(i).\(ext)"
+      let fd = open((root as NSString).appendingPathComponent(candidate),
+                    O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)
+      if fd >= 0 {
+        close(fd)
+        return candidate
+      }
+      if errno != EEXIST {
+        throw TransferError("Could not create \(candidate): \(String(cString: strerror(errno)))")
+      }
+    }
+    throw TransferError("Could not create \(name)")
+  }
+
+  static func decode(flag: String, payload: String) throws -> Data {
+    guard let data = Data(base64Encoded: payload) else {
+      throw TransferError("Invalid payload")
+    }
+    if flag == "z" {
+      guard let inflated = try? (data as NSData).decompressed(using: .zlib) as Data,
+            inflated.count <= maxFrameSize else {
+        throw TransferError("Invalid compressed payload")
+      }
+      return inflated
+    }
+    return data
+  }
+
+  // Deflate only when the payload shrinks, binary data is sent as is.
+  static func encode(_ data: Data) -> (flag: String, payload: String) {
+    if let deflated = try? (data as NSData).compressed(using: .zlib) as Data,
+       deflated.count < data.count {
+      return ("z", deflated.base64EncodedString())
+    }
+    return ("-", data.base64EncodedString())
+  }
+}
+
+struct TransferError: Error {
+  let msg: String
+  init(_ msg: String) { self.msg = msg }
+}
+
+// Writes received frames in order, acknowledging each one once it is on disk.
+fileprivate class Download {
+  unowned let transfer: InBandTransfer
+  let name: String
+  let size: Int
+  var nextSeq = 0
+  var accepted = false
+  let frames = PassthroughSubject<(seq: Int, data: Data), Error>()
+  var cancellable: AnyCancellable? = nil
+
+  init(transfer: InBandTransfer, name: String, size: Int) throws {
+    let name = try InBandTransfer.createUnique(name, in: transfer.root)
+    self.transfer = transfer
+    self.name = name
+    self.size = size
+
+    var file: File? = nil
+    let frames = self.frames
+    cancellable = transfer.localTranslator()
+      .flatMap { $0.walkTo(name) }
+      .flatMap { $0.open(flags: O_WRONLY) }
+      .flatMap { [unowned self] f -> AnyPublisher<(Int, Int), Error> in
+        file = f
+        return frames
+          .buffer(size: InBandTransfer.window, prefetch: .keepFull, whenFull: .customError({ TransferError("Window exceeded") }))
+          // The buffer is holding the window once writes request from it, so the remote can start.
+          .handleEvents(receiveRequest: { _ in
+            transfer.queue.async {
+              guard !self.accepted else { return }
+              self.accepted = true
+              transfer.reply("ok \(InBandTransfer.window)")
+            }
+          })
+          .flatMap(maxPublishers: .max(1)) { frame -> AnyPublisher<(Int, Int), Error> in
+            let dd = frame.data.withUnsafeBytes { DispatchData(bytes: $0) }
+            return f.write(dd, max: dd.count).map { _ in (frame.seq, frame.data.count) }.eraseToAnyPublisher()
+          }
+          .eraseToAnyPublisher()
+      }
+      .receive(on: transfer.queue)
+      .handleEvents(receiveOutput: { [unowned transfer] (seq, _) in
+        transfer.reply("ack \(seq)")
+      })
+      .map { $0.1 }
+      .reduce(0, +)
+      .flatMap { written in
+        file!.close().map { _ in written }
+      }
+      .receive(on: transfer.queue)
+      .sink(
+        receiveCompletion: { [unowned transfer] completion in
+          if case .failure(let error) = completion {
+            transfer.fail(error)
+          }
+        },
+        receiveValue: { [unowned transfer] written in
+          guard size == 0 || written == size else {
+            return transfer.fail(TransferError("Expected \(size) bytes, received \(written)"))
+          }
+          transfer.reply("done \(written)")
+          transfer.finish(name: name, bytes: written)
+        })
+    transfer.onEvent?(.started(name: name, upload: false))
+  }
+
+  func receive(seq: Int, payload: Data) throws {
+    guard seq == nextSeq else {
+      throw TransferError("Out of order frame \(seq)")
+    }
+    nextSeq += 1
+    frames.send((seq, payload))
+  }
+
+  func end(frames count: Int) throws {
+    guard count == nextSeq else {
+      throw TransferError("Missing frames")
+    }
+    frames.send(completion: .finished)
+  }
+
+  func cancel() {
+    cancellable?.cancel()
+    cancellable = nil
+    // Do not leave partial files behind. The file was created by this download.
+    _ = unlink((transfer.root as NSString).appendingPathComponent(name))
+  }
+}
+
+// Reads the file a chunk at a time, keeping at most a window of frames unacknowledged.
+fileprivate class Upload {
+  unowned let transfer: InBandTransfer
+  let name: String
+  var file: File? = nil
+  var seq = 0
+  var inflight = 0
+  var bytes = 0
+  var reading = false
+  var eof = false
+  var cancellable: AnyCancellable? = nil
+
+  init(transfer: InBandTransfer, name: String) {
+    self.transfer = transfer
+    self.name = name
+
+    cancellable = transfer.localTranslator()
+      .flatMap { $0.walkTo(name) }
+      .flatMap { t in t.stat().zip(t.open(flags: O_RDONLY)) }
+      .receive(on: transfer.queue)
+      .sink(
+        receiveCompletion: { [unowned transfer] completion in
+          if case .failure(let error) = completion {
+            transfer.fail(error)
+          }
+        },
+        receiveValue: { [unowned self] value in
+          let (attrs, file) = value
+          self.file = file
+          let size = (attrs[.size] as? NSNumber)?.intValue ?? 0
+          self.transfer.reply("ok \(size)")
+          self.transfer.onEvent?(.started(name: name, upload: true))
+          self.readNext()
+        })
+  }
+
+  // Called on the transfer queue.
+  func readNext() {
+    guard let file = file, !reading, !eof, inflight < InBandTransfer.window else {
+      return
+    }
+    reading = true
+    cancellable = file.read(max: InBandTransfer.chunkSize)
+      .receive(on: transfer.queue)
+      .sink(
+        receiveCompletion: { [unowned transfer] completion in
+          if case .failure(let error) = completion {
+            transfer.fail(error)
+          }
+        },
+        receiveValue: { [unowned self] data in
+          self.reading = false
+          guard data.count > 0 else {
+            self.eof = true
+            self.endIfDone()
+            return
+          }
+          let frame = InBandTransfer.encode(data as AnyObject as! Data)
+          self.transfer.reply("data \(self.seq) \(frame.flag) \(frame.payload)")
+          self.seq += 1
+          self.inflight += 1
+          self.bytes += data.count
+          self.readNext()
+        })
+  }
+
+  func ack(seq: Int) {
+    inflight -= 1
+    endIfDone()
+    readNext()
+  }
+
+  func endIfDone() {
+    guard eof, inflight == 0, let file = file else {
+      return
+    }
+    self.file = nil
+    transfer.reply("end \(seq)")
+    cancellable = file.close()
+      .receive(on: transfer.queue)
+      .sink(receiveCompletion: { _ in }, receiveValue: { [unowned self] _ in
+        self.transfer.finish(name: self.name, bytes: self.bytes)
+      })
+  }
+
+  func cancel() {
+    cancellable?.cancel()
+    cancellable = nil
+    _ = file?.close()
+    file = nil
+  }
+}
@@ -0,0 +1,246 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+import Combine
+
+import BlinkConfig
+import BlinkFiles
+import SSH
+
+
+// Completes [proto:]host:path arguments with listings from an already open SSHPool
+// connection. Listings are fetched in the background, over one SFTP channel per
+// connection, and kept per host and directory for a short time, so completing while
+// typing is answered from memory. Hosts without an open connection are not dialed.
+class RemotePathCompleter {
+  static let shared = RemotePathCompleter()
+
+  struct Location {
+    // [proto:]host: as typed
+    let prefix: String
+    let hostPath: String
+    // Path after the host, up to and including the last slash.
+    let directory: String
+    let partial: String
+  }
+
+  private struct Listing {
+    let names: [String]
+    let directories: Set<String>
+    let expires: Date
+  }
+
+  // The translator holds on to the client, so channels are dropped when the pool
+  // lets go of the connection, or they would keep it open.
+  private struct Channel {
+    let client: SSH.SSHClient
+    let translator: Translator
+  }
+
+  let ttl: TimeInterval = 10
+  let maxListings = 256
+  // How long a keystroke waits for a listing that was not fetched yet.
+  let firstFetchWait: TimeInterval = 0.3
+
+  private let queue = DispatchQueue(label: "RemotePathCompleter")
+  private var listings: [String: Listing] = [:]
+  private var fetching: [String: DispatchGroup] = [:]
+  private var cancellables: [String: AnyCancellable] = [:]
+  private var channels: [ObjectIdentifier: Channel] = [:]
+
+  // Same layout FileLocationPath accepts. Local paths are left to the local completion.
+  static func location(_ query: String) -> Location? {
+    let components = query.components(separatedBy: ":")
+    guard components.count >= 2,
+          !components[0].isEmpty,
+          !components[0].contains("/") else {
+      return nil
+    }
+
+    let hostIndex = components.count == 2 ? 0 : 1
+    if hostIndex == 1 && BlinkFilesProtocols(rawValue: components[0]) == .local {
+      return nil
+    }
+    let hostPath = components[hostIndex]
+    guard !hostPath.isEmpty else {
+      return nil
+    }
+
+    let path = components[(hostIndex + 1)...].joined(separator: ":")
+    let prefix = components[...hostIndex].joined(separator: ":") + ":"
+    guard let slash = path.range(of: "/", options: .backwards) else {
+      return Location(prefix: prefix, hostPath: hostPath, directory: "", partial: path)
+    }
+
+    return Location(prefix: prefix,
+                    hostPath: hostPath,
+                    directory: String(path[..<slash.upperBound]),
+                    partial: String(path[slash.upperBound...]))
+  }
+
+  func complete(_ query: String) -> [String] {
+    guard let location = Self.location(query),
+          let client = connection(for: location.hostPath) else {
+      return []
+    }
+
+    let key = Self.key(location.hostPath, location.directory)
+    var listing = cached(key)
+    if listing == nil {
+      _ = fetch(location.directory, on: client, key: key)
+        .wait(timeout: .now() + firstFetchWait)
+      listing = cached(key)
+    }
+    guard let listing = listing else {
+      return []
+    }
+    // Answer with what we have, and refresh it for the next keystrokes.
+    if listing.expires < Date() {
+      _ = fetch(location.directory, on: client, key: key)
+    }
+
+    let matches = listing.names.filter { $0.hasPrefix(location.partial) }.sorted()
+
+    // Get the next level ready for when the slash is typed.
+    if matches.count == 1, listing.directories.contains(matches[0]) {
+      let directory = location.directory + matches[0] + "/"
+      let key = Self.key(location.hostPath, directory)
+      if cached(key) == nil {
+        _ = fetch(directory, on: client, key: key)
+      }
+    }
+
+    return matches.map { location.prefix + location.directory + $0 }
+  }
+
+  private func connection(for hostPath: String) -> SSH.SSHClient? {
+    guard let cmd = try? SSHCommand.parse([hostPath]),
+          let host = try? BKConfig().bkSSHHost(cmd.hostAlias, extending: cmd.bkSSHHost()) else {
+      return nil
+    }
+
+    return SSHPool.connection(for: host.hostName ?? cmd.hostAlias, user: host.user)
+  }
+
+  private func cached(_ key: String) -> Listing? {
+    queue.sync { listings[key] }
+  }
+
+  private func fetch(_ directory: String, on client: SSH.SSHClient, key: String) -> DispatchGroup {
+    let (group, isNew) = queue.sync { () -> (DispatchGroup, Bool) in
+      if let group = fetching[key] {
+        return (group, false)
+      }
+      let group = DispatchGroup()
+      group.enter()
+      fetching[key] = group
+      return (group, true)
+    }
+    guard isNew else {
+      return group
+    }
+
+    let listing = translator(on: client)
+      .flatMap { $0.cloneWalkTo(directory.isEmpty ? "~" : directory) }
+      .flatMap { $0.directoryFilesAndAttributes() }
+
+    let c = listing.sink(
+      receiveCompletion: { completion in
+        self.queue.async {
+          // Remember missing directories too, so we do not wait on them again.
+          if case .failure = completion, self.listings[key] == nil {
+            self.listings[key] = Listing(names: [], directories: [], expires: Date(timeIntervalSinceNow: self.ttl))
+          }
+          self.cancellables.removeValue(forKey: key)
+          self.fetching.removeValue(forKey: key)?.leave()
+        }
+      },
+      receiveValue: { filesAttributes in
+        var names: [String] = []
+        var directories = Set<String>()
+        for attrs in filesAttributes {
+          guard let name = attrs[.name] as? String, name != ".", name != ".." else {
+            continue
+          }
+          names.append(name)
+          if (attrs[.type] as? FileAttributeType) == .typeDirectory {
+            directories.insert(name)
+          }
+        }
+        let listing = Listing(names: names, directories: directories, expires: Date(timeIntervalSinceNow: self.ttl))
+
+        self.queue.async {
+          if self.listings.count >= self.maxListings {
+            self.listings.removeAll()
+          }
+          self.listings[key] = listing
+        }
+      })
+
+    queue.async {
+      // It may be done already.
+      if self.fetching[key] === group {
+        self.cancellables[key] = c
+      }
+    }
+    return group
+  }
+
+  private func translator(on client: SSH.SSHClient) -> AnyPublisher<Translator, Error> {
+    let id = ObjectIdentifier(client)
+    let channel = queue.sync { channels[id] }
+    if let channel = channel, channel.client === client {
+      return .just(channel.translator)
+    }
+
+    return client.requestSFTP()
+      .tryMap { try SFTPTranslator(on: $0) }
+      .map { t -> Translator in
+        self.queue.async {
+          self.channels[id] = Channel(client: client, translator: t)
+        }
+        return t
+      }.eraseToAnyPublisher()
+  }
+
+  // Called by the pool when the connection is not needed anymore.
+  func drop(connection client: SSH.SSHClient) {
+    queue.async {
+      self.channels.removeValue(forKey: ObjectIdentifier(client))
+    }
+  }
+
+  private static func key(_ hostPath: String, _ directory: String) -> String {
+    "\(hostPath):\(directory)"
+  }
+}
@@ -124,6 +124,8 @@ class TermController: UIViewController {
   private let _meta: SessionMeta
  
   private var _termDevice = TermDevice()
+  private lazy var _transfer = InBandTransfer(device: _termDevice)
+  private var _transfersAllowed = false
   private var _bag = Array<AnyCancellable>()
   private var _termView = TermView(frame: .zero)
   private var _proxyView = ProxyView(frame: .zero)
@@ -204,6 +206,15 @@ class TermController: UIViewController {
   public override func loadView() {
     super.loadView()
     _termDevice.delegate = self
+    _termDevice.transferDelegate = _transfer
+    _transfer.authorize = { [weak self] name, upload, reply in
+      DispatchQueue.main.async {
+        guard let self = self else {
+          return reply(false)
+        }
+        self._authorizeTransfer(name: name, upload: upload, reply: reply)
+      }
+    }
     _termDevice.attachView(_termView)
     _termView.backgroundColor = _bgColor
     _proxyView.controlledView = _termView;
@@ -211,6 +222,29 @@ class TermController: UIViewController {
     view = _proxyView
   }
   
+  // In-band transfers are started by whatever runs on the remote, so each one is
+  // confirmed, unless the user allowed them for the rest of the session.
+  private func _authorizeTransfer(name: String, upload: Bool, reply: @escaping (Bool) -> Void) {
+    if _transfersAllowed {
+      return reply(true)
+    }
+    guard view.window != nil, presentedViewController == nil else {
+      return reply(false)
+    }
+
+    let message = upload ?
+      "The remote session wants to read \"\(name)\" from Blink's files." :
+      "The remote session wants to save \"\(name)\" into Blink's files."
+    let ctrl = UIAlertController(title: "File Transfer", message: message, preferredStyle: .alert)
+    ctrl.addAction(UIAlertAction(title: "Deny", style: .cancel) { _ in reply(false) })
+    ctrl.addAction(UIAlertAction(title: "Allow Once", style: .default) { _ in reply(true) })
+    ctrl.addAction(UIAlertAction(title: "Allow for Session", style: .default) { [weak self] _ in
+      self?._transfersAllowed = true
+      reply(true)
+    })
+    present(ctrl, animated: true)
+  }
+
   public override func viewDidLoad() {
     super.viewDidLoad()
     viewIsLoaded = true
@@ -62,6 +62,14 @@
 
 @end
 
+// Receives in-band transfer frames found on the output, on the device queue.
+// The frame is the payload of a `ESC ] 1337 ; BlinkTransfer= ... BEL` sequence.
+@protocol TermTransferDelegate <NSObject>
+
+- (void)transferFrame:(NSData *)frame;
+
+@end
+
 @interface TermDevice : NSObject {
   @public struct winsize win;
 }
@@ -71,6 +79,7 @@
 @property (readonly) TermView *view;
 @property (readonly) UIView<TermInput> *input;
 @property id<TermDeviceDelegate> delegate;
+@property (nonatomic, weak) id<TermTransferDelegate> transferDelegate;
 @property (nonatomic) BOOL rawMode;
 @property (nonatomic) BOOL autoCR;
 @property (nonatomic) BOOL secureTextEntry;
@@ -94,9 +103,12 @@
 - (void)write:(NSString *)input;
 - (void)writeIn:(NSString *)input;
 - (void)writeInDirectly:(NSString *)input;
+// Ordered with streamed pastes, blocks its queue while the input is behind.
+- (void)writeInData:(NSData *)data;
 - (void)writeOut:(NSString *)output;
 - (void)writeOutLn:(NSString *)output;
 - (void)close;
+- (NSDictionary *)stats;
 
 
 @end
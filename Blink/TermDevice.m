@@ -29,7 +29,13 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+#import <stdatomic.h>
+
 #import "TermDevice.h"
+#import "TermImageCache.h"
+#import "vt_screen.h"
+
+#import "Blink-Swift.h"
 
 static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
   // Find the first UTF mark and compare with the iterator.
@@ -61,13 +67,124 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
   return 0;
 }
 
+// Sequences lifted from the output before it reaches the view.
+typedef NS_ENUM(NSInteger, ViewStreamSequence) {
+  ViewStreamSequenceTransfer,
+  ViewStreamSequenceImage,
+  ViewStreamSequenceCount,
+};
+
+static const struct {
+  const char *marker;
+  size_t length;
+  // Longer sequences are dropped.
+  NSUInteger maxLength;
+} kSequences[ViewStreamSequenceCount] = {
+  [ViewStreamSequenceTransfer] = { "\x1b]1337;BlinkTransfer=", sizeof("\x1b]1337;BlinkTransfer=") - 1, 1024 * 1024 },
+  [ViewStreamSequenceImage] = { "\x1b]1337;File=", sizeof("\x1b]1337;File=") - 1, 32 * 1024 * 1024 },
+};
+
+// Frames of the screen model are sent at most this often, changes in between
+// are coalesced.
+static const int64_t kScreenFrameInterval = 16 * NSEC_PER_MSEC;
+
+// Native screen model shared by the output streams of a device. Full-screen
+// apps are drawn from it with row deltas, instead of hterm parsing all output.
+@interface TermScreen: NSObject
+  @property TermView *view;
+@end
+
+@implementation TermScreen {
+  vt_screen *_screen;
+  vt_buffer _output;
+  vt_buffer _frame;
+  dispatch_queue_t _queue;
+  BOOL _frameScheduled;
+}
+
+- (instancetype)initWithQueue:(dispatch_queue_t)queue rows:(int)rows cols:(int)cols
+{
+  if (self = [super init]) {
+    _queue = queue;
+    _screen = vt_screen_new(rows, cols);
+  }
+  return self;
+}
+
+- (void)dealloc
+{
+  vt_screen_free(_screen);
+  vt_buffer_free(&_output);
+  vt_buffer_free(&_frame);
+}
+
+// Returns the output for the view right away, or nil if the model took it all.
+- (dispatch_data_t)feed:(dispatch_data_t)data
+{
+  const void *buffer;
+  size_t len;
+  dispatch_data_t map = dispatch_data_create_map(data, &buffer, &len);
+  BOOL wasActive = vt_screen_active(_screen);
+  
+  _output.len = 0;
+  vt_screen_feed(_screen, buffer, len, &_output);
+  [self _scheduleFrame];
+  
+  if (_output.len == 0) {
+    return nil;
+  }
+  if (!wasActive && !vt_screen_active(_screen) && _output.len == len) {
+    // Untouched output.
+    return map;
+  }
+  return dispatch_data_create(_output.bytes, _output.len, NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+}
+
+- (void)resizeRows:(int)rows cols:(int)cols
+{
+  dispatch_async(_queue, ^{
+    vt_screen_resize(_screen, rows, cols);
+    [self _scheduleFrame];
+  });
+}
+
+- (void)_scheduleFrame
+{
+  if (_frameScheduled || !vt_screen_dirty(_screen)) {
+    return;
+  }
+  _frameScheduled = YES;
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kScreenFrameInterval), _queue, ^{
+    _frameScheduled = NO;
+    _frame.len = 0;
+    vt_screen_frame(_screen, &_frame);
+    if (_frame.len) {
+      [_view write:[[NSString alloc] initWithBytes:_frame.bytes length:_frame.len encoding:NSUTF8StringEncoding]];
+    }
+  });
+}
+
+@end
+
 @interface ViewStream: NSObject
   @property TermView *view;
+  @property TermScreen *screen;
+  @property (weak) id<TermTransferDelegate> transferDelegate;
+  // Bytes read from the stream, on its queue.
+  @property (readonly) NSUInteger bytesRead;
 @end
 
 @implementation ViewStream {
   dispatch_data_t _splitChar;
   dispatch_io_t _channel;
+  // Possible start of a marker at the end of the previous read.
+  dispatch_data_t _markerTail;
+  // Sequence being received, until its BEL or ST.
+  NSMutableData *_sequence;
+  ViewStreamSequence _sequenceKind;
+  BOOL _sequenceOverflow;
+  // The sequence ended on an ESC, a '\\' may follow to complete the ST.
+  BOOL _pendingST;
 }
 
 - (instancetype) initWithQueue:(dispatch_queue_t) queue fd:(dispatch_fd_t)fd
@@ -90,6 +207,19 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
     if (!data) {
       return;
     }
+    _bytesRead += dispatch_data_get_size(data);
+
+    data = [self _extractSequences:data];
+    if (!data) {
+      return;
+    }
+    
+    if (_screen) {
+      data = [_screen feed:data];
+      if (!data) {
+        return;
+      }
+    }
 
     if (_splitChar) {
       data = dispatch_data_create_concat(_splitChar, data);
@@ -136,6 +266,127 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
   };
 }
 
+// Take the sequences the view should not parse out of the output, and return
+// the rest of it, or nil if nothing is left for the view.
+- (dispatch_data_t)_extractSequences:(dispatch_data_t)data {
+  if (_markerTail) {
+    data = dispatch_data_create_concat(_markerTail, data);
+    _markerTail = nil;
+  }
+  
+  const char *buffer;
+  size_t len;
+  data = dispatch_data_create_map(data, (const void **)&buffer, &len);
+  
+  dispatch_data_t output = dispatch_data_empty;
+  size_t pos = 0;
+  
+  if (_pendingST) {
+    _pendingST = NO;
+    if (len && buffer[0] == '\\') {
+      pos = 1;
+    }
+  }
+  
+  while (pos < len) {
+    if (_sequence) {
+      size_t end = pos;
+      while (end < len && buffer[end] != '\a' && buffer[end] != '\x1b') {
+        end++;
+      }
+      
+      if (!_sequenceOverflow) {
+        [_sequence appendBytes:buffer + pos length:end - pos];
+        if (_sequence.length > kSequences[_sequenceKind].maxLength) {
+          _sequenceOverflow = YES;
+          _sequence.length = 0;
+        }
+      }
+      
+      if (end == len) {
+        pos = len;
+        continue;
+      }
+      
+      pos = end + 1;
+      if (buffer[end] == '\x1b') {
+        if (pos == len) {
+          _pendingST = YES;
+        } else if (buffer[pos] == '\\') {
+          pos++;
+        }
+      }
+      
+      dispatch_data_t replacement = _sequenceOverflow ? nil : [self _finishSequence];
+      if (replacement) {
+        output = dispatch_data_create_concat(output, replacement);
+      }
+      _sequence = nil;
+      _sequenceOverflow = NO;
+      continue;
+    }
+    
+    const char *marker = NULL;
+    for (NSInteger kind = 0; kind < ViewStreamSequenceCount; kind++) {
+      if (kind == ViewStreamSequenceTransfer && !_transferDelegate) {
+        continue;
+      }
+      const char *found = memmem(buffer + pos, len - pos, kSequences[kind].marker, kSequences[kind].length);
+      if (found && (!marker || found < marker)) {
+        marker = found;
+        _sequenceKind = kind;
+      }
+    }
+    
+    if (marker) {
+      size_t start = marker - buffer;
+      output = dispatch_data_create_concat(output, dispatch_data_create_subrange(data, pos, start - pos));
+      _sequence = [[NSMutableData alloc] init];
+      pos = start + kSequences[_sequenceKind].length;
+      continue;
+    }
+    
+    // Hold back a trailing partial marker until the next read.
+    size_t longestLength = kSequences[ViewStreamSequenceTransfer].length;
+    size_t end = len;
+    size_t from = len - pos < longestLength ? pos : len - longestLength + 1;
+    for (const char *esc = memchr(buffer + from, '\x1b', len - from); esc;
+         esc = memchr(esc + 1, '\x1b', len - (esc + 1 - buffer))) {
+      size_t tail = len - (esc - buffer);
+      BOOL partial = NO;
+      for (NSInteger kind = 0; kind < ViewStreamSequenceCount && !partial; kind++) {
+        partial = tail < kSequences[kind].length && memcmp(esc, kSequences[kind].marker, tail) == 0;
+      }
+      if (partial) {
+        end = esc - buffer;
+        _markerTail = dispatch_data_create_subrange(data, end, len - end);
+        break;
+      }
+    }
+    output = dispatch_data_create_concat(output, dispatch_data_create_subrange(data, pos, end - pos));
+    pos = len;
+  }
+  
+  return dispatch_data_get_size(output) ? output : nil;
+}
+
+- (dispatch_data_t)_finishSequence {
+  switch (_sequenceKind) {
+    case ViewStreamSequenceTransfer:
+      [_transferDelegate transferFrame:_sequence];
+      return nil;
+    case ViewStreamSequenceImage: {
+      NSData *sequence = [[TermImageCache shared] sequenceForImageArgs:_sequence];
+      if (!sequence) {
+        return nil;
+      }
+      return dispatch_data_create(sequence.bytes, sequence.length, NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+    }
+    default:
+      return nil;
+  }
+}
+
 - (void) close {
   dispatch_io_close(_channel, DISPATCH_IO_STOP);
 }
@@ -158,9 +409,29 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
   
   ViewStream *_outStream;
   ViewStream *_errStream;
+  TermScreen *_screen;
   
   dispatch_semaphore_t _readlineSema;
   NSString *_readlineResult;
+  
+  // Written from the caller of writeInDirectly and from the paste queue.
+  _Atomic(NSUInteger) _bytesWrittenIn;
+  
+  dispatch_queue_t _pasteQueue;
+  BOOL _pasting;
+  volatile BOOL _pasteCancelled;
+}
+
+// Streamed pastes are written in chunks of this size. The pipe blocks the paste
+// queue while the session is behind, ie waiting for the SSH channel window.
+static const NSUInteger kPasteChunkSize = 16 * 1024;
+
+- (void)setTransferDelegate:(id<TermTransferDelegate>)transferDelegate
+{
+  _transferDelegate = transferDelegate;
+  dispatch_async(_queue, ^{
+    _outStream.transferDelegate = transferDelegate;
+  });
 }
 
 // Make win accesible on Swift
@@ -192,6 +463,14 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
     
     _outStream = [[ViewStream alloc] initWithQueue:_queue fd:_poutput[0]];
     _errStream = [[ViewStream alloc] initWithQueue:_queue fd:_perror[0]];
+    
+    if (FeatureFlags.screenDeltas) {
+      _screen = [[TermScreen alloc] initWithQueue:_queue rows:24 cols:80];
+      _outStream.screen = _screen;
+      _errStream.screen = _screen;
+    }
+    
+    _pasteQueue = dispatch_queue_create("blink.TermDevice.paste", NULL);
   }
   
   return self;
@@ -208,6 +487,11 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
   NSString *ctrlD = @"\x04";
 
   if (_rawMode) {
+    // Ctrl-C cancels a streamed paste instead of landing in the middle of it.
+    if (_pasting && [input isEqualToString:ctrlC]) {
+      _pasteCancelled = YES;
+      return;
+    }
     [self writeInDirectly: input];
     return;
   }
@@ -237,6 +521,7 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
 {
   NSUInteger len = [input lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
   write(_pinput[1], input.UTF8String, len);
+  atomic_fetch_add_explicit(&_bytesWrittenIn, len, memory_order_relaxed);
 }
 
 - (void)writeIn:(NSString *)input
@@ -253,6 +538,26 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
   fprintf(_stream.out, "%s\n", output.UTF8String);
 }
 
+- (NSDictionary *)stats
+{
+  __block NSUInteger bytesOut, bytesErr;
+  dispatch_sync(_queue, ^{
+    bytesOut = _outStream.bytesRead;
+    bytesErr = _errStream.bytesRead;
+  });
+  
+  NSMutableDictionary *stats = [NSMutableDictionary dictionaryWithDictionary:@{
+    @"bytesIn": @(atomic_load_explicit(&_bytesWrittenIn, memory_order_relaxed)),
+    @"bytesOut": @(bytesOut),
+    @"bytesErr": @(bytesErr),
+  }];
+  NSDictionary *viewStats = [_view stats];
+  if (viewStats) {
+    stats[@"view"] = viewStats;
+  }
+  return stats;
+}
+
 - (void)close
 {
   // Closing the Device streams. These are the main device, usually duped in Sessions.
@@ -268,9 +573,11 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
     _view.device = self;
     _outStream.view = termView;
     _errStream.view = termView;
+    _screen.view = termView;
   } else {
     _outStream.view = nil;
     _errStream.view = nil;
+    _screen.view = nil;
     _view.device = nil;
     _view = nil;
   }
@@ -447,6 +754,7 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
 
   win.ws_col = newWinSize.ws_col;
   win.ws_row = newWinSize.ws_row;
+  [_screen resizeRows:win.ws_row cols:win.ws_col];
 
   [_delegate deviceSizeChanged];
 }
@@ -466,6 +774,79 @@ static int __sizeOfIncompleteSequenceAtTheEnd(const char *buffer, size_t len) {
   [self write:data];
 }
 
+- (void)viewPasteStream:(NSString *)str bracketed:(BOOL)bracketed
+{
+  if (_pasting) {
+    return;
+  }
+  _pasting = YES;
+  _pasteCancelled = NO;
+  
+  dispatch_async(_pasteQueue, ^{
+    // Same transformations as hterm paste.
+    NSString *text = [str stringByReplacingOccurrencesOfString:@"\n" withString:@"\r"];
+    if (bracketed) {
+      NSRegularExpression *controls = [NSRegularExpression regularExpressionWithPattern:@"[\\x00-\\x07\\x0b-\\x0c\\x0e-\\x1f]" options:0 error:nil];
+      text = [controls stringByReplacingMatchesInString:text options:0 range:NSMakeRange(0, text.length) withTemplate:@""];
+      [self _writeInFully:[@"\x1b[200~" dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    
+    NSData *data = [text dataUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger offset = 0;
+    int lastPercent = 0;
+    while (offset < data.length && !_pasteCancelled) {
+      NSUInteger len = MIN(kPasteChunkSize, data.length - offset);
+      if (![self _writeInFully:[data subdataWithRange:NSMakeRange(offset, len)]]) {
+        break;
+      }
+      offset += len;
+      
+      int percent = (int)(offset * 100 / data.length);
+      if (percent != lastPercent) {
+        lastPercent = percent;
+        dispatch_async(dispatch_get_main_queue(), ^{
+          [_view setPasteProgress:percent / 100.0];
+        });
+      }
+    }
+    
+    // Always close the framing, even if cancelled.
+    if (bracketed) {
+      [self _writeInFully:[@"\x1b[201~" dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+      [_view setPasteProgress:1];
+      _pasting = NO;
+    });
+  });
+}
+
+- (void)writeInData:(NSData *)data
+{
+  dispatch_async(_pasteQueue, ^{
+    [self _writeInFully:data];
+  });
+}
+
+- (BOOL)_writeInFully:(NSData *)data
+{
+  const char *bytes = data.bytes;
+  NSUInteger offset = 0;
+  while (offset < data.length) {
+    ssize_t n = write(_pinput[1], bytes + offset, data.length - offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return NO;
+    }
+    offset += n;
+  }
+  atomic_fetch_add_explicit(&_bytesWrittenIn, data.length, memory_order_relaxed);
+  return YES;
+}
+
 - (void)viewSubmitLine:(NSString *)line {
   [self onSubmit:line];
 }
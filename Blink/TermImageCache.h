@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2018 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#import <Foundation/Foundation.h>
+#import <WebKit/WebKit.h>
+
+extern NSString * const TermImageCacheScheme;
+
+// Inline images (iTerm2 OSC 1337 File=) are decoded here instead of in hterm.
+// The output path swaps the payload for a handle, and the image is decoded on
+// a background queue and served to the WebView through the handle scheme.
+@interface TermImageCache : NSObject <WKURLSchemeHandler>
+
++ (instancetype)shared;
+
+// Takes the arguments of a File= sequence and returns the sequence to write
+// to the view in its place, or nil to drop it. Call from the output queue.
+- (NSData *)sequenceForImageArgs:(NSData *)args;
+
+@end
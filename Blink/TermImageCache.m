@@ -0,0 +1,291 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2018 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#import "TermImageCache.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <ImageIO/ImageIO.h>
+#import <UniformTypeIdentifiers/UniformTypeIdentifiers.h>
+
+NSString * const TermImageCacheScheme = @"blink-image";
+
+// Larger images are downsampled, so a decoded image never takes more than
+// kMaxPixelSize^2 * 4 bytes on the renderer.
+static const CGFloat kMaxPixelSize = 2048;
+// Encoded images kept in memory for the renderer to (re)load. Every image is also
+// written to disk, as scrollback may still point to it after it is evicted.
+static const NSUInteger kCacheCostLimit = 64 * 1024 * 1024;
+
+@interface TermImage : NSObject
+@property (readonly) NSData *data;
+@property (readonly) NSString *mimeType;
+@end
+
+@implementation TermImage
+
+- (instancetype)initWithData:(NSData *)data mimeType:(NSString *)mimeType
+{
+  if (self = [super init]) {
+    _data = data;
+    _mimeType = mimeType;
+  }
+  return self;
+}
+
+@end
+
+@implementation TermImageCache {
+  NSCache<NSString *, TermImage *> *_cache;
+  // Images being decoded, with the renderer requests waiting on them.
+  NSMutableDictionary<NSString *, NSMutableArray<id<WKURLSchemeTask>> *> *_pending;
+  dispatch_queue_t _decodeQueue;
+  // Renderer requests not stopped yet, on the main queue.
+  NSHashTable<id<WKURLSchemeTask>> *_activeTasks;
+  // Images written to disk, with their mime type.
+  NSMutableDictionary<NSString *, NSString *> *_stored;
+  NSURL *_storeURL;
+}
+
++ (instancetype)shared
+{
+  static TermImageCache *shared = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    shared = [[TermImageCache alloc] init];
+  });
+  return shared;
+}
+
+- (instancetype)init
+{
+  if (self = [super init]) {
+    _cache = [[NSCache alloc] init];
+    _cache.totalCostLimit = kCacheCostLimit;
+    _pending = [[NSMutableDictionary alloc] init];
+    _decodeQueue = dispatch_queue_create("blink.TermImageCache.decode", DISPATCH_QUEUE_CONCURRENT);
+    _activeTasks = [NSHashTable weakObjectsHashTable];
+    _stored = [[NSMutableDictionary alloc] init];
+    // Images from previous runs are not referenced anymore.
+    _storeURL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:@"TermImages" isDirectory:YES];
+    [[NSFileManager defaultManager] removeItemAtURL:_storeURL error:nil];
+    [[NSFileManager defaultManager] createDirectoryAtURL:_storeURL withIntermediateDirectories:YES attributes:nil error:nil];
+  }
+  return self;
+}
+
+- (NSData *)sequenceForImageArgs:(NSData *)args
+{
+  const char *bytes = args.bytes;
+  const char *colon = memchr(bytes, ':', args.length);
+  if (!colon) {
+    return nil;
+  }
+  NSString *params = [[NSString alloc] initWithBytes:bytes length:colon - bytes encoding:NSUTF8StringEncoding];
+  NSData *payload = [args subdataWithRange:NSMakeRange(colon - bytes + 1, args.length - (colon - bytes) - 1)];
+  
+  // Downloads stay with hterm.
+  if (![[params componentsSeparatedByString:@";"] containsObject:@"inline=1"]) {
+    NSMutableData *sequence = [[@"\x1b]1337;File=" dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+    [sequence appendData:args];
+    [sequence appendBytes:"\a" length:1];
+    return sequence;
+  }
+  
+  NSString *key = [self _keyForPayload:payload];
+  [self _decodeIfNeeded:payload key:key];
+  
+  NSString *sequence = [NSString stringWithFormat:@"\x1b]1337;BlinkImage=%@:%@://%@\a", params, TermImageCacheScheme, key];
+  return [sequence dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (NSString *)_keyForPayload:(NSData *)payload
+{
+  unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256(payload.bytes, (CC_LONG)payload.length, digest);
+  NSMutableString *key = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+  for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+    [key appendFormat:@"%02x", digest[i]];
+  }
+  return key;
+}
+
+- (void)_decodeIfNeeded:(NSData *)payload key:(NSString *)key
+{
+  @synchronized (self) {
+    if ([_cache objectForKey:key] || _pending[key]) {
+      return;
+    }
+    _pending[key] = [[NSMutableArray alloc] init];
+  }
+  
+  dispatch_async(_decodeQueue, ^{
+    NSData *data = [[NSData alloc] initWithBase64EncodedData:payload options:NSDataBase64DecodingIgnoreUnknownCharacters];
+    TermImage *image = data ? [self _imageFromData:data] : nil;
+    BOOL stored = image && [image.data writeToURL:[_storeURL URLByAppendingPathComponent:key] atomically:NO];
+    
+    NSArray<id<WKURLSchemeTask>> *tasks;
+    @synchronized (self) {
+      if (image) {
+        [_cache setObject:image forKey:key cost:image.data.length];
+      }
+      if (stored) {
+        _stored[key] = image.mimeType;
+      }
+      tasks = _pending[key];
+      [_pending removeObjectForKey:key];
+    }
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+      for (id<WKURLSchemeTask> task in tasks) {
+        [self _respondTo:task with:image];
+      }
+    });
+  });
+}
+
+- (TermImage *)_imageFromData:(NSData *)data
+{
+  CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+  if (!source) {
+    return nil;
+  }
+  
+  TermImage *image = nil;
+  NSDictionary *props = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+  CGFloat width = [props[(__bridge NSString *)kCGImagePropertyPixelWidth] doubleValue];
+  CGFloat height = [props[(__bridge NSString *)kCGImagePropertyPixelHeight] doubleValue];
+  
+  if (!props) {
+    // Not an image we can decode.
+  } else if (CGImageSourceGetCount(source) > 1 || MAX(width, height) <= kMaxPixelSize) {
+    // Small enough or animated, serve as is.
+    UTType *type = [UTType typeWithIdentifier:(__bridge NSString *)CGImageSourceGetType(source)];
+    image = [[TermImage alloc] initWithData:data mimeType:type.preferredMIMEType ?: @"application/octet-stream"];
+  } else {
+    NSDictionary *options = @{
+      (__bridge NSString *)kCGImageSourceCreateThumbnailFromImageAlways: @YES,
+      (__bridge NSString *)kCGImageSourceCreateThumbnailWithTransform: @YES,
+      (__bridge NSString *)kCGImageSourceThumbnailMaxPixelSize: @(kMaxPixelSize),
+    };
+    CGImageRef thumbnail = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+    if (thumbnail) {
+      NSMutableData *png = [[NSMutableData alloc] init];
+      CGImageDestinationRef dest = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)png, (__bridge CFStringRef)UTTypePNG.identifier, 1, NULL);
+      CGImageDestinationAddImage(dest, thumbnail, NULL);
+      if (CGImageDestinationFinalize(dest)) {
+        image = [[TermImage alloc] initWithData:png mimeType:UTTypePNG.preferredMIMEType];
+      }
+      CFRelease(dest);
+      CGImageRelease(thumbnail);
+    }
+  }
+  
+  CFRelease(source);
+  return image;
+}
+
+- (void)_respondTo:(id<WKURLSchemeTask>)task with:(TermImage *)image
+{
+  if (![_activeTasks containsObject:task]) {
+    return;
+  }
+  [_activeTasks removeObject:task];
+  
+  if (!image) {
+    [task didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotDecodeContentData userInfo:nil]];
+    return;
+  }
+  
+  NSURLResponse *response = [[NSURLResponse alloc] initWithURL:task.request.URL
+                                                      MIMEType:image.mimeType
+                                         expectedContentLength:image.data.length
+                                              textEncodingName:nil];
+  [task didReceiveResponse:response];
+  [task didReceiveData:image.data];
+  [task didFinish];
+}
+
+#pragma mark - WKURLSchemeHandler
+
+- (void)webView:(WKWebView *)webView startURLSchemeTask:(id<WKURLSchemeTask>)task
+{
+  NSString *key = task.request.URL.host;
+  [_activeTasks addObject:task];
+  
+  TermImage *image;
+  NSString *storedMimeType;
+  @synchronized (self) {
+    image = key ? [_cache objectForKey:key] : nil;
+    if (!image && key && _pending[key]) {
+      [_pending[key] addObject:task];
+      return;
+    }
+    storedMimeType = (!image && key) ? _stored[key] : nil;
+  }
+  
+  if (storedMimeType) {
+    [self _reload:key mimeType:storedMimeType for:task];
+    return;
+  }
+  
+  // Unknown images fail like a broken image.
+  [self _respondTo:task with:image];
+}
+
+// The image was evicted from memory, serve it again from disk.
+- (void)_reload:(NSString *)key mimeType:(NSString *)mimeType for:(id<WKURLSchemeTask>)task
+{
+  dispatch_async(_decodeQueue, ^{
+    NSData *data = [NSData dataWithContentsOfURL:[_storeURL URLByAppendingPathComponent:key]];
+    TermImage *image = data ? [[TermImage alloc] initWithData:data mimeType:mimeType] : nil;
+    if (image) {
+      @synchronized (self) {
+        [_cache setObject:image forKey:key cost:image.data.length];
+      }
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+      [self _respondTo:task with:image];
+    });
+  });
+}
+
+- (void)webView:(WKWebView *)webView stopURLSchemeTask:(id<WKURLSchemeTask>)task
+{
+  NSString *key = task.request.URL.host;
+  [_activeTasks removeObject:task];
+  @synchronized (self) {
+    if (key) {
+      [_pending[key] removeObject:task];
+    }
+  }
+}
+
+@end
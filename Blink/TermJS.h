@@ -61,6 +61,11 @@ NSString *term_paste(NSString *str) {
   return [NSString stringWithFormat:@"term_paste(%@);", _encodeString(str)];
 }
 
+NSString *term_bracketedPaste(void)
+{
+  return @"term_bracketedPaste();";
+}
+
 NSString *term_clear(void)
 {
   return @"term_clear();";
@@ -55,6 +55,9 @@ extern NSString * TermViewBrowserReadyNotificationKey;
 - (void)viewNotify:(NSDictionary *)data;
 - (void)viewSelectionChanged;
 - (void)viewDidReceiveBellRing;
+@optional
+// Stream a large paste to the input, framed as bracketed paste if requested.
+- (void)viewPasteStream:(NSString *)str bracketed:(BOOL)bracketed;
 
 @end
 
@@ -113,4 +116,7 @@ extern NSString * TermViewBrowserReadyNotificationKey;
 - (void)modifySelectionInDirection:(NSString *)direction granularity:(NSString *)granularity;
 
 - (void)pasteString:(NSString *)str;
+// Progress of a streamed paste, hidden once it reaches 1.
+- (void)setPasteProgress:(float)progress;
+- (NSDictionary *)stats;
 @end
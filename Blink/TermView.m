@@ -35,6 +35,7 @@
 #import "BKFont.h"
 #import "BKTheme.h"
 #import "TermJS.h"
+#import "TermImageCache.h"
 #import <AVFoundation/AVFoundation.h>
 
 #import "Blink-Swift.h"
@@ -62,11 +63,18 @@ struct winsize __winSizeFromJSON(NSDictionary *json) {
   BOOL _jsIsBusy;
   dispatch_queue_t _jsQueue;
   NSMutableString *_jsBuffer;
+  // Counters for stats. Updated on the _jsQueue.
+  NSUInteger _charsWritten;
+  NSUInteger _jsEvalCount;
+  NSTimeInterval _jsEvalTotalTime;
+  NSTimeInterval _jsEvalMaxTime;
+  NSUInteger _jsBufferHighWater;
   CGRect _currentBounds;
   UIEdgeInsets _currentAdditionalInsets;
   NSTimer *_layoutDebounceTimer;
   
   UIView *_coverView;
+  UIProgressView *_pasteProgressView;
   UIView *_parentScrollView;
   NSInteger _touchID;
   NSMutableArray *_touchesArray;
@@ -178,6 +186,7 @@ struct winsize __winSizeFromJSON(NSDictionary *json) {
   configuration.defaultWebpagePreferences.preferredContentMode = WKContentModeDesktop;
 //  configuration.limitsNavigationsToAppBoundDomains = YES;
   [configuration.userContentController addScriptMessageHandler:self name:@"interOp"];
+  [configuration setURLSchemeHandler:[TermImageCache shared] forURLScheme:TermImageCacheScheme];
 
   _webView = [[SmarterTermInput alloc] initWithFrame:[self webViewFrame] configuration:configuration];
   _webView.UIDelegate = self;
@@ -479,6 +488,8 @@ struct winsize __winSizeFromJSON(NSDictionary *json) {
 {
   dispatch_async(_jsQueue, ^{
     [_jsBuffer appendString:data];
+    _charsWritten += data.length;
+    _jsBufferHighWater = MAX(_jsBufferHighWater, _jsBuffer.length);
     
     if (_jsIsBusy) {
       return;
@@ -517,8 +528,13 @@ struct winsize __winSizeFromJSON(NSDictionary *json) {
 - (void)_evalJSScript:(NSString *)jsScript
 {
   dispatch_async(dispatch_get_main_queue(), ^{
+    NSDate *start = [NSDate date];
     [_webView evaluateJavaScript: jsScript completionHandler:^(id result, NSError *error) {
+      NSTimeInterval elapsed = -[start timeIntervalSinceNow];
       dispatch_async(_jsQueue, ^{
+        _jsEvalCount += 1;
+        _jsEvalTotalTime += elapsed;
+        _jsEvalMaxTime = MAX(_jsEvalMaxTime, elapsed);
         _jsIsBusy = NO;
         if (_jsBuffer.length > 0) {
           [self write:@""];
@@ -528,6 +544,22 @@ struct winsize __winSizeFromJSON(NSDictionary *json) {
   });
 }
 
+- (NSDictionary *)stats
+{
+  __block NSDictionary *stats;
+  dispatch_sync(_jsQueue, ^{
+    stats = @{
+      @"charsWritten": @(_charsWritten),
+      @"jsEvalCount": @(_jsEvalCount),
+      @"jsEvalAverageMs": @(_jsEvalCount == 0 ? 0 : _jsEvalTotalTime * 1000 / _jsEvalCount),
+      @"jsEvalMaxMs": @(_jsEvalMaxTime * 1000),
+      @"jsBuffer": @(_jsBuffer.length),
+      @"jsBufferHighWater": @(_jsBufferHighWater),
+    };
+  });
+  return stats;
+}
+
 //  Since TermView is a WKScriptMessageHandler, it must implement the userContentController:didReceiveScriptMessage method. This is the method that is triggered each time 'interOp' is sent a message from the JavaScript code.
 - (void)userContentController:(WKUserContentController *)userContentController
       didReceiveScriptMessage:(WKScriptMessage *)message
@@ -780,25 +812,51 @@ struct winsize __winSizeFromJSON(NSDictionary *json) {
 - (void)paste:(id)sender
 {
   NSString *str = [UIPasteboard generalPasteboard].string;
-  if (str) {
-    if (_browserView) {
-      [_browserView evaluateJavaScript:term_paste(str) completionHandler:nil];
-    } else {
-      [_webView evaluateJavaScript:term_paste(str) completionHandler:nil];
-    }
-  }
+  [self pasteString:str];
   
   [self cleanSelection];
 }
 
+// Pastes from this size on are streamed to the session input natively,
+// instead of passing the whole text through hterm in a single evaluation.
+static const NSUInteger kStreamedPasteMinLength = 16 * 1024;
+
 - (void)pasteString:(NSString *)str {
-  if (str) {
-    if (_browserView) {
-      [_browserView evaluateJavaScript:term_paste(str) completionHandler:nil];
-    } else {
-      [_webView evaluateJavaScript:term_paste(str) completionHandler:nil];
-    }
+  if (!str) {
+    return;
+  }
+  
+  if (_browserView) {
+    [_browserView evaluateJavaScript:term_paste(str) completionHandler:nil];
+    return;
+  }
+  
+  if (str.length >= kStreamedPasteMinLength && _device.rawMode &&
+      [_device respondsToSelector:@selector(viewPasteStream:bracketed:)]) {
+    // Only the framing mode comes from hterm.
+    [_webView evaluateJavaScript:term_bracketedPaste() completionHandler:^(id result, NSError *error) {
+      [_device viewPasteStream:str bracketed:[result boolValue]];
+    }];
+    return;
+  }
+  
+  [_webView evaluateJavaScript:term_paste(str) completionHandler:nil];
+}
+
+- (void)setPasteProgress:(float)progress {
+  if (progress >= 1) {
+    [_pasteProgressView removeFromSuperview];
+    _pasteProgressView = nil;
+    return;
+  }
+  
+  if (!_pasteProgressView) {
+    _pasteProgressView = [[UIProgressView alloc] initWithProgressViewStyle:UIProgressViewStyleBar];
+    _pasteProgressView.frame = CGRectMake(0, 0, self.bounds.size.width, 2);
+    _pasteProgressView.autoresizingMask = UIViewAutoresizingFlexibleWidth;
+    [self addSubview:_pasteProgressView];
   }
+  [_pasteProgressView setProgress:progress animated:NO];
 }
 
 - (NSString *)_detectFontFamilyFromContent:(NSString *)content
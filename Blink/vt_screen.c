@@ -0,0 +1,1339 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2018 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "vt_screen.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VT_MAX_PARAMS 16
+#define VT_MAX_SEQUENCE 256
+// Scrolls to replay before the renderer is repainted instead.
+#define VT_MAX_OPS 4096
+
+enum {
+  ATTR_BOLD      = 1 << 0,
+  ATTR_FAINT     = 1 << 1,
+  ATTR_ITALIC    = 1 << 2,
+  ATTR_UNDERLINE = 1 << 3,
+  ATTR_BLINK     = 1 << 4,
+  ATTR_INVERSE   = 1 << 5,
+  ATTR_INVISIBLE = 1 << 6,
+  ATTR_STRIKE    = 1 << 7,
+};
+
+// Colors are 0 for the default, the palette index + 1, or COLOR_RGB | rgb.
+#define COLOR_DEFAULT 0
+#define COLOR_RGB (1u << 24)
+
+enum { CHARSET_ASCII, CHARSET_GRAPHICS };
+
+typedef struct {
+  uint32_t fg, bg;
+  uint16_t attrs;
+} vt_pen;
+
+typedef struct {
+  uint32_t ch;
+  vt_pen pen;
+} vt_cell;
+
+typedef enum {
+  VT_GROUND,
+  VT_UTF8,
+  VT_ESC,
+  VT_CSI,
+  VT_STRING,
+  VT_STRING_ESC,
+} vt_state;
+
+typedef struct {
+  int row, col;
+  vt_pen pen;
+  bool origin;
+  int charset[2];
+  int gl;
+  bool valid;
+} vt_saved_cursor;
+
+struct vt_screen {
+  int rows, cols;
+  // The model, and what the renderer shows as of the last frame.
+  vt_cell *cells;
+  vt_cell *shown;
+  bool *dirty_rows;
+  bool *tabs;
+  
+  bool active;
+  bool dirty;
+  // The renderer contents are unknown, clear and send everything.
+  bool repaint;
+  // Scrolls to replay on the renderer before sending the rows.
+  vt_buffer ops;
+  int shown_row, shown_col;
+  bool shown_cursor_visible;
+  
+  int row, col;
+  bool wrap_pending;
+  vt_pen pen;
+  int top, bottom;
+  bool origin, autowrap, insert, cursor_visible;
+  int charset[2];
+  int gl;
+  vt_saved_cursor saved;
+  uint32_t last_ch;
+  
+  // Parser
+  vt_state state;
+  // Raw bytes of the current sequence or character, in case the renderer needs them.
+  char seq[VT_MAX_SEQUENCE];
+  size_t seq_len;
+  bool seq_invalid;
+  int params[VT_MAX_PARAMS];
+  int nparams;
+  bool colon;
+  char private_marker;
+  char intermediate;
+  uint32_t cp;
+  int utf8_left;
+  bool string_passthrough;
+};
+
+static const vt_pen default_pen = { COLOR_DEFAULT, COLOR_DEFAULT, 0 };
+
+// DEC special graphics, from 0x5f to 0x7e.
+static const uint32_t dec_graphics[] = {
+  0x0020, 0x25c6, 0x2592, 0x2409, 0x240c, 0x240d, 0x240a, 0x00b0,
+  0x00b1, 0x2424, 0x240b, 0x2518, 0x2510, 0x250c, 0x2514, 0x253c,
+  0x23ba, 0x23bb, 0x2500, 0x23bc, 0x23bd, 0x251c, 0x2524, 0x2534,
+  0x252c, 0x2502, 0x2264, 0x2265, 0x03c0, 0x2260, 0x00a3, 0x00b7,
+};
+
+#pragma mark - Buffers
+
+static void buf_append(vt_buffer *b, const void *bytes, size_t len) {
+  if (b->len + len > b->cap) {
+    size_t cap = b->cap ? b->cap : 256;
+    while (cap < b->len + len) {
+      cap *= 2;
+    }
+    b->bytes = realloc(b->bytes, cap);
+    b->cap = cap;
+  }
+  memcpy(b->bytes + b->len, bytes, len);
+  b->len += len;
+}
+
+static void buf_str(vt_buffer *b, const char *str) {
+  buf_append(b, str, strlen(str));
+}
+
+static void buf_printf(vt_buffer *b, const char *fmt, ...) {
+  char tmp[64];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(tmp, sizeof(tmp), fmt, args);
+  va_end(args);
+  if (n > 0) {
+    buf_append(b, tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+  }
+}
+
+static size_t utf8_encode(uint32_t ch, char *out) {
+  if (ch < 0x80) {
+    out[0] = ch;
+    return 1;
+  } else if (ch < 0x800) {
+    out[0] = 0xc0 | (ch >> 6);
+    out[1] = 0x80 | (ch & 0x3f);
+    return 2;
+  } else if (ch < 0x10000) {
+    out[0] = 0xe0 | (ch >> 12);
+    out[1] = 0x80 | ((ch >> 6) & 0x3f);
+    out[2] = 0x80 | (ch & 0x3f);
+    return 3;
+  }
+  out[0] = 0xf0 | (ch >> 18);
+  out[1] = 0x80 | ((ch >> 12) & 0x3f);
+  out[2] = 0x80 | ((ch >> 6) & 0x3f);
+  out[3] = 0x80 | (ch & 0x3f);
+  return 4;
+}
+
+void vt_buffer_free(vt_buffer *b) {
+  free(b->bytes);
+  b->bytes = NULL;
+  b->len = b->cap = 0;
+}
+
+#pragma mark - Cells
+
+static bool pen_eq(vt_pen a, vt_pen b) {
+  return a.fg == b.fg && a.bg == b.bg && a.attrs == b.attrs;
+}
+
+static bool cell_eq(vt_cell a, vt_cell b) {
+  return a.ch == b.ch && pen_eq(a.pen, b.pen);
+}
+
+// Erased cells keep the background of the pen (BCE).
+static vt_cell blank(vt_pen pen) {
+  vt_cell c = { ' ', { COLOR_DEFAULT, pen.bg, 0 } };
+  return c;
+}
+
+static bool is_default_blank(vt_cell c) {
+  return c.ch == ' ' && pen_eq(c.pen, default_pen);
+}
+
+// Characters the renderer is known to draw one cell wide. Anything else hands
+// the screen back, rather than risking a different idea of its width.
+static bool is_narrow(uint32_t ch) {
+  return (ch >= 0x20 && ch < 0x7f)
+    || (ch >= 0xa0 && ch < 0x300 && ch != 0xad)
+    || (ch >= 0x370 && ch < 0x500 && !(ch >= 0x483 && ch <= 0x489))
+    || (ch >= 0x2010 && ch < 0x2028)
+    || (ch >= 0x2030 && ch < 0x205f)
+    || (ch >= 0x2190 && ch < 0x2200)
+    || (ch >= 0x2500 && ch < 0x2600 && ch != 0x25fd && ch != 0x25fe)
+    || (ch >= 0x2800 && ch < 0x2900)
+    // The rest of the DEC special graphics.
+    || (ch >= 0x23ba && ch <= 0x23bd) || (ch >= 0x2409 && ch <= 0x2424)
+    || ch == 0x2260 || ch == 0x2264 || ch == 0x2265
+    || ch == 0xfffd;
+}
+
+static vt_cell *row_cells(vt_cell *cells, const vt_screen *s, int row) {
+  return cells + (size_t)row * s->cols;
+}
+
+static void touch(vt_screen *s, int row) {
+  s->dirty_rows[row] = true;
+  s->dirty = true;
+}
+
+static void fill(vt_cell *cells, size_t count, vt_cell c) {
+  for (size_t i = 0; i < count; i++) {
+    cells[i] = c;
+  }
+}
+
+static void reset_tabs(vt_screen *s) {
+  for (int i = 0; i < s->cols; i++) {
+    s->tabs[i] = i > 0 && i % 8 == 0;
+  }
+}
+
+static void reset_modes(vt_screen *s) {
+  s->pen = default_pen;
+  s->top = 0;
+  s->bottom = s->rows - 1;
+  s->origin = false;
+  s->autowrap = true;
+  s->insert = false;
+  s->cursor_visible = true;
+  s->charset[0] = s->charset[1] = CHARSET_ASCII;
+  s->gl = 0;
+  s->saved.valid = false;
+}
+
+vt_screen *vt_screen_new(int rows, int cols) {
+  vt_screen *s = calloc(1, sizeof(vt_screen));
+  s->rows = rows > 0 ? rows : 1;
+  s->cols = cols > 0 ? cols : 1;
+  s->cells = malloc(sizeof(vt_cell) * s->rows * s->cols);
+  s->shown = malloc(sizeof(vt_cell) * s->rows * s->cols);
+  s->dirty_rows = calloc(s->rows, sizeof(bool));
+  s->tabs = calloc(s->cols, sizeof(bool));
+  fill(s->cells, (size_t)s->rows * s->cols, blank(default_pen));
+  fill(s->shown, (size_t)s->rows * s->cols, blank(default_pen));
+  reset_tabs(s);
+  reset_modes(s);
+  s->shown_cursor_visible = true;
+  return s;
+}
+
+void vt_screen_free(vt_screen *s) {
+  if (!s) {
+    return;
+  }
+  free(s->cells);
+  free(s->shown);
+  free(s->dirty_rows);
+  free(s->tabs);
+  vt_buffer_free(&s->ops);
+  free(s);
+}
+
+void vt_screen_resize(vt_screen *s, int rows, int cols) {
+  if (rows < 1 || cols < 1 || (rows == s->rows && cols == s->cols)) {
+    return;
+  }
+  
+  vt_cell *cells = malloc(sizeof(vt_cell) * rows * cols);
+  fill(cells, (size_t)rows * cols, blank(default_pen));
+  for (int r = 0; r < rows && r < s->rows; r++) {
+    memcpy(cells + (size_t)r * cols, row_cells(s->cells, s, r), sizeof(vt_cell) * (cols < s->cols ? cols : s->cols));
+  }
+  free(s->cells);
+  free(s->shown);
+  free(s->dirty_rows);
+  free(s->tabs);
+  s->cells = cells;
+  s->shown = malloc(sizeof(vt_cell) * rows * cols);
+  s->dirty_rows = calloc(rows, sizeof(bool));
+  s->tabs = calloc(cols, sizeof(bool));
+  s->rows = rows;
+  s->cols = cols;
+  reset_tabs(s);
+  
+  // Like the renderer, margins are reset on resize.
+  s->top = 0;
+  s->bottom = rows - 1;
+  s->row = s->row < rows ? s->row : rows - 1;
+  s->col = s->col < cols ? s->col : cols - 1;
+  s->wrap_pending = false;
+  
+  // The app redraws after the resize, repaint it all from the model.
+  s->repaint = true;
+  s->ops.len = 0;
+  s->dirty = s->active;
+}
+
+#pragma mark - Screen operations
+
+// Scrolls the rows in [top, bottom] up by n, or down if negative.
+static void scroll_cells(vt_cell *cells, int cols, int top, int bottom, int n, vt_cell c) {
+  int height = bottom - top + 1;
+  int count = abs(n) < height ? abs(n) : height;
+  size_t moved = (size_t)(height - count) * cols;
+  if (n > 0) {
+    memmove(cells + (size_t)top * cols, cells + (size_t)(top + count) * cols, moved * sizeof(vt_cell));
+    fill(cells + (size_t)(bottom - count + 1) * cols, (size_t)count * cols, c);
+  } else {
+    memmove(cells + (size_t)(top + count) * cols, cells + (size_t)top * cols, moved * sizeof(vt_cell));
+    fill(cells + (size_t)top * cols, (size_t)count * cols, c);
+  }
+}
+
+static void scroll_flags(bool *flags, int top, int bottom, int n) {
+  int height = bottom - top + 1;
+  int count = abs(n) < height ? abs(n) : height;
+  if (n > 0) {
+    memmove(flags + top, flags + top + count, (height - count) * sizeof(bool));
+    memset(flags + bottom - count + 1, true, count * sizeof(bool));
+  } else {
+    memmove(flags + top + count, flags + top, (height - count) * sizeof(bool));
+    memset(flags + top, true, count * sizeof(bool));
+  }
+}
+
+static void scroll(vt_screen *s, int top, int bottom, int n) {
+  if (n == 0 || top > bottom) {
+    return;
+  }
+  scroll_cells(s->cells, s->cols, top, bottom, n, blank(s->pen));
+  s->dirty = true;
+  
+  // Nothing is left to move when the whole region scrolls away, and a one row
+  // region is not valid for the renderer.
+  int height = bottom - top + 1;
+  int count = abs(n) < height ? abs(n) : height;
+  if (s->repaint || count == height) {
+    for (int r = top; r <= bottom; r++) {
+      s->dirty_rows[r] = true;
+    }
+    return;
+  }
+  
+  // The renderer scrolls too, so only the new rows have to be sent.
+  scroll_cells(s->shown, s->cols, top, bottom, n, blank(default_pen));
+  scroll_flags(s->dirty_rows, top, bottom, n);
+  buf_printf(&s->ops, "\x1b[%d;%dr\x1b[%d%c", top + 1, bottom + 1, count, n > 0 ? 'S' : 'T');
+  if (s->ops.len > VT_MAX_OPS) {
+    s->repaint = true;
+  }
+}
+
+static void index_down(vt_screen *s) {
+  if (s->row == s->bottom) {
+    scroll(s, s->top, s->bottom, 1);
+  } else if (s->row < s->rows - 1) {
+    s->row++;
+  }
+}
+
+static void reverse_index(vt_screen *s) {
+  if (s->row == s->top) {
+    scroll(s, s->top, s->bottom, -1);
+  } else if (s->row > 0) {
+    s->row--;
+  }
+}
+
+static void put_char(vt_screen *s, uint32_t ch) {
+  if (s->charset[s->gl] == CHARSET_GRAPHICS && ch >= 0x5f && ch <= 0x7e) {
+    ch = dec_graphics[ch - 0x5f];
+  }
+  
+  if (s->wrap_pending) {
+    s->wrap_pending = false;
+    if (s->autowrap) {
+      s->col = 0;
+      index_down(s);
+    }
+  }
+  
+  vt_cell *row = row_cells(s->cells, s, s->row);
+  if (s->insert && s->col < s->cols - 1) {
+    memmove(row + s->col + 1, row + s->col, (s->cols - s->col - 1) * sizeof(vt_cell));
+  }
+  row[s->col].ch = ch;
+  row[s->col].pen = s->pen;
+  touch(s, s->row);
+  s->last_ch = ch;
+  
+  if (s->col == s->cols - 1) {
+    s->wrap_pending = s->autowrap;
+  } else {
+    s->col++;
+  }
+}
+
+static void erase(vt_screen *s, int row, int from, int to) {
+  if (from >= to) {
+    return;
+  }
+  fill(row_cells(s->cells, s, row) + from, to - from, blank(s->pen));
+  touch(s, row);
+}
+
+static void move_to(vt_screen *s, int row, int col) {
+  int min = s->origin ? s->top : 0;
+  int max = s->origin ? s->bottom : s->rows - 1;
+  row += min;
+  s->row = row < min ? min : row > max ? max : row;
+  s->col = col < 0 ? 0 : col >= s->cols ? s->cols - 1 : col;
+  s->wrap_pending = false;
+}
+
+// Relative moves stop at the margins when the cursor is inside them.
+static void move_rows(vt_screen *s, int n) {
+  int min = s->row >= s->top ? s->top : 0;
+  int max = s->row <= s->bottom ? s->bottom : s->rows - 1;
+  int row = s->row + n;
+  s->row = row < min ? min : row > max ? max : row;
+  s->wrap_pending = false;
+}
+
+static void move_cols(vt_screen *s, int n) {
+  int col = s->col + n;
+  s->col = col < 0 ? 0 : col >= s->cols ? s->cols - 1 : col;
+  s->wrap_pending = false;
+}
+
+static void tab(vt_screen *s, int n) {
+  while (n > 0 && s->col < s->cols - 1) {
+    s->col++;
+    if (s->tabs[s->col]) {
+      n--;
+    }
+  }
+  while (n < 0 && s->col > 0) {
+    s->col--;
+    if (s->tabs[s->col]) {
+      n++;
+    }
+  }
+  s->wrap_pending = false;
+}
+
+static void save_cursor(vt_screen *s) {
+  s->saved = (vt_saved_cursor){ s->row, s->col, s->pen, s->origin, { s->charset[0], s->charset[1] }, s->gl, true };
+}
+
+static void restore_cursor(vt_screen *s) {
+  vt_saved_cursor saved = s->saved;
+  if (!saved.valid) {
+    saved = (vt_saved_cursor){ 0, 0, default_pen, false, { CHARSET_ASCII, CHARSET_ASCII }, 0, true };
+  }
+  s->row = saved.row < s->rows ? saved.row : s->rows - 1;
+  s->col = saved.col < s->cols ? saved.col : s->cols - 1;
+  s->pen = saved.pen;
+  s->origin = saved.origin;
+  s->charset[0] = saved.charset[0];
+  s->charset[1] = saved.charset[1];
+  s->gl = saved.gl;
+  s->wrap_pending = false;
+}
+
+static void activate(vt_screen *s) {
+  s->active = true;
+  s->repaint = true;
+  s->dirty = true;
+  fill(s->cells, (size_t)s->rows * s->cols, blank(default_pen));
+  memset(s->dirty_rows, false, s->rows * sizeof(bool));
+  s->ops.len = 0;
+  s->row = s->col = 0;
+  s->wrap_pending = false;
+  s->shown_cursor_visible = s->cursor_visible;
+}
+
+#pragma mark - Renderer output
+
+static void emit_color(vt_buffer *out, uint32_t color, int base) {
+  if (color == COLOR_DEFAULT) {
+    return;
+  }
+  if (color & COLOR_RGB) {
+    buf_printf(out, ";%d;2;%d;%d;%d", base + 8, (color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff);
+    return;
+  }
+  int index = color - 1;
+  if (index < 8) {
+    buf_printf(out, ";%d", base + index);
+  } else if (index < 16) {
+    buf_printf(out, ";%d", base + 60 + index - 8);
+  } else {
+    buf_printf(out, ";%d;5;%d", base + 8, index);
+  }
+}
+
+static void emit_pen(vt_buffer *out, vt_pen pen) {
+  static const struct { uint16_t attr; const char *code; } codes[] = {
+    { ATTR_BOLD, ";1" }, { ATTR_FAINT, ";2" }, { ATTR_ITALIC, ";3" }, { ATTR_UNDERLINE, ";4" },
+    { ATTR_BLINK, ";5" }, { ATTR_INVERSE, ";7" }, { ATTR_INVISIBLE, ";8" }, { ATTR_STRIKE, ";9" },
+  };
+  buf_str(out, "\x1b[0");
+  for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++) {
+    if (pen.attrs & codes[i].attr) {
+      buf_str(out, codes[i].code);
+    }
+  }
+  emit_color(out, pen.fg, 30);
+  emit_color(out, pen.bg, 40);
+  buf_str(out, "m");
+}
+
+bool vt_screen_active(const vt_screen *s) {
+  return s->active;
+}
+
+bool vt_screen_dirty(const vt_screen *s) {
+  return s->active && (s->dirty || s->row != s->shown_row || s->col != s->shown_col
+                       || s->cursor_visible != s->shown_cursor_visible);
+}
+
+void vt_screen_frame(vt_screen *s, vt_buffer *out) {
+  if (!vt_screen_dirty(s)) {
+    return;
+  }
+  
+  bool moved = false;
+  if (s->repaint) {
+    // Put the renderer in the state the frames are written for.
+    buf_str(out, "\x1b[0m\x1b[r\x1b[?6l\x1b[?7h\x1b[4l\x0f\x1b(B\x1b)B\x1b[H\x1b[2J");
+    fill(s->shown, (size_t)s->rows * s->cols, blank(default_pen));
+    memset(s->dirty_rows, true, s->rows * sizeof(bool));
+    s->ops.len = 0;
+    s->repaint = false;
+    moved = true;
+  } else if (s->ops.len) {
+    buf_str(out, "\x1b[0m");
+    buf_append(out, s->ops.bytes, s->ops.len);
+    buf_str(out, "\x1b[r");
+    s->ops.len = 0;
+    moved = true;
+  }
+  
+  bool pen_known = false;
+  vt_pen pen = default_pen;
+  char utf8[4];
+  for (int r = 0; r < s->rows; r++) {
+    if (!s->dirty_rows[r]) {
+      continue;
+    }
+    s->dirty_rows[r] = false;
+    
+    vt_cell *model = row_cells(s->cells, s, r);
+    vt_cell *shown = row_cells(s->shown, s, r);
+    int first = 0;
+    while (first < s->cols && cell_eq(model[first], shown[first])) {
+      first++;
+    }
+    if (first == s->cols) {
+      continue;
+    }
+    int last = s->cols - 1;
+    while (last > first && cell_eq(model[last], shown[last])) {
+      last--;
+    }
+    int tail = s->cols - 1;
+    while (tail >= 0 && is_default_blank(model[tail])) {
+      tail--;
+    }
+    
+    buf_printf(out, "\x1b[%d;%dH", r + 1, first + 1);
+    moved = true;
+    int end = last > tail ? tail : last;
+    for (int c = first; c <= end; c++) {
+      if (!pen_known || !pen_eq(pen, model[c].pen)) {
+        emit_pen(out, model[c].pen);
+        pen = model[c].pen;
+        pen_known = true;
+      }
+      buf_append(out, utf8, utf8_encode(model[c].ch, utf8));
+    }
+    if (last > tail) {
+      // Clear the blank end of the row instead of writing it.
+      if (!pen_known || !pen_eq(pen, default_pen)) {
+        buf_str(out, "\x1b[0m");
+        pen = default_pen;
+        pen_known = true;
+      }
+      buf_str(out, "\x1b[K");
+    }
+    memcpy(shown, model, s->cols * sizeof(vt_cell));
+  }
+  
+  if (moved || s->row != s->shown_row || s->col != s->shown_col) {
+    buf_printf(out, "\x1b[%d;%dH", s->row + 1, s->col + 1);
+    s->shown_row = s->row;
+    s->shown_col = s->col;
+  }
+  if (s->cursor_visible != s->shown_cursor_visible) {
+    buf_str(out, s->cursor_visible ? "\x1b[?25h" : "\x1b[?25l");
+    s->shown_cursor_visible = s->cursor_visible;
+  }
+  s->dirty = false;
+}
+
+// Sends the pending frame and gives the renderer back the state the output
+// after this point expects.
+static void release(vt_screen *s, vt_buffer *out) {
+  s->dirty = true;
+  vt_screen_frame(s, out);
+  
+  if (s->top != 0 || s->bottom != s->rows - 1) {
+    buf_printf(out, "\x1b[%d;%dr", s->top + 1, s->bottom + 1);
+  }
+  if (s->origin) {
+    buf_str(out, "\x1b[?6h");
+  }
+  if (!s->autowrap) {
+    buf_str(out, "\x1b[?7l");
+  }
+  if (s->insert) {
+    buf_str(out, "\x1b[4h");
+  }
+  if (s->charset[0] == CHARSET_GRAPHICS) {
+    buf_str(out, "\x1b(0");
+  }
+  if (s->charset[1] == CHARSET_GRAPHICS) {
+    buf_str(out, "\x1b)0");
+  }
+  if (s->gl) {
+    buf_str(out, "\x0e");
+  }
+  buf_printf(out, "\x1b[%d;%dH", s->row - (s->origin ? s->top : 0) + 1, s->col + 1);
+  emit_pen(out, s->pen);
+  
+  s->active = false;
+}
+
+// The model does not cover the current sequence, the renderer takes over from it.
+static void hand_over(vt_screen *s, vt_buffer *out) {
+  release(s, out);
+  buf_append(out, s->seq, s->seq_len);
+}
+
+// The renderer must see the current sequence, after what came before it.
+static void pass(vt_screen *s, vt_buffer *out) {
+  vt_screen_frame(s, out);
+  buf_append(out, s->seq, s->seq_len);
+}
+
+#pragma mark - Sequences
+
+static int param(const vt_screen *s, int i, int def) {
+  return i < s->nparams && s->params[i] >= 0 ? s->params[i] : def;
+}
+
+// Counts where 0 means 1.
+static int count_param(const vt_screen *s, int i) {
+  int n = param(s, i, 1);
+  return n ? n : 1;
+}
+
+static bool apply_sgr(vt_pen *pen, const vt_screen *s) {
+  vt_pen p = *pen;
+  int n = s->nparams ? s->nparams : 1;
+  for (int i = 0; i < n; i++) {
+    int v = param(s, i, 0);
+    switch (v) {
+      case 0: p = default_pen; break;
+      case 1: p.attrs |= ATTR_BOLD; break;
+      case 2: p.attrs |= ATTR_FAINT; break;
+      case 3: p.attrs |= ATTR_ITALIC; break;
+      case 4: case 21: p.attrs |= ATTR_UNDERLINE; break;
+      case 5: case 6: p.attrs |= ATTR_BLINK; break;
+      case 7: p.attrs |= ATTR_INVERSE; break;
+      case 8: p.attrs |= ATTR_INVISIBLE; break;
+      case 9: p.attrs |= ATTR_STRIKE; break;
+      case 22: p.attrs &= ~(ATTR_BOLD | ATTR_FAINT); break;
+      case 23: p.attrs &= ~ATTR_ITALIC; break;
+      case 24: p.attrs &= ~ATTR_UNDERLINE; break;
+      case 25: p.attrs &= ~ATTR_BLINK; break;
+      case 27: p.attrs &= ~ATTR_INVERSE; break;
+      case 28: p.attrs &= ~ATTR_INVISIBLE; break;
+      case 29: p.attrs &= ~ATTR_STRIKE; break;
+      case 39: p.fg = COLOR_DEFAULT; break;
+      case 49: p.bg = COLOR_DEFAULT; break;
+      case 38:
+      case 48: {
+        uint32_t color;
+        int mode = param(s, i + 1, -1);
+        if (mode == 5 && i + 2 < n && param(s, i + 2, 0) < 256) {
+          color = param(s, i + 2, 0) + 1;
+          i += 2;
+        } else if (mode == 2 && i + 4 < n) {
+          int r = param(s, i + 2, 0), g = param(s, i + 3, 0), b = param(s, i + 4, 0);
+          if (r > 255 || g > 255 || b > 255) {
+            return false;
+          }
+          color = COLOR_RGB | (r << 16) | (g << 8) | b;
+          i += 4;
+        } else {
+          return false;
+        }
+        if (v == 38) {
+          p.fg = color;
+        } else {
+          p.bg = color;
+        }
+        break;
+      }
+      default:
+        if (v >= 30 && v <= 37) {
+          p.fg = v - 30 + 1;
+        } else if (v >= 40 && v <= 47) {
+          p.bg = v - 40 + 1;
+        } else if (v >= 90 && v <= 97) {
+          p.fg = v - 90 + 8 + 1;
+        } else if (v >= 100 && v <= 107) {
+          p.bg = v - 100 + 8 + 1;
+        } else {
+          return false;
+        }
+    }
+  }
+  *pen = p;
+  return true;
+}
+
+static void set_margins(vt_screen *s) {
+  int top = param(s, 0, 1);
+  int bottom = param(s, 1, s->rows);
+  top = top ? top : 1;
+  bottom = bottom && bottom <= s->rows ? bottom : s->rows;
+  if (top < bottom) {
+    s->top = top - 1;
+    s->bottom = bottom - 1;
+  }
+}
+
+static bool is_alternate_screen(int mode) {
+  return mode == 1049 || mode == 1047 || mode == 47;
+}
+
+// Output outside of the model only updates the modes the model inherits.
+static void track_csi(vt_screen *s, char final) {
+  if (s->private_marker == '?' && !s->intermediate && (final == 'h' || final == 'l')) {
+    bool set = final == 'h';
+    bool enter = false;
+    for (int i = 0; i < s->nparams; i++) {
+      int mode = param(s, i, 0);
+      if (mode == 6) {
+        s->origin = set;
+      } else if (mode == 7) {
+        s->autowrap = set;
+      } else if (mode == 25) {
+        s->cursor_visible = set;
+      } else if (is_alternate_screen(mode) && set) {
+        enter = true;
+      }
+    }
+    if (enter) {
+      activate(s);
+    }
+    return;
+  }
+  if (s->private_marker || s->intermediate) {
+    if (s->intermediate == '!' && final == 'p') {
+      reset_modes(s);
+    }
+    return;
+  }
+  
+  switch (final) {
+    case 'm':
+      if (!s->colon) {
+        apply_sgr(&s->pen, s);
+      }
+      break;
+    case 'r':
+      set_margins(s);
+      break;
+    case 'h':
+    case 'l':
+      if (param(s, 0, 0) == 4) {
+        s->insert = final == 'h';
+      }
+      break;
+  }
+}
+
+static void private_modes(vt_screen *s, bool set, vt_buffer *out) {
+  char rest[VT_MAX_SEQUENCE];
+  size_t rest_len = 0;
+  int exit = 0;
+  
+  for (int i = 0; i < s->nparams; i++) {
+    int mode = param(s, i, 0);
+    switch (mode) {
+      case 6:
+        s->origin = set;
+        move_to(s, 0, 0);
+        break;
+      case 7:
+        s->autowrap = set;
+        s->wrap_pending = s->wrap_pending && set;
+        break;
+      case 25:
+        s->cursor_visible = set;
+        break;
+      case 1048:
+        set ? save_cursor(s) : restore_cursor(s);
+        break;
+      default:
+        if (is_alternate_screen(mode)) {
+          exit = set ? 0 : mode;
+        } else {
+          rest_len += snprintf(rest + rest_len, sizeof(rest) - rest_len, "%s%d", rest_len ? ";" : "", mode);
+        }
+    }
+  }
+  
+  if (rest_len) {
+    // Mouse, keys, bracketed paste... are for the renderer.
+    vt_screen_frame(s, out);
+    buf_printf(out, "\x1b[?%.*s%c", (int)rest_len, rest, set ? 'h' : 'l');
+  }
+  if (exit) {
+    release(s, out);
+    buf_printf(out, "\x1b[?%dl", exit);
+  }
+}
+
+static void dispatch_csi(vt_screen *s, char final, vt_buffer *out) {
+  if (!s->active) {
+    track_csi(s, final);
+    return;
+  }
+  if (s->seq_invalid) {
+    hand_over(s, out);
+    return;
+  }
+  if (s->private_marker) {
+    if (s->private_marker == '?' && !s->intermediate && !s->colon && (final == 'h' || final == 'l')) {
+      private_modes(s, final == 'h', out);
+    } else {
+      pass(s, out);
+    }
+    return;
+  }
+  if (s->intermediate) {
+    if (s->intermediate == '!' && final == 'p') {
+      hand_over(s, out);
+    } else {
+      pass(s, out);
+    }
+    return;
+  }
+  if (s->colon && final != 'm') {
+    hand_over(s, out);
+    return;
+  }
+  
+  int n = count_param(s, 0);
+  switch (final) {
+    case '@': {
+      vt_cell *row = row_cells(s->cells, s, s->row);
+      int count = n < s->cols - s->col ? n : s->cols - s->col;
+      memmove(row + s->col + count, row + s->col, (s->cols - s->col - count) * sizeof(vt_cell));
+      erase(s, s->row, s->col, s->col + count);
+      s->wrap_pending = false;
+      break;
+    }
+    case 'P': {
+      vt_cell *row = row_cells(s->cells, s, s->row);
+      int count = n < s->cols - s->col ? n : s->cols - s->col;
+      memmove(row + s->col, row + s->col + count, (s->cols - s->col - count) * sizeof(vt_cell));
+      erase(s, s->row, s->cols - count, s->cols);
+      s->wrap_pending = false;
+      break;
+    }
+    case 'X':
+      erase(s, s->row, s->col, s->col + n < s->cols ? s->col + n : s->cols);
+      s->wrap_pending = false;
+      break;
+    case 'A': move_rows(s, -n); break;
+    case 'B': case 'e': move_rows(s, n); break;
+    case 'C': case 'a': move_cols(s, n); break;
+    case 'D': move_cols(s, -n); break;
+    case 'E': move_rows(s, n); s->col = 0; break;
+    case 'F': move_rows(s, -n); s->col = 0; break;
+    case 'G': case '`': move_cols(s, n - 1 - s->col); break;
+    case 'd': move_to(s, n - 1, s->col); break;
+    case 'H': case 'f': move_to(s, n - 1, count_param(s, 1) - 1); break;
+    case 'I': tab(s, n); break;
+    case 'Z': tab(s, -n); break;
+    case 'J':
+      switch (param(s, 0, 0)) {
+        case 0:
+          erase(s, s->row, s->col, s->cols);
+          for (int r = s->row + 1; r < s->rows; r++) {
+            erase(s, r, 0, s->cols);
+          }
+          break;
+        case 1:
+          for (int r = 0; r < s->row; r++) {
+            erase(s, r, 0, s->cols);
+          }
+          erase(s, s->row, 0, s->col + 1);
+          break;
+        case 2:
+          for (int r = 0; r < s->rows; r++) {
+            erase(s, r, 0, s->cols);
+          }
+          break;
+        default:
+          pass(s, out);
+          return;
+      }
+      s->wrap_pending = false;
+      break;
+    case 'K':
+      switch (param(s, 0, 0)) {
+        case 0: erase(s, s->row, s->col, s->cols); break;
+        case 1: erase(s, s->row, 0, s->col + 1); break;
+        case 2: erase(s, s->row, 0, s->cols); break;
+      }
+      s->wrap_pending = false;
+      break;
+    case 'L':
+    case 'M':
+      if (s->row >= s->top && s->row <= s->bottom) {
+        scroll(s, s->row, s->bottom, final == 'L' ? -n : n);
+        s->col = 0;
+        s->wrap_pending = false;
+      }
+      break;
+    case 'S':
+      scroll(s, s->top, s->bottom, n);
+      break;
+    case 'T':
+      if (s->nparams > 1) {
+        hand_over(s, out);
+        return;
+      }
+      scroll(s, s->top, s->bottom, -n);
+      break;
+    case 'b':
+      for (int i = 0; i < n && s->last_ch; i++) {
+        put_char(s, s->last_ch);
+      }
+      break;
+    case 'g':
+      if (param(s, 0, 0) == 0) {
+        s->tabs[s->col] = false;
+      } else if (param(s, 0, 0) == 3) {
+        memset(s->tabs, false, s->cols * sizeof(bool));
+      }
+      break;
+    case 'h':
+    case 'l':
+      if (s->nparams == 1 && param(s, 0, 0) == 4) {
+        s->insert = final == 'h';
+      } else {
+        bool owned = false;
+        for (int i = 0; i < s->nparams; i++) {
+          owned = owned || param(s, i, 0) == 4 || param(s, i, 0) == 20;
+        }
+        owned ? hand_over(s, out) : pass(s, out);
+        return;
+      }
+      break;
+    case 'm':
+      if (s->colon || !apply_sgr(&s->pen, s)) {
+        hand_over(s, out);
+        return;
+      }
+      break;
+    case 'r':
+      set_margins(s);
+      move_to(s, 0, 0);
+      break;
+    case 's':
+      if (s->nparams) {
+        hand_over(s, out);
+        return;
+      }
+      save_cursor(s);
+      break;
+    case 'u':
+      restore_cursor(s);
+      break;
+    case 'c': case 'n': case 't': case 'x': case 'q':
+      // Reports and window operations.
+      pass(s, out);
+      break;
+    default:
+      hand_over(s, out);
+  }
+}
+
+static void control(vt_screen *s, unsigned char b, vt_buffer *out) {
+  if (b == 0x0e || b == 0x0f) {
+    s->gl = b == 0x0e;
+    return;
+  }
+  if (!s->active) {
+    return;
+  }
+  
+  switch (b) {
+    case 0x07:
+      buf_append(out, "\a", 1);
+      break;
+    case 0x08:
+      move_cols(s, -1);
+      break;
+    case 0x09:
+      tab(s, 1);
+      break;
+    case 0x0a:
+    case 0x0b:
+    case 0x0c:
+      index_down(s);
+      s->wrap_pending = false;
+      break;
+    case 0x0d:
+      s->col = 0;
+      s->wrap_pending = false;
+      break;
+  }
+}
+
+static void dispatch_esc(vt_screen *s, unsigned char b, vt_buffer *out) {
+  s->state = VT_GROUND;
+  
+  if (s->intermediate == '(' || s->intermediate == ')') {
+    s->charset[s->intermediate == ')'] = b == '0' ? CHARSET_GRAPHICS : CHARSET_ASCII;
+    return;
+  }
+  if (s->intermediate) {
+    if (s->active) {
+      s->intermediate == '#' ? hand_over(s, out) : pass(s, out);
+    }
+    return;
+  }
+  
+  switch (b) {
+    case '[':
+      s->state = VT_CSI;
+      return;
+    case ']': case 'P': case '_': case '^': case 'X':
+      // Strings go to the renderer as they come.
+      if (s->active) {
+        pass(s, out);
+      }
+      s->string_passthrough = s->active;
+      s->state = VT_STRING;
+      return;
+    case '7':
+      save_cursor(s);
+      return;
+    case '8':
+      restore_cursor(s);
+      return;
+    case 'c':
+      if (s->active) {
+        hand_over(s, out);
+      }
+      reset_modes(s);
+      return;
+    case '\\':
+      return;
+  }
+  
+  if (!s->active) {
+    return;
+  }
+  switch (b) {
+    case 'D':
+      index_down(s);
+      break;
+    case 'E':
+      index_down(s);
+      s->col = 0;
+      break;
+    case 'M':
+      reverse_index(s);
+      break;
+    case 'H':
+      s->tabs[s->col] = true;
+      break;
+    case '=':
+    case '>':
+      pass(s, out);
+      break;
+    default:
+      hand_over(s, out);
+  }
+  s->wrap_pending = false;
+}
+
+static void seq_add(vt_screen *s, unsigned char b) {
+  if (s->seq_len < VT_MAX_SEQUENCE) {
+    s->seq[s->seq_len++] = b;
+  } else {
+    s->seq_invalid = true;
+  }
+}
+
+static void seq_start(vt_screen *s) {
+  s->seq_len = 0;
+  s->seq_invalid = false;
+  s->nparams = 0;
+  s->colon = false;
+  s->private_marker = 0;
+  s->intermediate = 0;
+}
+
+static void print(vt_screen *s, uint32_t ch, vt_buffer *out) {
+  if (!s->active) {
+    return;
+  }
+  if (is_narrow(ch)) {
+    put_char(s, ch);
+  } else {
+    hand_over(s, out);
+  }
+}
+
+static void step(vt_screen *s, unsigned char b, vt_buffer *out) {
+  switch (s->state) {
+    case VT_STRING:
+      if (s->string_passthrough) {
+        buf_append(out, &b, 1);
+      }
+      if (b == 0x07 || b == 0x18 || b == 0x1a) {
+        s->state = VT_GROUND;
+      } else if (b == 0x1b) {
+        s->state = VT_STRING_ESC;
+      }
+      return;
+    case VT_STRING_ESC:
+      // Anything after an ESC ends the string, normally it is the ST.
+      if (s->string_passthrough) {
+        buf_append(out, &b, 1);
+      }
+      s->state = VT_GROUND;
+      return;
+    default:
+      break;
+  }
+  
+  if (b == 0x1b) {
+    seq_start(s);
+    seq_add(s, b);
+    s->state = VT_ESC;
+    return;
+  }
+  if (b == 0x18 || b == 0x1a) {
+    s->state = VT_GROUND;
+    return;
+  }
+  
+  switch (s->state) {
+    case VT_UTF8:
+      if ((b & 0xc0) == 0x80) {
+        seq_add(s, b);
+        s->cp = (s->cp << 6) | (b & 0x3f);
+        if (--s->utf8_left == 0) {
+          s->state = VT_GROUND;
+          print(s, s->cp, out);
+        }
+        return;
+      }
+      // Broken sequence, the byte starts over.
+      s->state = VT_GROUND;
+      print(s, 0xfffd, out);
+      step(s, b, out);
+      return;
+      
+    case VT_ESC:
+      seq_add(s, b);
+      if (b < 0x20) {
+        control(s, b, out);
+      } else if (b < 0x30) {
+        s->intermediate = b;
+      } else {
+        dispatch_esc(s, b, out);
+      }
+      return;
+      
+    case VT_CSI:
+      seq_add(s, b);
+      if (b >= '0' && b <= '9') {
+        if (s->nparams == 0) {
+          s->params[s->nparams++] = -1;
+        }
+        int *p = &s->params[s->nparams - 1];
+        *p = (*p < 0 ? 0 : *p) * 10 + (b - '0');
+        if (*p > 99999) {
+          *p = 99999;
+        }
+      } else if (b == ';' || b == ':') {
+        s->colon = s->colon || b == ':';
+        if (s->nparams == 0) {
+          s->params[s->nparams++] = -1;
+        }
+        if (s->nparams < VT_MAX_PARAMS) {
+          s->params[s->nparams++] = -1;
+        } else {
+          s->seq_invalid = true;
+        }
+      } else if (b >= '<' && b <= '?') {
+        if (s->seq_len == 3) {
+          s->private_marker = b;
+        } else {
+          s->seq_invalid = true;
+        }
+      } else if (b >= 0x20 && b < 0x30) {
+        s->intermediate = b;
+      } else if (b >= 0x40 && b < 0x7f) {
+        s->state = VT_GROUND;
+        dispatch_csi(s, b, out);
+      } else if (b < 0x20) {
+        control(s, b, out);
+      }
+      return;
+      
+    default:
+      break;
+  }
+  
+  // Ground
+  if (b < 0x20) {
+    control(s, b, out);
+  } else if (b < 0x7f) {
+    if (s->active) {
+      put_char(s, b);
+    }
+  } else if (b >= 0x80 && s->active) {
+    seq_start(s);
+    seq_add(s, b);
+    if (b >= 0xc2 && b <= 0xdf) {
+      s->cp = b & 0x1f;
+      s->utf8_left = 1;
+    } else if (b >= 0xe0 && b <= 0xef) {
+      s->cp = b & 0x0f;
+      s->utf8_left = 2;
+    } else if (b >= 0xf0 && b <= 0xf4) {
+      s->cp = b & 0x07;
+      s->utf8_left = 3;
+    } else {
+      print(s, 0xfffd, out);
+      return;
+    }
+    s->state = VT_UTF8;
+  }
+}
+
+void vt_screen_feed(vt_screen *s, const char *buf, size_t len, vt_buffer *out) {
+  // Output outside of the model goes to the renderer as it is, in one piece.
+  size_t raw_from = 0;
+  for (size_t i = 0; i < len; i++) {
+    bool was_active = s->active;
+    step(s, (unsigned char)buf[i], out);
+    if (was_active && !s->active) {
+      raw_from = i + 1;
+    } else if (!was_active && s->active) {
+      buf_append(out, buf + raw_from, i + 1 - raw_from);
+    }
+  }
+  if (!s->active) {
+    buf_append(out, buf + raw_from, len - raw_from);
+  }
+}
+
+size_t vt_screen_row_text(const vt_screen *s, int row, char *buf, size_t size) {
+  if (row < 0 || row >= s->rows || size == 0) {
+    return 0;
+  }
+  const vt_cell *cells = s->cells + (size_t)row * s->cols;
+  int last = s->cols - 1;
+  while (last >= 0 && cells[last].ch == ' ') {
+    last--;
+  }
+  size_t len = 0;
+  char utf8[4];
+  for (int c = 0; c <= last; c++) {
+    size_t n = utf8_encode(cells[c].ch, utf8);
+    if (len + n >= size) {
+      break;
+    }
+    memcpy(buf + len, utf8, n);
+    len += n;
+  }
+  buf[len] = 0;
+  return len;
+}
+
+void vt_screen_cursor(const vt_screen *s, int *row, int *col) {
+  *row = s->row;
+  *col = s->col;
+}
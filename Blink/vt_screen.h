@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2018 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef vt_screen_h
+#define vt_screen_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Native model of the terminal screen for full-screen apps.
+//
+// While an app is on the alternate screen, its output is applied to a cell grid
+// here instead of being parsed by the renderer, and the renderer only receives
+// frames with the rows that changed since the previous one. Anything the model
+// does not cover hands the screen back to the renderer, which then receives the
+// output as it is again.
+
+// Growable byte buffer for the output to the renderer.
+typedef struct {
+  char *bytes;
+  size_t len;
+  size_t cap;
+} vt_buffer;
+
+void vt_buffer_free(vt_buffer *b);
+
+typedef struct vt_screen vt_screen;
+
+vt_screen *vt_screen_new(int rows, int cols);
+void vt_screen_free(vt_screen *s);
+void vt_screen_resize(vt_screen *s, int rows, int cols);
+
+// Parses output from the session, appending to out what the renderer must get
+// right away. Outside of the model that is the output itself.
+void vt_screen_feed(vt_screen *s, const char *buf, size_t len, vt_buffer *out);
+
+// Whether the model drives the renderer, and has changes it has not sent yet.
+bool vt_screen_active(const vt_screen *s);
+bool vt_screen_dirty(const vt_screen *s);
+
+// Appends the sequences that bring the renderer up to date with the model.
+void vt_screen_frame(vt_screen *s, vt_buffer *out);
+
+// Inspection of the model, for tests and diagnostics.
+// The text of a row as UTF-8, without trailing blanks. Returns its length.
+size_t vt_screen_row_text(const vt_screen *s, int row, char *buf, size_t size);
+void vt_screen_cursor(const vt_screen *s, int *row, int *col);
+
+#endif /* vt_screen_h */
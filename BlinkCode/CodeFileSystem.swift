@@ -40,10 +40,12 @@ class CodeFileSystem {
   private let translator: AnyPublisher<Translator, Error>
   private let uri: URI
   private let log: BlinkLogger
+  private let cache: CodeFileSystemCache?
   
-  init(_ t: AnyPublisher<Translator, Error>, uri: URI) {
+  init(_ t: AnyPublisher<Translator, Error>, uri: URI, cache: CodeFileSystemCache? = nil) {
     self.translator = t
     self.uri = uri
+    self.cache = cache
     self.log = CodeFileSystemLogger.log("\(uri.host)")
   }
 
@@ -51,6 +53,11 @@ class CodeFileSystem {
     let path = self.uri.rootPath.filesAtPath
     self.log.debug("stat \(path)")
 
+    if let data = cache?.get(.stat, path: path) {
+      return .just((data, nil))
+    }
+    let generation = cache?.generation ?? 0
+
     return translator
       .flatMap {
         $0.cloneWalkTo(path)
@@ -74,7 +81,11 @@ class CodeFileSystem {
                  mtime: mtimeMillis,
                  size: attrs[.size] as? Int)
       }
-      .tryMap { (try JSONEncoder().encode($0), nil) }
+      .tryMap { try JSONEncoder().encode($0) }
+      .map { data -> WebSocketServer.Response in
+        self.cache?.set(.stat, path: path, data: data, generation: generation)
+        return (data, nil)
+      }
       .eraseToAnyPublisher()
   }
 
@@ -82,6 +93,11 @@ class CodeFileSystem {
     let path = self.uri.rootPath.filesAtPath
     self.log.debug("readDirectory \(path)")
 
+    if let data = cache?.get(.readDirectory, path: path) {
+      return .just((data, nil))
+    }
+    let generation = cache?.generation ?? 0
+
     return translator
       .flatMap { $0.cloneWalkTo(path) }
       .flatMap { $0.directoryFilesAndAttributesResolvingLinks() }
@@ -95,34 +111,50 @@ class CodeFileSystem {
                          type: FileType(posixType: $0[.type] as? FileAttributeType))
         }
       }
-      .tryMap { (try JSONEncoder().encode($0), nil) }
+      .tryMap { try JSONEncoder().encode($0) }
+      .map { data -> WebSocketServer.Response in
+        self.cache?.set(.readDirectory, path: path, data: data, generation: generation)
+        return (data, nil)
+      }
       .eraseToAnyPublisher()
   }
 
-  func readFile() -> WebSocketServer.ResponsePublisher {
+  func readFile(offset: UInt64 = 0, length: UInt64? = nil, chunked: Bool = false) -> WebSocketServer.ResponsePublisher {
     let path = self.uri.rootPath.filesAtPath
-    self.log.debug("readFile \(path)")
-    
-    return translator
+    self.log.debug("readFile \(path) offset \(offset) length \(length ?? 0) chunked \(chunked)")
+
+    let content = translator
       .flatMap {
         $0.cloneWalkTo(path)
           .mapError { _ in CodeFileSystemError.fileNotFound(uri: self.uri) }
       }
       .flatMap { $0.open(flags: O_RDONLY) }
-      .flatMap { file -> AnyPublisher<DispatchData, Error> in
-        var content = DispatchData.empty
-        return file
-          .read(max: Int(INT32_MAX))
-          .reduce(DispatchData.empty) { (prevValue, newValue) in
-            var n = prevValue
-            n.append(newValue)
-            return n
-          }
-          .flatMap { dd -> AnyPublisher<Bool, Error> in
-            content = dd
-            return file.close()
-          }
-          .map { _ in content }.eraseToAnyPublisher()
+      .flatMap { self.read($0, offset: offset, length: length) }
+
+    if chunked {
+      // Each block is sent as soon as it is read, so memory stays bounded by the
+      // blocks in flight, and the connection applies backpressure on the reads.
+      var position = offset
+      return content
+        .tryMap { dd -> WebSocketServer.Response in
+          let chunk = ReadFileChunk(offset: position, last: false)
+          position += UInt64(dd.count)
+          return (try JSONEncoder().encode(chunk), Data(dd))
+        }
+        .append(Deferred { () -> WebSocketServer.ResponsePublisher in
+          self.log.debug("readFile \(path) completed. Read \(position - offset) bytes.")
+          return Just(ReadFileChunk(offset: position, last: true))
+            .tryMap { (try JSONEncoder().encode($0), Data()) }
+            .eraseToAnyPublisher()
+        })
+        .eraseToAnyPublisher()
+    }
+
+    return content
+      .reduce(DispatchData.empty) { (prevValue, newValue) in
+        var n = prevValue
+        n.append(newValue)
+        return n
       }
       .map { dd -> (Data?, Data?) in
         var result = Data(count: dd.count)
@@ -136,10 +168,96 @@ class CodeFileSystem {
       .eraseToAnyPublisher()
   }
 
-  func writeFile(options: FileSystemOperationOptions, content: Data) -> WebSocketServer.ResponsePublisher {
+  // Reads the range from the file as a stream of blocks, closing it once done or cancelled.
+  private func read(_ file: BlinkFiles.File, offset: UInt64, length: UInt64?) -> AnyPublisher<DispatchData, Error> {
+    if offset > 0 {
+      guard let seeker = file as? Seeker else {
+        return .fail(error: WebSocketError(message: "Ranged reads not supported"))
+      }
+      do {
+        try seeker.seek(to: offset)
+      } catch {
+        return .fail(error: error)
+      }
+    }
+
+    var remaining = length ?? UInt64.max
+    var closing: AnyCancellable? = nil
+
+    // A cancel may arrive while the close at the end is already running, so make sure
+    // the file is only closed once.
+    let closeLock = NSLock()
+    var closed = false
+    func close() -> AnyPublisher<Bool, Error> {
+      closeLock.lock()
+      defer { closeLock.unlock() }
+      guard !closed else {
+        return .just(true)
+      }
+      closed = true
+      return file.close()
+    }
+
+    // Local reads are reduced to a single buffer, so pull them block by block instead.
+    let blocks: AnyPublisher<DispatchData, Error>
+    if remaining == 0 {
+      blocks = Empty().eraseToAnyPublisher()
+    } else {
+      blocks = (file as? LocalFile)?.readBlocks() ?? file.read(max: Int(min(remaining, UInt64(INT32_MAX))))
+    }
+
+    // Finish with the block that completes the range, instead of waiting for the
+    // next one, so no reads are requested past it.
+    return blocks
+      .flatMap(maxPublishers: .max(1)) { dd -> AnyPublisher<DispatchData, Error> in
+        let count = min(UInt64(dd.count), remaining)
+        remaining -= count
+        let data = Just(count == dd.count ? dd : dd.subdata(in: 0..<Int(count))).setFailureType(to: Error.self)
+        guard remaining == 0 else {
+          return data.eraseToAnyPublisher()
+        }
+        return data.append(Fail(error: RangeCompleted())).eraseToAnyPublisher()
+      }
+      .catch { error -> AnyPublisher<DispatchData, Error> in
+        error is RangeCompleted ? Empty().eraseToAnyPublisher() : .fail(error: error)
+      }
+      .append(Deferred { close().flatMap { _ in Empty<DispatchData, Error>() } })
+      .handleEvents(receiveCancel: {
+        // Keep the close alive until it is done.
+        closing = close().sink(receiveCompletion: { _ in closing = nil },
+                               receiveValue: { _ in })
+      })
+      .eraseToAnyPublisher()
+  }
+
+  func writeFile(options: FileSystemOperationOptions, offset: UInt64 = 0, content: Data) -> WebSocketServer.ResponsePublisher {
     let path = self.uri.rootPath.filesAtPath
-    self.log.debug("writeFile \(path)")
-    
+    self.log.debug("writeFile \(path) offset \(offset)")
+
+    // Ranged writes continue an upload, so they only apply to the existing file.
+    if offset > 0 {
+      return translator
+        .flatMap {
+          $0.cloneWalkTo(path)
+            .mapError { _ in CodeFileSystemError.fileNotFound(uri: self.uri) }
+        }
+        .flatMap { $0.open(flags: O_WRONLY) }
+        .flatMap { file -> AnyPublisher<Int, Error> in
+          guard let seeker = file as? Seeker else {
+            return .fail(error: WebSocketError(message: "Ranged writes not supported"))
+          }
+          do {
+            try seeker.seek(to: offset)
+          } catch {
+            return .fail(error: error)
+          }
+          return self.write(content, to: file)
+        }
+        .handleEvents(receiveCompletion: { _ in self.cache?.invalidate(path: path) })
+        .map { _ in (nil, nil) }
+        .eraseToAnyPublisher()
+    }
+
     let parentDir = (path as NSString).deletingLastPathComponent
     let fileName  = (path as NSString).lastPathComponent
 
@@ -167,29 +285,34 @@ class CodeFileSystem {
             return parentT.create(name: fileName, flags: O_WRONLY, mode: 0o644)
           }
         // 2. Write the content to the file
-          .flatMap { file -> AnyPublisher<Int, Error> in
-            if content.isEmpty {
-              return file.close()
-                .map { _ in
-                  0 }
-                .eraseToAnyPublisher()
-            }
-            return file.write(content.withUnsafeBytes { DispatchData(bytes: $0) }, max: content.count)
-              .reduce(0, { count, written -> Int in
-                           return count + written
-              })
-              .flatMap { wrote -> AnyPublisher<Int, Error> in
-                self.log.debug("writeFile \(path) completed. Wrote \(wrote) bytes.")
-                return file.close().map { _ in wrote }.eraseToAnyPublisher()
-              }
-              .eraseToAnyPublisher()
-          }
+          .flatMap { self.write(content, to: $0) }
         // 3. Resolve once everything copied. Just collect but output nothing.
+          .handleEvents(receiveCompletion: { _ in self.cache?.invalidate(path: path) })
           .map { _ in (nil, nil) }
           .eraseToAnyPublisher()
       }.eraseToAnyPublisher()
   }
 
+  private func write(_ content: Data, to file: BlinkFiles.File) -> AnyPublisher<Int, Error> {
+    let path = self.uri.rootPath.filesAtPath
+
+    if content.isEmpty {
+      return file.close()
+        .map { _ in
+          0 }
+        .eraseToAnyPublisher()
+    }
+    return file.write(content.withUnsafeBytes { DispatchData(bytes: $0) }, max: content.count)
+      .reduce(0, { count, written -> Int in
+                   return count + written
+      })
+      .flatMap { wrote -> AnyPublisher<Int, Error> in
+        self.log.debug("writeFile \(path) completed. Wrote \(wrote) bytes.")
+        return file.close().map { _ in wrote }.eraseToAnyPublisher()
+      }
+      .eraseToAnyPublisher()
+  }
+
   func createDirectory() -> WebSocketServer.ResponsePublisher {
     let path = self.uri.rootPath.filesAtPath
     self.log.debug("createDirectory \(path)")
@@ -216,6 +339,7 @@ class CodeFileSystem {
               .eraseToAnyPublisher()
           }.eraseToAnyPublisher()
       }
+      .handleEvents(receiveCompletion: { _ in self.cache?.invalidate(path: path) })
       .map { _ in (nil, nil) }
       .eraseToAnyPublisher()
   }
@@ -233,7 +357,7 @@ class CodeFileSystem {
     
     return translator
       .flatMap {
-        $0.cloneWalkTo(path)
+        $0.cloneWalkTo(entry: path)
           .mapError { _ in CodeFileSystemError.fileNotFound(uri: self.uri) }
       }
       .flatMap { oldT in
@@ -244,10 +368,19 @@ class CodeFileSystem {
         // Will take the easy route for now.
         // We try the stat, and will figure out if in case it is a file, we have to
         // remove it or what.
-        .flatMap { newParentT in
-          oldT.wstat([.name: (newParentT.current as NSString).appendingPathComponent(newName)])
+        .flatMap { newParentT -> AnyPublisher<Void, Error> in
+          let newPath = (newParentT.current as NSString).appendingPathComponent(newName)
+          // Replacing an existing file may need a move on the remote side.
+          if options.overwrite ?? false {
+            return oldT.moveTree(to: newPath)
+          }
+          return oldT.wstat([.name: newPath]).map { _ in () }.eraseToAnyPublisher()
         }
       }
+      .handleEvents(receiveCompletion: { _ in
+        self.cache?.invalidate(path: path)
+        self.cache?.invalidate(path: newUri.rootPath.filesAtPath)
+      })
       .map { _ in (nil, nil) }
       .eraseToAnyPublisher()
   }
@@ -258,54 +391,24 @@ class CodeFileSystem {
     
     let recursive = options.recursive ?? false
 
-    func delete(_ translators: [Translator]) -> AnyPublisher<Void, Error> {
-      translators.publisher
-        .flatMap(maxPublishers: .max(1)) { t -> AnyPublisher<Void, Error> in
-          print(t.current)
-          if t.fileType == .typeDirectory {
-            return [deleteDirectoryContent(t), AnyPublisher(t.rmdir().map {_ in})]
-              .compactMap { $0 }
-              .publisher
-              .flatMap(maxPublishers: .max(1)) { $0 }
-              .collect()
-              .map {_ in}
-              .eraseToAnyPublisher()
-          }
-
-          return AnyPublisher(t.remove().map { _ in })
-        }.eraseToAnyPublisher()
-    }
-
-    func deleteDirectoryContent(_ t: Translator) -> AnyPublisher<Void, Error>? {
-      if recursive == false {
-        return nil
-      }
-
-      return t.directoryFilesAndAttributes().flatMap {
-        $0.compactMap { i -> FileAttributes? in
-          if (i[.name] as! String) == "." || (i[.name] as! String) == ".." {
-            return nil
-          } else {
-            return i
-          }
-        }.publisher
-      }
-      .flatMap {
-        t.cloneWalkTo($0[.name] as! String) }
-      .collect()
-      .flatMap {
-        delete($0) }
-      .eraseToAnyPublisher()
-    }
-
     return translator
       .flatMap {
-        $0.cloneWalkTo(path)
+        // Deleting a link removes the link, never its target.
+        $0.cloneWalkTo(entry: path)
           .mapError { _ in CodeFileSystemError.fileNotFound(uri: self.uri) }
-          .flatMap { delete([$0]) }
+          .flatMap { t -> AnyPublisher<Void, Error> in
+            if t.fileType == .typeDirectory && !recursive {
+              return t.rmdir().map { _ in () }.eraseToAnyPublisher()
+            }
+            return t.removeTree()
+          }
       }
+      .handleEvents(receiveCompletion: { _ in self.cache?.invalidate(path: path) })
       .map { _ in (nil, nil) }
       .eraseToAnyPublisher()
   }
 
 }
+
+// Ends a ranged read right after the block that completes it.
+fileprivate struct RangeCompleted: Error {}
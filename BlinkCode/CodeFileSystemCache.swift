@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+
+
+// Per-mount cache of encoded stat and readDirectory responses.
+// The editor asks for the same metadata many times while opening a workspace,
+// so we answer from here while the entries are fresh, and drop them whenever
+// an operation modifies the paths they describe.
+// Every invalidation bumps a generation. Lookups take it before they start and
+// only store their result if nothing was invalidated meanwhile, so a stat or
+// listing that was in flight across a write cannot cache what it saw before it.
+class CodeFileSystemCache {
+  enum Kind: String {
+    case stat
+    case readDirectory
+  }
+
+  private struct Entry {
+    let data: Data
+    let expires: Date
+  }
+
+  let ttl: TimeInterval
+  let maxEntries: Int
+  private var entries: [String: Entry] = [:]
+  private var currentGeneration: UInt64 = 0
+  private let queue = DispatchQueue(label: "CodeFileSystemCache")
+
+  init(ttl: TimeInterval = 5, maxEntries: Int = 10_000) {
+    self.ttl = ttl
+    self.maxEntries = maxEntries
+  }
+
+  func get(_ kind: Kind, path: String) -> Data? {
+    queue.sync {
+      let key = Self.key(kind, path)
+      guard let entry = entries[key] else {
+        return nil
+      }
+      if entry.expires < Date() {
+        entries.removeValue(forKey: key)
+        return nil
+      }
+      return entry.data
+    }
+  }
+
+  var generation: UInt64 {
+    queue.sync { currentGeneration }
+  }
+
+  func set(_ kind: Kind, path: String, data: Data, generation: UInt64) {
+    queue.sync {
+      guard generation == currentGeneration else {
+        return
+      }
+      if entries.count >= maxEntries {
+        let now = Date()
+        entries = entries.filter { $0.value.expires > now }
+        if entries.count >= maxEntries {
+          entries.removeAll()
+        }
+      }
+      entries[Self.key(kind, path)] = Entry(data: data, expires: Date(timeIntervalSinceNow: ttl))
+    }
+  }
+
+  // Drop the path, anything below it, and the listing of its parent.
+  func invalidate(path: String) {
+    let parent = (path as NSString).deletingLastPathComponent
+    let prefix = path.hasSuffix("/") ? path : path + "/"
+
+    queue.sync {
+      currentGeneration += 1
+      entries.removeValue(forKey: Self.key(.readDirectory, parent))
+      entries = entries.filter { (key, _) in
+        let entryPath = Self.path(key)
+        return entryPath != path && !entryPath.hasPrefix(prefix)
+      }
+    }
+  }
+
+  func invalidateAll() {
+    queue.sync {
+      currentGeneration += 1
+      entries.removeAll()
+    }
+  }
+
+  private static func key(_ kind: Kind, _ path: String) -> String {
+    "\(kind.rawValue):\(path)"
+  }
+
+  private static func path(_ key: String) -> String {
+    guard let idx = key.firstIndex(of: ":") else {
+      return key
+    }
+    return String(key[key.index(after: idx)...])
+  }
+}
@@ -76,6 +76,10 @@ public class CodeFileSystemService: CodeSocketDelegate {
   var tokenIdx = 0;
 
   private var translators: [String: TranslatorControl] = [:]
+  // Metadata caches per mount host. Local files use the empty host.
+  private var caches: [String: CodeFileSystemCache] = [:]
+  // Operations from a batch that may be in flight at the same time.
+  let batchConcurrency = 16
 
   private let finishedCallback: ((Error?) -> ())
   func finished(_ error: Error?) { finishedCallback(error) }
@@ -114,6 +118,7 @@ public class CodeFileSystemService: CodeSocketDelegate {
     }
 
     translators.removeValue(forKey: host)
+    caches.removeValue(forKey: host)
   }
 
   public init(listenOn port: NWEndpoint.Port, tls: Bool, finished: @escaping ((Error?) -> ()))  throws {
@@ -153,10 +158,13 @@ public class CodeFileSystemService: CodeSocketDelegate {
         return try fileSystem(for: msg.uri).readDirectory()
       case .readFile:
         let msg: ReadFileFileSystemRequest = try decode(encodedData)
-        return try fileSystem(for: msg.uri).readFile()
+        return try fileSystem(for: msg.uri).readFile(offset: msg.offset ?? 0,
+                                                     length: msg.length,
+                                                     chunked: msg.chunked ?? false)
       case .writeFile:
         let msg: WriteFileSystemRequest = try decode(encodedData)
         return try fileSystem(for: msg.uri).writeFile(options: msg.options,
+                                                      offset: msg.offset ?? 0,
                                                       content: binaryData ?? Data())
       case .createDirectory:
         let msg: CreateDirectoryFileSystemRequest = try decode(encodedData)
@@ -168,6 +176,9 @@ public class CodeFileSystemService: CodeSocketDelegate {
       case .delete:
         let msg: DeleteFileSystemRequest = try decode(encodedData)
         return try fileSystem(for: msg.uri).delete(options: msg.options)
+      case .batch:
+        let msg: BatchFileSystemRequest = try decode(encodedData)
+        return batch(msg.operations)
       }
     } catch {
       log.error("\(error)")
@@ -176,13 +187,76 @@ public class CodeFileSystemService: CodeSocketDelegate {
     }
   }
 
+  // Runs all operations from the batch concurrently over the same mounts, and replies
+  // with a single array holding the result or error of each one, in request order.
+  func batch(_ operations: [BatchFileSystemOperation]) -> WebSocketServer.ResponsePublisher {
+    // Resolve the file systems here, as the translators are only managed from the server queue.
+    let requests = operations.enumerated().map { (idx, operation) -> (Int, WebSocketServer.ResponsePublisher) in
+      do {
+        let fs = try fileSystem(for: operation.uri)
+        switch operation.op {
+        case .stat:
+          return (idx, fs.stat())
+        case .readDirectory:
+          return (idx, fs.readDirectory())
+        default:
+          throw WebSocketError(message: "Operation \(operation.op) not supported in batch")
+        }
+      } catch {
+        return (idx, .fail(error: error))
+      }
+    }
+
+    return requests.publisher
+      .flatMap(maxPublishers: .max(batchConcurrency)) { (idx, request) -> AnyPublisher<(Int, Data), Never> in
+        request
+          .map { (idx, Data("{\"result\":".utf8) + ($0.0 ?? Data("null".utf8)) + Data("}".utf8)) }
+          .catch { error -> Just<(Int, Data)> in
+            let encodedError: Data?
+            if let error = error as? CodeFileSystemError {
+              encodedError = try? JSONEncoder().encode(error)
+            } else {
+              encodedError = try? JSONEncoder().encode(WebSocketError(message: "\(error)"))
+            }
+            return Just((idx, Data("{\"error\":".utf8) + (encodedError ?? Data("null".utf8)) + Data("}".utf8)))
+          }
+          .eraseToAnyPublisher()
+      }
+      .collect()
+      .map { results -> WebSocketServer.Response in
+        var response = Data("[".utf8)
+        for (n, item) in results.sorted(by: { $0.0 < $1.0 }).enumerated() {
+          if n > 0 {
+            response.append(contentsOf: ",".utf8)
+          }
+          response.append(item.1)
+        }
+        response.append(contentsOf: "]".utf8)
+        return (response, nil)
+      }
+      .setFailureType(to: Error.self)
+      .eraseToAnyPublisher()
+  }
+
+  private func cache(for uri: URI) -> CodeFileSystemCache {
+    let key = uri.host ?? ""
+    if let cache = caches[key] {
+      return cache
+    }
+    let cache = CodeFileSystemCache()
+    caches[key] = cache
+    return cache
+  }
+
   private func fileSystem(for uri: URI) throws -> CodeFileSystem {
+    let mountCache = cache(for: uri)
+
     if let host = uri.host,
        let tRef = translators[host] {
       if tRef.translator != nil && tRef.isConnected {
-        return CodeFileSystem(tRef.builder, uri: uri)
+        return CodeFileSystem(tRef.builder, uri: uri, cache: mountCache)
       } else if tRef.translator == nil {
-        return CodeFileSystem(tRef.builder, uri: uri)
+        return CodeFileSystem(tRef.builder, uri: uri, cache: mountCache)
       }
     }
 
@@ -211,11 +285,13 @@ public class CodeFileSystemService: CodeSocketDelegate {
       )
 
       translators[hostAlias] = TranslatorControl(translator)
-      return CodeFileSystem(translator, uri: uri)
+      // A new connection may see a different state of the remote.
+      mountCache.invalidateAll()
+      return CodeFileSystem(translator, uri: uri, cache: mountCache)
 
     case "blinkfs":
       // The local one does not need to be saved.
-      return CodeFileSystem(.just(BlinkFiles.Local()), uri: uri)
+      return CodeFileSystem(.just(BlinkFiles.Local()), uri: uri, cache: mountCache)
     default:
       throw WebSocketError(message: "Unknown protocol - \(uri.protocolId)")
     }
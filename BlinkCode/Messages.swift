@@ -43,6 +43,7 @@ enum CodeFileSystemAction: String, Codable {
   case createDirectory
   case delete
   case rename
+  case batch
 }
 
 struct BaseFileSystemRequest: Codable {
@@ -85,23 +86,41 @@ struct ReadDirectoryFileSystemRequest: Codable {
 struct ReadFileFileSystemRequest: Codable {
   let op: CodeFileSystemAction
   let uri: URI
+  // Optional range to read. Without it, the whole file is returned.
+  let offset: UInt64?
+  let length: UInt64?
+  // Reply with multiple ReadFileChunk frames as data arrives, instead of a single one.
+  let chunked: Bool?
 
-  init(uri: URI) {
+  init(uri: URI, offset: UInt64? = nil, length: UInt64? = nil, chunked: Bool? = nil) {
     self.op = .readFile
     self.uri = uri
+    self.offset = offset
+    self.length = length
+    self.chunked = chunked
   }
 
 }
 
+// Header for each binary frame of a chunked read. The last frame carries no data.
+struct ReadFileChunk: Codable {
+  let offset: UInt64
+  let last: Bool
+}
+
 struct WriteFileSystemRequest: Codable {
   let op: CodeFileSystemAction
   let uri: URI
   let options: FileSystemOperationOptions
+  // Write the content at this position of an existing file. Large files are then
+  // uploaded as a sequence of ranged writes instead of a single message.
+  let offset: UInt64?
 
-  init(uri: URI, options: FileSystemOperationOptions) {
+  init(uri: URI, options: FileSystemOperationOptions, offset: UInt64? = nil) {
     self.op = .writeFile
     self.uri = uri
     self.options = options
+    self.offset = offset
   }
 }
 
@@ -141,6 +160,28 @@ struct CreateDirectoryFileSystemRequest: Codable {
   }
 }
 
+// Carries many stat or readDirectory operations in a single frame.
+// The response is an array with the result or error of each operation, in order.
+struct BatchFileSystemRequest: Codable {
+  let op: CodeFileSystemAction
+  let operations: [BatchFileSystemOperation]
+
+  init(operations: [BatchFileSystemOperation]) {
+    self.op = .batch
+    self.operations = operations
+  }
+}
+
+struct BatchFileSystemOperation: Codable {
+  let op: CodeFileSystemAction
+  let uri: URI
+
+  init(op: CodeFileSystemAction, uri: URI) {
+    self.op = op
+    self.uri = uri
+  }
+}
+
 
 struct RootPath: Equatable {
   private let url: URL // should be private
@@ -196,6 +196,14 @@ class WebSocketConnection {
     }
     buffer = data.advanced(by: CodeSocketMessageHeader.encodedSize)
 
+    // A Cancel references the operation to stop. Cancelling the subscription
+    // stops any reads or writes still in flight for it.
+    if header.type == .Cancel {
+      log.info("Cancelling operation \(header.referenceId)")
+      cancellables.removeValue(forKey: header.referenceId)?.cancel()
+      return
+    }
+
     let messageHeaderTypes: [CodeSocketContentType] = [.Json, .Binary, .JsonWithBinary]
     guard messageHeaderTypes.contains(header.type) else {
       log.error("Wrong message type")
@@ -212,9 +220,20 @@ class WebSocketConnection {
       return
     }
 
+    // Responses are sent one at a time, and the next one is only requested once the
+    // previous has been processed by the connection. Streamed responses then follow
+    // the pace of the socket instead of piling up in the send queue.
     cancellables[operationId] = delegate
       .handleMessage(encodedData: payload.encodedData,
                      binaryData:  payload.binaryData)
+      .flatMap(maxPublishers: .max(1)) { [weak self] response -> AnyPublisher<Void, Error> in
+        guard let self = self else {
+          return .just(())
+        }
+        return self.sendMessage(operationId: operationId,
+                                encodedData: response.0,
+                                binaryData: response.1)
+      }
       .sink(
         receiveCompletion: { [weak self] completion in
           guard let self = self else { return }
@@ -231,17 +250,13 @@ class WebSocketConnection {
             break
           }
         },
-        receiveValue: {
-          self.sendMessage(operationId: operationId,
-                           encodedData: $0,
-                           binaryData: $1)
-        }
+        receiveValue: { _ in }
       )
   }
 
   func sendMessage(operationId: UInt32,
                    encodedData: Data?,
-                   binaryData: Data?) {
+                   binaryData: Data?) -> AnyPublisher<Void, Error> {
     let metadata = NWProtocolWebSocket.Metadata(opcode: .binary)
     let context = NWConnection.ContentContext(identifier: "binaryContext",
                                               metadata: [metadata])
@@ -251,9 +266,17 @@ class WebSocketConnection {
     let replyHeader = CodeSocketMessageHeader(type: payload.type,
                                               operationId: operationId,
                                               referenceId: operationId)
-    conn.send(content: replyHeader.encoded + payload.encoded,
-              contentContext: context,
-              completion: .idempotent)
+    return Future { promise in
+      self.conn.send(content: replyHeader.encoded + payload.encoded,
+                     contentContext: context,
+                     completion: .contentProcessed { error in
+                       if let error = error {
+                         promise(.failure(error))
+                       } else {
+                         promise(.success(()))
+                       }
+                     })
+    }.eraseToAnyPublisher()
   }
 
   func sendError(operationId: UInt32,
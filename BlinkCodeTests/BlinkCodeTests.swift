@@ -43,7 +43,7 @@ class BlinkCodeTests: XCTestCase {
   override func setUpWithError() throws {
     // Put setup code here. This method is called before the invocation of each test method in the class.
     OperationId = 0
-    service = try CodeFileSystemService(listenOn: 10015, tls: false)
+    service = try CodeFileSystemService(listenOn: 10015, tls: false, finished: { _ in })
   }
 
   override func tearDownWithError() throws {
@@ -182,9 +182,150 @@ class BlinkCodeTests: XCTestCase {
     let exists = FileManager.default.fileExists(atPath: path, isDirectory: &isDir)
     XCTAssertFalse(exists)
   }
+
+  // Ranged, chunked and cancelled operations work on a file of their own, over the
+  // port the service listens on.
+  func testRangedReadFile() throws {
+    let content = Data((0..<10_000).map { UInt8($0 % 251) })
+    let uri = try temporaryFile("rangedRead", content: content)
+    let task = localWebSocketTask()
+
+    let req = ReadFileFileSystemRequest(uri: uri, offset: 1_000, length: 2_500)
+    let (response, responseContent) = try task.sendCodeFileSystemRequest(req, test: self)
+
+    XCTAssertTrue(response.isEmpty)
+    XCTAssertEqual(responseContent, content[1_000..<3_500])
+  }
+
+  func testChunkedReadFile() throws {
+    // Several blocks, the last one partial.
+    let content = Data((0..<(3 * 1024 * 1024 + 100)).map { UInt8($0 % 251) })
+    let uri = try temporaryFile("chunkedRead", content: content)
+    let task = localWebSocketTask()
+
+    let offset: UInt64 = 100
+    let length: UInt64 = 2 * 1024 * 1024
+    let req = ReadFileFileSystemRequest(uri: uri, offset: offset, length: length, chunked: true)
+    try task.sendFrame(req, operationId: 1, test: self)
+
+    var received = Data()
+    var last = false
+    var frames = 0
+    while !last {
+      let (header, payload) = try task.receiveFrame(test: self)
+      XCTAssertEqual(header.referenceId, 1)
+      let chunk = try JSONDecoder().decode(ReadFileChunk.self, from: payload.encodedData)
+      XCTAssertEqual(chunk.offset, offset + UInt64(received.count))
+      received.append(payload.binaryData ?? Data())
+      last = chunk.last
+      frames += 1
+    }
+
+    XCTAssertGreaterThan(frames, 2)
+    XCTAssertEqual(received, content[Int(offset)..<Int(offset + length)])
+  }
+
+  func testWriteFileAtOffset() throws {
+    let uri = try temporaryFile("offsetWrite", content: Data("Hello world".utf8))
+    let task = localWebSocketTask()
+
+    let req = WriteFileSystemRequest(uri: uri, options: .init(overwrite: true, create: false), offset: 6)
+    let (response, responseContent) = try task.sendCodeFileSystemRequest(req,
+                                                                         binaryData: Data("WORLD!".utf8),
+                                                                         test: self)
+    XCTAssertTrue(response.isEmpty)
+    XCTAssertNil(responseContent)
+    XCTAssertEqual(FileManager.default.contents(atPath: uri.rootPath.filesAtPath), Data("Hello WORLD!".utf8))
+
+    // Ranged writes only continue existing files.
+    let missing = URI("blink-fs:local:\((NSTemporaryDirectory() as NSString).appendingPathComponent("offsetWriteMissing"))")
+    try? FileManager.default.removeItem(atPath: missing.rootPath.filesAtPath)
+    let missingReq = WriteFileSystemRequest(uri: missing, options: .init(overwrite: true, create: true), offset: 6)
+    try task.sendFrame(missingReq, operationId: 2, binaryData: Data("WORLD!".utf8), test: self)
+    let (header, _) = try task.receiveFrame(test: self)
+    XCTAssertEqual(header.type, .Error)
+    XCTAssertFalse(FileManager.default.fileExists(atPath: missing.rootPath.filesAtPath))
+  }
+
+  func testCancelChunkedRead() throws {
+    // Large enough to never make it through the socket before the cancel.
+    let uri = try temporaryFile("cancelRead", content: Data())
+    let handle = try FileHandle(forWritingTo: URL(fileURLWithPath: uri.rootPath.filesAtPath))
+    try handle.truncate(atOffset: 1024 * 1024 * 1024)
+    try handle.close()
+    let task = localWebSocketTask()
+
+    try task.sendFrame(ReadFileFileSystemRequest(uri: uri, chunked: true), operationId: 1, test: self)
+    let (first, _) = try task.receiveFrame(test: self)
+    XCTAssertEqual(first.referenceId, 1)
+
+    let cancel = CodeSocketMessageHeader(type: .Cancel, operationId: 2, referenceId: 1)
+    task.send(.data(cancel.encoded)) { error in if let error = error { XCTFail("\(error)") }}
+
+    // The connection keeps serving other operations. Chunks already on their way may
+    // still arrive, but the read never gets to its end.
+    try task.sendFrame(StatFileSystemRequest(uri: uri), operationId: 3, test: self)
+    var chunks = 1
+    while true {
+      let (header, payload) = try task.receiveFrame(test: self)
+      if header.referenceId == 3 {
+        break
+      }
+      XCTAssertEqual(header.referenceId, 1)
+      let chunk = try JSONDecoder().decode(ReadFileChunk.self, from: payload.encodedData)
+      XCTAssertFalse(chunk.last)
+      chunks += 1
+    }
+    XCTAssertLessThan(chunks, 1024)
+  }
+
+  private func localWebSocketTask() -> URLSessionWebSocketTask {
+    let task = URLSession.shared.webSocketTask(with: URL(string: "ws://localhost:\(service!.port)")!)
+    // Chunks carry a whole block.
+    task.maximumMessageSize = 4 * 1024 * 1024
+    task.resume()
+    return task
+  }
+
+  private func temporaryFile(_ name: String, content: Data) throws -> URI {
+    let path = (NSTemporaryDirectory() as NSString).appendingPathComponent(name)
+    try content.write(to: URL(fileURLWithPath: path))
+    return URI("blink-fs:local:\(path)")
+  }
 }
 
 extension URLSessionWebSocketTask {
+  fileprivate func sendFrame<T: Codable>(_ req: T, operationId: UInt32, binaryData: Data? = nil, test: XCTestCase) throws {
+    let payload = CodeSocketMessagePayload(encodedData: try JSONEncoder().encode(req),
+                                           binaryData: binaryData)
+    let header = CodeSocketMessageHeader(type: payload.type,
+                                         operationId: operationId,
+                                         referenceId: operationId)
+    self.send(.data(header.encoded + payload.encoded)) { error in if let error = error { XCTFail("\(error)") }}
+  }
+
+  fileprivate func receiveFrame(test: XCTestCase) throws -> (CodeSocketMessageHeader, CodeSocketMessagePayload) {
+    let expectation = XCTestExpectation(description: "Frame received")
+    var frame: (CodeSocketMessageHeader, CodeSocketMessagePayload)? = nil
+
+    self.receive { result in
+      if case .success(.data(let data)) = result,
+         let header = CodeSocketMessageHeader(data[0..<CodeSocketMessageHeader.encodedSize]) {
+        let buffer = data.advanced(by: CodeSocketMessageHeader.encodedSize)
+        if let payload = CodeSocketMessagePayload(buffer, type: header.type) {
+          frame = (header, payload)
+        }
+      }
+      expectation.fulfill()
+    }
+
+    test.wait(for: [expectation], timeout: 5.0)
+    guard let frame = frame else {
+      throw WebSocketError(message: "No frame received")
+    }
+    return frame
+  }
+
   fileprivate func sendCodeFileSystemRequest<T: Codable>(_ req: T, binaryData: Data? = nil, test: XCTestCase) throws -> (Data, Data?) {
     let expectation = XCTestExpectation(description: "File System Request fulfilled")
 
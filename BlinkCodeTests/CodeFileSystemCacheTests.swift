@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import XCTest
+
+@testable import BlinkCode
+
+class CodeFileSystemCacheTests: XCTestCase {
+  let data = Data("cached".utf8)
+
+  func testEntriesExpire() throws {
+    let cache = CodeFileSystemCache(ttl: 0.2)
+    cache.set(.stat, path: "/a", data: data, generation: cache.generation)
+    XCTAssertEqual(cache.get(.stat, path: "/a"), data)
+    XCTAssertNil(cache.get(.readDirectory, path: "/a"))
+
+    Thread.sleep(forTimeInterval: 0.3)
+    XCTAssertNil(cache.get(.stat, path: "/a"))
+  }
+
+  func testEntriesAreCapped() throws {
+    let cache = CodeFileSystemCache(ttl: 60, maxEntries: 10_000)
+    for i in 0..<10_000 {
+      cache.set(.stat, path: "/\(i)", data: data, generation: cache.generation)
+    }
+    XCTAssertEqual(cache.get(.stat, path: "/9999"), data)
+
+    // Nothing expired, so the next entry starts the cache over.
+    cache.set(.stat, path: "/new", data: data, generation: cache.generation)
+    XCTAssertEqual(cache.get(.stat, path: "/new"), data)
+    XCTAssertNil(cache.get(.stat, path: "/0"))
+    XCTAssertNil(cache.get(.stat, path: "/9999"))
+  }
+
+  func testInvalidateDropsPathChildrenAndParentListing() throws {
+    let cache = CodeFileSystemCache(ttl: 60)
+    for path in ["/dir", "/dir/file", "/dir/sub/file", "/dirty"] {
+      cache.set(.stat, path: path, data: data, generation: cache.generation)
+    }
+    cache.set(.readDirectory, path: "/", data: data, generation: cache.generation)
+
+    cache.invalidate(path: "/dir")
+
+    XCTAssertNil(cache.get(.stat, path: "/dir"))
+    XCTAssertNil(cache.get(.stat, path: "/dir/file"))
+    XCTAssertNil(cache.get(.stat, path: "/dir/sub/file"))
+    XCTAssertNil(cache.get(.readDirectory, path: "/"))
+    XCTAssertEqual(cache.get(.stat, path: "/dirty"), data)
+  }
+
+  func testResultsReadAcrossAnInvalidationAreNotCached() throws {
+    let cache = CodeFileSystemCache(ttl: 60)
+
+    // A lookup starts, a write to another path lands, then the lookup completes.
+    let generation = cache.generation
+    cache.invalidate(path: "/other")
+    cache.set(.stat, path: "/a", data: data, generation: generation)
+    XCTAssertNil(cache.get(.stat, path: "/a"))
+
+    let next = cache.generation
+    cache.invalidateAll()
+    cache.set(.readDirectory, path: "/", data: data, generation: next)
+    XCTAssertNil(cache.get(.readDirectory, path: "/"))
+
+    // Without anything in between, results are kept.
+    cache.set(.stat, path: "/a", data: data, generation: cache.generation)
+    XCTAssertEqual(cache.get(.stat, path: "/a"), data)
+  }
+}
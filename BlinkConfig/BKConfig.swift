@@ -38,29 +38,26 @@ import SSHConfig
 
 // Responsible to intermediate between the Blink Configuration formats and the
 // SSHClient requirements, facilitating information between them.
-// TODO This will work a lot better as a singleton.
+// All values share a compiled snapshot of the configuration, so they are cheap to create.
 public struct BKConfig {
   let defaultKeyNames = ["id_dsa", "id_rsa", "id_ecdsa", "id_ecdsa_sk", "id_ed25519"]
 
-  private let _allHosts: [BKHosts]
-  private let _allIdentities: [BKPubKey]
-  private let bkSSHConfig: SSHConfig
+  private let _snapshot: BKConfigSnapshot
 
-  // TODO Config files
-  public init() throws {
-    _allHosts = BKHosts.allHosts()
-    _allIdentities = BKPubKey.all()
-    bkSSHConfig = try SSHConfig.parse(url: BlinkPaths.blinkGlobalSSHConfigFileURL())
+  // Processes that do not own the host and key stores, like extensions, should
+  // reload them so changes from the app are picked up.
+  public init(reloadingStores: Bool = false) throws {
+    _snapshot = try BKConfigSnapshot.current(reloadingStores: reloadingStores)
   }
 
   private func _host(_ host: String) -> BKHosts? {
-    return _allHosts.first(where: { $0.host == host })
+    return _snapshot.hosts[host]
   }
 
   // Return the stored configuration given the host.
   // The root for the configuration is now the file sequence from .blink/ssh_config.
   public func bkSSHHost(_ alias: String) throws -> BKSSHHost {
-    var sshConfig = try bkSSHConfig.resolve(alias: alias)
+    var sshConfig = try _snapshot.resolve(alias: alias)
 
     // Add protected data (password)
     if let password = _host(alias)?.password {
@@ -78,7 +75,7 @@ public struct BKConfig {
 
   public func privateKey(forIdentifier identifier: String) -> (String, String)? {
     guard
-      let privateKey = _allIdentities.first(where: { $0.id == identifier })?.loadPrivateKey()
+      let privateKey = _snapshot.identities[identifier]?.loadPrivateKey()
     else {
       return nil
     }
@@ -88,7 +85,8 @@ public struct BKConfig {
 
   public func signer(forIdentity identity: String) -> (Signer, String)? {
     guard
-      let signer = _allIdentities.signerWithID(identity)
+      let card = _snapshot.identities[identity],
+      let signer = BKSignerCache.shared.signer(for: card)
     else {
       return nil
     }
@@ -113,10 +111,8 @@ public struct BKConfig {
   }
   
   public func defaultKeys() -> [(String, String)] {
-    return _allIdentities
-      .filter {
-        defaultKeyNames.contains($0.id)
-      }
+    return defaultKeyNames
+      .compactMap { _snapshot.identities[$0] }
       .map {
         ($0.loadPrivateKey(), $0.id)
       }
@@ -130,3 +126,136 @@ public struct BKConfig {
       }
   }
 }
+
+
+// Immutable result of parsing the configuration sources. A new one is compiled
+// when the config files (and their includes) or the host and key stores change.
+final class BKConfigSnapshot {
+  let hosts: [String: BKHosts]
+  let identities: [String: BKPubKey]
+  private let _sshConfig: SSHConfig
+  private let _stamp: Stamp
+
+  // Resolved aliases. Host and Match blocks are evaluated once per alias.
+  private var _resolved = [String: [String: Any]]()
+  private let _lock = NSLock()
+
+  private static let _sharedLock = NSLock()
+  private static var _current: BKConfigSnapshot? = nil
+  private static var _storesVersion = 0
+  private static let _observers: [NSObjectProtocol] = [BKHostsDidChangeNotification, BKPubKeyDidChangeNotification].map {
+    NotificationCenter.default.addObserver(forName: NSNotification.Name($0), object: nil, queue: nil) { _ in
+      BKConfigSnapshot._sharedLock.lock()
+      BKConfigSnapshot._storesVersion += 1
+      BKConfigSnapshot._sharedLock.unlock()
+    }
+  }
+
+  static func current(reloadingStores: Bool = false) throws -> BKConfigSnapshot {
+    _ = _observers
+
+    _sharedLock.lock()
+    defer { _sharedLock.unlock() }
+
+    if let current = _current,
+       current._stamp.storesVersion == _storesVersion,
+       current._stamp.isCurrent() {
+      return current
+    }
+
+    if reloadingStores {
+      _sharedLock.unlock()
+      BKHosts.loadHosts()
+      BKPubKey.loadIDS()
+      _sharedLock.lock()
+    }
+
+    let snapshot = try BKConfigSnapshot(storesVersion: _storesVersion)
+    _current = snapshot
+    return snapshot
+  }
+
+  private init(storesVersion: Int) throws {
+    // Stamp the sources before reading them, so a change while compiling
+    // leaves the snapshot stale instead of missing it.
+    let url: URL = BlinkPaths.blinkGlobalSSHConfigFileURL()
+    _stamp = Stamp(storesVersion: storesVersion,
+                   files: Stamp.configFiles(from: url) + [BlinkPaths.blinkHostsFile(), BlinkPaths.blinkKeysFile()])
+
+    hosts = Dictionary(BKHosts.allHosts().map { ($0.host, $0) }, uniquingKeysWith: { first, _ in first })
+    identities = Dictionary(BKPubKey.all().map { ($0.id, $0) }, uniquingKeysWith: { first, _ in first })
+    _sshConfig = try SSHConfig.parse(url: url)
+  }
+
+  func resolve(alias: String) throws -> [String: Any] {
+    _lock.lock()
+    defer { _lock.unlock() }
+
+    if let config = _resolved[alias] {
+      return config
+    }
+    let config = try _sshConfig.resolve(alias: alias)
+    _resolved[alias] = config
+    return config
+  }
+
+  struct Stamp {
+    let storesVersion: Int
+    let files: [(path: String, modified: Date?)]
+
+    init(storesVersion: Int, files: [String]) {
+      self.storesVersion = storesVersion
+      self.files = files.map { ($0, Self.modificationDate($0)) }
+    }
+
+    func isCurrent() -> Bool {
+      files.allSatisfy { Self.modificationDate($0.path) == $0.modified }
+    }
+
+    static func modificationDate(_ path: String) -> Date? {
+      try? FileManager.default.attributesOfItem(atPath: path)[.modificationDate] as? Date
+    }
+
+    // The config file and everything it includes. Includes with wildcards are
+    // tracked by their directory, which changes when files are added or removed.
+    static func configFiles(from url: URL) -> [String] {
+      var files = [String]()
+      var pending = [url.path]
+
+      while let path = pending.popLast() {
+        guard !files.contains(path), files.count < 64 else {
+          continue
+        }
+        files.append(path)
+
+        guard let content = try? String(contentsOfFile: path) else {
+          continue
+        }
+        let dir = (path as NSString).deletingLastPathComponent
+        for line in content.split(whereSeparator: \.isNewline) {
+          let args = line.split(whereSeparator: { $0 == " " || $0 == "\t" })
+          guard args.first?.lowercased() == "include" else {
+            continue
+          }
+          for arg in args.dropFirst() {
+            var include = String(arg).trimmingCharacters(in: CharacterSet(charactersIn: "\""))
+            if include.hasPrefix("~/") {
+              include = (BlinkPaths.homePath() as NSString).appendingPathComponent(String(include.dropFirst(2)))
+            } else if !include.hasPrefix("/") {
+              include = (dir as NSString).appendingPathComponent(include)
+            }
+            include = (include as NSString).standardizingPath
+
+            if include.rangeOfCharacter(from: CharacterSet(charactersIn: "*?[")) != nil {
+              files.append((include as NSString).deletingLastPathComponent)
+            } else {
+              pending.append(include)
+            }
+          }
+        }
+      }
+
+      return files
+    }
+  }
+}
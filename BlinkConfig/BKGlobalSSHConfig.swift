@@ -69,7 +69,8 @@ public class BKGlobalSSHConfig: NSObject, NSSecureCoding {
       try config.add(alias: "*", cfg: [("User", self.user),
                                        ("ControlMaster", "auto"),
                                        ("SendEnv", "LANG"),
-                                       ("Compression", "yes"),
+                                       // Compression is left to each host, so it adapts to the link
+                                       // unless the user sets it.
                                        ("CompressionLevel", "6")])
    
       // Config does not currently allow for single lines
@@ -52,6 +52,9 @@ enum BKAgentForward {
   BKAgentForwardYes,
 };
 
+// Posted after the hosts are loaded or saved.
+extern NSString *const BKHostsDidChangeNotification;
+
 
 @interface BKHosts : NSObject <NSSecureCoding>
 
@@ -79,6 +82,8 @@ enum BKAgentForward {
 @property (nonatomic, strong) NSString *fpDomainsJSON;
 @property (nonatomic, strong) NSNumber *agentForwardPrompt;
 @property (nonatomic, strong) NSArray<NSString *> *agentForwardKeys;
+// Compression measured to suit the link on previous sessions. Kept on this device only.
+@property (nonatomic, strong) NSNumber *adaptiveCompression;
 
 + (instancetype)withHost:(NSString *)ID;
 + (void)loadHosts NS_SWIFT_NAME(loadHosts());
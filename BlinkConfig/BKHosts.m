@@ -38,12 +38,35 @@
 
 NSMutableArray *__hosts;
 
+NSString *const BKHostsDidChangeNotification = @"BKHostsDidChangeNotification";
+
+// Index of __hosts by alias. +all hands out the array to be modified in place,
+// so the index is rebuilt on the next lookup after it, or after a rename.
+// Lookups come from command threads and the sync handler at the same time, so the
+// index and its dirty flag are only touched within @synchronized(__hostsIndexLock).
+static NSMutableDictionary<NSString *, BKHosts *> *__hostsByAlias;
+static BOOL __hostsIndexDirty = YES;
+static NSObject *__hostsIndexLock;
+
+static void __invalidateHostsIndex() {
+  @synchronized (__hostsIndexLock) {
+    __hostsIndexDirty = YES;
+  }
+}
+
 static UICKeyChainStore *__get_keychain() {
   return [UICKeyChainStore keyChainStoreWithService:@"sh.blink.pwd"];
 }
 
 @implementation BKHosts
 
++ (void)initialize
+{
+  if (self == [BKHosts class]) {
+    __hostsIndexLock = [[NSObject alloc] init];
+  }
+}
+
 + (BOOL) supportsSecureCoding {
   return YES;
 }
@@ -80,6 +103,7 @@ static UICKeyChainStore *__get_keychain() {
   _fpDomainsJSON = [coder decodeObjectOfClasses:strings forKey:@"fpDomainsJSON"];
   _agentForwardPrompt = [coder decodeObjectOfClasses:numbers forKey:@"agentForwardPrompt"];
   _agentForwardKeys = [coder decodeArrayOfObjectsOfClass:NSString.class forKey:@"agentForwardKeys"];
+  _adaptiveCompression = [coder decodeObjectOfClasses:numbers forKey:@"adaptiveCompression"];
   return self;
 }
 
@@ -107,6 +131,7 @@ static UICKeyChainStore *__get_keychain() {
   [encoder encodeObject:_fpDomainsJSON forKey:@"fpDomainsJSON"];
   [encoder encodeObject:_agentForwardPrompt forKey:@"agentForwardPrompt"];
   [encoder encodeObject:_agentForwardKeys forKey:@"agentForwardKeys"];
+  [encoder encodeObject:_adaptiveCompression forKey:@"adaptiveCompression"];
 }
 
 - (id)initWithAlias:(NSString *)alias
@@ -164,6 +189,13 @@ sshConfigAttachment:(NSString *)sshConfigAttachment
   return self;
 }
 
+- (void)setHost:(NSString *)host
+{
+  _host = host;
+  // Renamed hosts move in the index.
+  __invalidateHostsIndex();
+}
+
 - (NSString *)password
 {
   if (!_passwordRef) {
@@ -175,12 +207,29 @@ sshConfigAttachment:(NSString *)sshConfigAttachment
 
 + (instancetype)withHost:(NSString *)aHost
 {
+  if (!aHost) {
+    return nil;
+  }
+  
+  @synchronized (__hostsIndexLock) {
+    if (__hostsIndexDirty) {
+      [self _indexHosts];
+    }
+    return __hostsByAlias[aHost];
+  }
+}
+
+// Call within the index lock.
++ (void)_indexHosts
+{
+  __hostsByAlias = [NSMutableDictionary dictionaryWithCapacity:__hosts.count];
   for (BKHosts *host in __hosts) {
-    if ([host->_host isEqualToString:aHost]) {
-      return host;
+    // First one wins, as the list is searched in order.
+    if (host->_host && !__hostsByAlias[host->_host]) {
+      __hostsByAlias[host->_host] = host;
     }
   }
-  return nil;
+  __hostsIndexDirty = NO;
 }
 
 + (instancetype)withiCloudId:(CKRecordID *)record
@@ -198,6 +247,7 @@ sshConfigAttachment:(NSString *)sshConfigAttachment
   if (!__hosts.count) {
     [BKHosts loadHosts];
   }
+  __invalidateHostsIndex();
   return __hosts;
 }
 
@@ -263,6 +313,11 @@ sshConfigAttachment:(NSString *)sshConfigAttachment
                            agentForwardKeys:agentForwardKeys
     ];
     [__hosts addObject:bkHost];
+    @synchronized (__hostsIndexLock) {
+      if (!__hostsIndexDirty && !__hostsByAlias[newHost]) {
+        __hostsByAlias[newHost] = bkHost;
+      }
+    }
   } else {
     bkHost.host = newHost;
     bkHost.hostName = hostName;
@@ -365,6 +420,7 @@ sshConfigAttachment:(NSString *)sshConfigAttachment
   }
   
   [self saveAllToSSHConfig];
+  [[NSNotificationCenter defaultCenter] postNotificationName:BKHostsDidChangeNotification object:nil];
 
   return result;
 }
@@ -383,6 +439,7 @@ sshConfigAttachment:(NSString *)sshConfigAttachment
 
 + (void)loadHosts {
   __hosts = [[NSMutableArray alloc] init];
+  __invalidateHostsIndex();
   
   NSError *error = nil;
   NSData *data = [NSData dataWithContentsOfFile:[BlinkPaths blinkHostsFile]
@@ -404,6 +461,8 @@ sshConfigAttachment:(NSString *)sshConfigAttachment
   }
   
   __hosts = [result mutableCopy];
+  __invalidateHostsIndex();
+  [[NSNotificationCenter defaultCenter] postNotificationName:BKHostsDidChangeNotification object:nil];
 }
 
 + (CKRecord *)recordFromHost:(BKHosts *)host
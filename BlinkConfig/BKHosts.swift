@@ -40,50 +40,119 @@ extension BKHosts {
     
     let hosts = BKHosts.allHosts() ?? []
     for h in hosts {
-      var cfg: [(String, Any)] = []
-      if let user = h.user, !user.isEmpty {
-        cfg.append(("User", user))
-      }
-      if let port = h.port {
-        cfg.append(("Port", port.intValue))
-      }
-      if let hostName = h.hostName, !hostName.isEmpty {
-        cfg.append(("HostName", hostName))
-      }
-      if let key = h.key, !key.isEmpty, key != "None" {
-        cfg.append(("IdentityFile", key))
-      }
-      if let proxyCmd = h.proxyCmd, !proxyCmd.isEmpty {
-        cfg.append(("ProxyCommand", proxyCmd))
-      }
-      if let proxyJump = h.proxyJump, !proxyJump.isEmpty {
-        cfg.append(("ProxyJump", proxyJump))
-      }
-      if let agentForwardPrompt = h.agentForwardPrompt,
-         agentForwardPrompt.intValue > 0 {
-        cfg.append(("ForwardAgent", "yes"))
-      }
-      if let sshConfigAttachment = h.sshConfigAttachment, !sshConfigAttachment.isEmpty {
-        sshConfigAttachment.split(whereSeparator: \.isNewline).forEach { line in
-          let components = line
-            .trimmingCharacters(in: .whitespaces)
-            .components(separatedBy: CharacterSet(charactersIn: " \t"))
-          if components.count >= 2,
-             components[0] != "#" {
-            cfg.append((components[0], components[1...].joined(separator: " ")))
-          }
+      try config.add(alias: h.host, cfg: h.sshConfigEntries())
+    }
+    
+    return config
+  }
+  
+  func sshConfigEntries() -> [(String, Any)] {
+    var cfg: [(String, Any)] = []
+    if let user = user, !user.isEmpty {
+      cfg.append(("User", user))
+    }
+    if let port = port {
+      cfg.append(("Port", port.intValue))
+    }
+    if let hostName = hostName, !hostName.isEmpty {
+      cfg.append(("HostName", hostName))
+    }
+    if let key = key, !key.isEmpty, key != "None" {
+      cfg.append(("IdentityFile", key))
+    }
+    if let proxyCmd = proxyCmd, !proxyCmd.isEmpty {
+      cfg.append(("ProxyCommand", proxyCmd))
+    }
+    if let proxyJump = proxyJump, !proxyJump.isEmpty {
+      cfg.append(("ProxyJump", proxyJump))
+    }
+    if let agentForwardPrompt = agentForwardPrompt,
+       agentForwardPrompt.intValue > 0 {
+      cfg.append(("ForwardAgent", "yes"))
+    }
+    if let sshConfigAttachment = sshConfigAttachment, !sshConfigAttachment.isEmpty {
+      sshConfigAttachment.split(whereSeparator: \.isNewline).forEach { line in
+        let components = line
+          .trimmingCharacters(in: .whitespaces)
+          .components(separatedBy: CharacterSet(charactersIn: " \t"))
+        if components.count >= 2,
+           components[0] != "#" {
+          cfg.append((components[0], components[1...].joined(separator: " ")))
         }
       }
+    }
+    return cfg
+  }
+  
+  // Host blocks rendered on the last save, by alias, with the entries they came
+  // from. Only hosts with different entries are rendered again.
+  private static var _sshConfigBlocks = [String: (entries: String, block: String)]()
+  private static var _savedSSHConfig: String? = nil
+  
+  // Renders the ssh_config body, reusing the blocks of unchanged hosts.
+  static func sshConfigString() throws -> String {
+    var blocks = [String]()
+    var rendered = [String: (entries: String, block: String)]()
+    
+    for h in BKHosts.allHosts() ?? [] {
+      let cfg = h.sshConfigEntries()
+      let entries = cfg.map { "\($0.0) \($0.1)" }.joined(separator: "\n")
       
-      try config.add(alias: h.host, cfg: cfg)
+      var block: String
+      if let cached = _sshConfigBlocks[h.host], cached.entries == entries {
+        block = cached.block
+      } else {
+        let config = SSHConfig()
+        try config.add(alias: h.host, cfg: cfg)
+        block = config.string()
+      }
+      rendered[h.host] = (entries, block)
+      blocks.append(block)
     }
     
-    return config
+    _sshConfigBlocks = rendered
+    return blocks.joined(separator: "\n")
+  }
+  
+  // Compression that suited the link to the host on previous sessions.
+  public static func adaptiveCompression(forHost host: String) -> Bool? {
+    BKHosts.withHost(host)?.adaptiveCompression?.boolValue
+  }
+  
+  // Only hosts with an entry keep the choice.
+  public static func setAdaptiveCompression(_ compression: Bool, forHost host: String) {
+    guard let bkHost = BKHosts.withHost(host),
+          bkHost.adaptiveCompression?.boolValue != compression else {
+      return
+    }
+    bkHost.adaptiveCompression = NSNumber(value: compression)
+    BKHosts.saveHosts()
+  }
+  
+  // Leave compression to the choice from previous sessions, or on as it was by
+  // default, when no configuration for the host sets it, including Host * and
+  // Includes. Returns whether the host adapts, so the choice can be recorded again.
+  public static func applyAdaptiveCompression(to host: inout BKSSHHost, alias: String) -> Bool {
+    guard host.compression == nil else {
+      return false
+    }
+    host.compression = adaptiveCompression(forHost: alias) ?? true
+    return true
   }
   
   @objc public static func saveAllToSSHConfig() {
     do {
-      let config = try sshConfig()
+      let config = try sshConfigString()
+      
+      guard let url = BlinkPaths.blinkSSHConfigFileURL() else {
+        return
+      }
+      // Leave the file and its date alone if no host block changed, so the
+      // configuration compiled from it stays valid.
+      if config == _savedSSHConfig,
+         FileManager.default.fileExists(atPath: url.path) {
+        return
+      }
       
       let configStr =
 """
@@ -93,12 +162,11 @@ extension BKHosts {
 # Use config command do configure your hosts
 # Or put your configuration to ~/.ssh/config
 
-\(config.string())
+\(config)
 """
 
       guard
-        let data = configStr.data(using: .utf8),
-        let url = BlinkPaths.blinkSSHConfigFileURL()
+        let data = configStr.data(using: .utf8)
       else {
         // TODO As this file is basically our own, we may want to report
         // errors during transformation by writing somewhere as well.
@@ -107,6 +175,7 @@ extension BKHosts {
       }
       
       try data.write(to: url)
+      _savedSSHConfig = config
       
     } catch {
       // TODO Throw and capture somewhere else.
@@ -42,6 +42,9 @@ typedef enum: NSUInteger {
   BKPubKeyStorageTypeDistributed, // Bunkr master key
 } BKPubKeyStorageType;
 
+// Posted after the identities are loaded or saved.
+extern NSString *const _Nonnull BKPubKeyDidChangeNotification;
+
 @interface BKPubKey : NSObject <NSSecureCoding, UIActivityItemSource>
 
 @property (nonnull) NSString *ID; // unique name of the key
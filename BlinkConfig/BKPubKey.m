@@ -47,6 +47,8 @@
 
 NSMutableArray *__identities;
 
+NSString *const BKPubKeyDidChangeNotification = @"BKPubKeyDidChangeNotification";
+
 const NSString * __keychainService = @"sh.blink.pkcard";
 
 static UICKeyChainStore *__get_keychain() {
@@ -109,6 +111,7 @@ static UICKeyChainStore *__get_keychain() {
     return NO;
   }
   
+  [[NSNotificationCenter defaultCenter] postNotificationName:BKPubKeyDidChangeNotification object:nil];
   return result;
 }
 
@@ -135,6 +138,7 @@ static UICKeyChainStore *__get_keychain() {
   }
   
   __identities = [result mutableCopy];
+  [[NSNotificationCenter defaultCenter] postNotificationName:BKPubKeyDidChangeNotification object:nil];
 }
 
 - (nullable instancetype)initWithID:(NSString *)ID
@@ -168,33 +168,33 @@ public extension BKPubKey {
 
 extension Collection where Element == BKPubKey {
   public func signerWithID(_ id: String) -> Signer? {
-    guard
-      let card = self.first(where: { $0.id == id }) //BKPubKey.withID(id)
-    else {
-      return nil
-    }
+    self.first(where: { $0.id == id })?.signer() //BKPubKey.withID(id)
+  }
+}
 
-    if card.storageType == BKPubKeyStorageTypeKeyChain {
+extension BKPubKey {
+  public func signer() -> Signer? {
+    if self.storageType == BKPubKeyStorageTypeKeyChain {
       guard
-        let privateKey = card.loadPrivateKey(),
+        let privateKey = self.loadPrivateKey(),
         let privateKeyBlob = SSHKey.sanitize(key: privateKey).data(using: .utf8)
       else {
         return nil
       }
       
-      let certBlob = card.loadCertificate()?.data(using: .utf8)
+      let certBlob = self.loadCertificate()?.data(using: .utf8)
       return try? SSHKey(fromFileBlob: privateKeyBlob, withPublicFileCertBlob: certBlob)
     }
     
-    if card.storageType == BKPubKeyStorageTypeSecureEnclave {
+    if self.storageType == BKPubKeyStorageTypeSecureEnclave {
       // TODO: Certs fro SEKey?
-      return SEKey(tagged: card.tag)
+      return SEKey(tagged: self.tag)
     }
     
-    if card.storageType == BKPubKeyStorageTypePlatformKey {
+    if self.storageType == BKPubKeyStorageTypePlatformKey {
       guard
-        let rawAttestationObject = card.rawAttestationObject,
-        let rpId = card.rpId
+        let rawAttestationObject = self.rawAttestationObject,
+        let rpId = self.rpId
       else {
         return nil
       }
@@ -202,10 +202,10 @@ extension Collection where Element == BKPubKey {
       return try? WebAuthnKey(rpId:rpId, rawAttestationObject: rawAttestationObject)
     }
     
-    if card.storageType == BKPubKeyStorageTypeSecurityKey {
+    if self.storageType == BKPubKeyStorageTypeSecurityKey {
       guard
-        let rawAttestationObject = card.rawAttestationObject,
-        let rpId = card.rpId
+        let rawAttestationObject = self.rawAttestationObject,
+        let rpId = self.rpId
       else {
         return nil
       }
@@ -218,3 +218,75 @@ extension Collection where Element == BKPubKey {
   
 
 }
+
+// Signers parsed from stored keys, reused by later connections until they have
+// not been used for five minutes, instead of reading and decoding each key
+// again. Keys that prompt are bound to the session using them and never kept.
+public final class BKSignerCache {
+  public static let shared = BKSignerCache()
+
+  let ttl: TimeInterval
+  private let makeSigner: (BKPubKey) -> Signer?
+
+  private struct Entry {
+    let fingerprint: String
+    let signer: Signer
+    var expires: Date
+  }
+
+  private var _entries = [String: Entry]()
+  private let _lock = NSLock()
+  private var _observer: NSObjectProtocol? = nil
+
+  init(ttl: TimeInterval = 5 * 60, makeSigner: @escaping (BKPubKey) -> Signer? = { $0.signer() }) {
+    self.ttl = ttl
+    self.makeSigner = makeSigner
+    _observer = NotificationCenter.default.addObserver(
+      forName: NSNotification.Name(BKPubKeyDidChangeNotification),
+      object: nil,
+      queue: nil
+    ) { [weak self] _ in
+      self?.removeAll()
+    }
+  }
+
+  deinit {
+    if let observer = _observer {
+      NotificationCenter.default.removeObserver(observer)
+    }
+  }
+
+  public func signer(for card: BKPubKey) -> Signer? {
+    // A key replaced under the same name does not match its previous entry.
+    let fingerprint = "\(card.storageType.rawValue):\(card.tag):\(card.publicKey)"
+    let now = Date()
+
+    _lock.lock()
+    if let entry = _entries[card.id], entry.fingerprint == fingerprint, entry.expires > now {
+      _entries[card.id]?.expires = now.addingTimeInterval(ttl)
+      _lock.unlock()
+      return entry.signer
+    }
+    _entries[card.id] = nil
+    _lock.unlock()
+
+    guard let signer = makeSigner(card) else {
+      return nil
+    }
+
+    if ttl > 0 && !(signer is InputPrompter) {
+      _lock.lock()
+      _entries = _entries.filter { $0.value.expires > now }
+      _entries[card.id] = Entry(fingerprint: fingerprint, signer: signer, expires: now.addingTimeInterval(ttl))
+      _lock.unlock()
+    }
+
+    return signer
+  }
+
+  public func removeAll() {
+    _lock.lock()
+    _entries.removeAll()
+    _lock.unlock()
+  }
+}
@@ -31,6 +31,7 @@
 
 
 import XCTest
+import SSH
 
 @testable import BlinkConfig
 
@@ -112,4 +113,58 @@ func testBKHostsToSSHConfig() throws {
     XCTAssert(env.contains("TERM") &&
               env.contains("LC*"), "List mapping failed")
   }
+
+  func testHostLookupAfterRename() throws {
+    let host = try XCTUnwrap(BKHosts.withHost(hostAlias))
+    host.host = "renamed"
+    XCTAssertNil(BKHosts.withHost(hostAlias))
+    XCTAssert(BKHosts.withHost("renamed") === host)
+
+    host.host = hostAlias
+    XCTAssert(BKHosts.withHost(hostAlias) === host)
+  }
+
+  func testConfigSnapshotIsSharedUntilHostsChange() throws {
+    let snapshot = try BKConfigSnapshot.current()
+    XCTAssert(try BKConfigSnapshot.current() === snapshot)
+    XCTAssertNotNil(snapshot.hosts[hostAlias])
+
+    BKHosts.saveHosts()
+    XCTAssert(try BKConfigSnapshot.current() !== snapshot)
+  }
+
+  func testSignerCache() throws {
+    var parsed = 0
+    let cache = BKSignerCache(ttl: 0.5) { _ in
+      parsed += 1
+      return try? SSHKey(type: .ed25519, bits: 256)
+    }
+    func card(tag: String) throws -> BKPubKey {
+      try XCTUnwrap(BKPubKey(id: "id_cached", tag: tag, publicKey: "ssh-ed25519 AAAA \(tag)", keyType: "ED25519",
+                             certType: nil, rawAttestationObject: nil, rpId: nil,
+                             storageType: BKPubKeyStorageTypeKeyChain))
+    }
+
+    // A hit returns the same signer without parsing the key again.
+    let first = try XCTUnwrap(cache.signer(for: try card(tag: "a")) as? SSHKey)
+    XCTAssert(cache.signer(for: try card(tag: "a")) as? SSHKey === first)
+    XCTAssertEqual(parsed, 1)
+
+    // A key replaced under the same name does not match the entry.
+    let replaced = try XCTUnwrap(cache.signer(for: try card(tag: "b")) as? SSHKey)
+    XCTAssert(replaced !== first)
+    XCTAssertEqual(parsed, 2)
+
+    // Entries expire once unused for the ttl.
+    Thread.sleep(forTimeInterval: 0.7)
+    XCTAssert(cache.signer(for: try card(tag: "b")) as? SSHKey !== replaced)
+    XCTAssertEqual(parsed, 3)
+
+    // Changes to the keys drop everything.
+    let current = try XCTUnwrap(cache.signer(for: try card(tag: "b")) as? SSHKey)
+    XCTAssertEqual(parsed, 3)
+    NotificationCenter.default.post(name: NSNotification.Name(BKPubKeyDidChangeNotification), object: nil)
+    XCTAssert(cache.signer(for: try card(tag: "b")) as? SSHKey !== current)
+    XCTAssertEqual(parsed, 4)
+  }
 }
@@ -38,14 +38,29 @@ import SSH
 class FileProviderEnumerator: NSObject, NSFileProviderEnumerator {
   let identifier: BlinkItemIdentifier
   let translator: AnyPublisher<Translator, Error>
+  let enumeratedItemIdentifier: NSFileProviderItemIdentifier
+  let domain: NSFileProviderDomain
   let cache: FileTranslatorCache
   var cancellableBag: Set<AnyCancellable> = []
-  var currentAnchor: Int = 0
   let log: BlinkLogger
+  // Items reported on each page. Pages map to batches of the remote listing.
+  let pageSize = 500
+  static let pagePrefix = "page:"
+  private var pager: DirectoryPager? = nil
+  private var localFilesAttributes: [String: FileAttributes] = [:]
+  // Names found by a listing that started from the first page. Once the listing is
+  // over, whatever the store has that is not here has been deleted.
+  private var seenNames: Set<String>? = nil
+  // Background listing to find changes on the remote.
+  private var refreshing: AnyCancellable? = nil
+  private var lastRefresh = Date.distantPast
+  let refreshInterval: TimeInterval = 30
 
   init(enumeratedItemIdentifier: NSFileProviderItemIdentifier,
        domain: NSFileProviderDomain,
        cache: FileTranslatorCache) {
+    self.enumeratedItemIdentifier = enumeratedItemIdentifier
+    self.domain = domain
     // TODO An enumerator may be requested for an open file, in order to enumerate changes to it.
     if enumeratedItemIdentifier == .rootContainer {
       self.identifier = BlinkItemIdentifier(domain.pathRelativeToDocumentStorage)
@@ -73,6 +88,9 @@ class FileProviderEnumerator: NSObject, NSFileProviderEnumerator {
     // Stop the enumeration
     self.log.debug("Invalidate")
     cancellableBag = []
+    pager?.cancel()
+    pager = nil
+    refreshing = nil
   }
 
   func enumerateItems(for observer: NSFileProviderEnumerationObserver, startingAt page: NSFileProviderPage) {
@@ -88,12 +106,92 @@ class FileProviderEnumerator: NSObject, NSFileProviderEnumerator {
      - inform the observer about the items returned by the server (possibly multiple times)
      - inform the observer that you are finished with this page
      */
-    self.log.info("Enumeration requested")
+    let pageIndex = Self.pageIndex(page)
+    self.log.info("Enumeration requested for page \(pageIndex)")
+
+    listingPager(startingAt: pageIndex)
+      .flatMap { pager in
+        // 2. Pull the next batch of remote items.
+        // For remote, if the file is a link, then stat to know the real attributes
+        pager.next()
+          .flatMap { batch -> AnyPublisher<[FileAttributes]?, Error> in
+            guard let batch = batch else {
+              return .just(nil)
+            }
+            return pager.container.isDirectory ?
+              pager.container.resolvingLinks(batch).map { Optional($0) }.eraseToAnyPublisher() :
+              .just(batch)
+          }
+      }
+      .map { remoteFilesAttributes -> [BlinkItemReference]? in
+        remoteFilesAttributes.map { self.references(for: $0) }
+      }
+      .sink(
+        receiveCompletion: { completion in
+          if case .failure(let error) = completion {
+            self.log.error("\(error)")
+            observer.finishEnumeratingWithError(error)
+          }
+        },
+        receiveValue: { references in
+          guard let references = references else {
+            self.log.info("Enumeration completed")
+            self.pager = nil
+            if let seenNames = self.seenNames {
+              self.cache.itemStore.finishListing(container: self.identifier, seen: seenNames)
+              self.seenNames = nil
+            }
+            self.lastRefresh = Date()
+            observer.finishEnumerating(upTo: nil)
+            return
+          }
+          self.log.info("Enumerated \(references.count) items")
+          observer.didEnumerate(references)
+          // The listing continues on the next page. We only know it is over when
+          // the next batch comes back empty.
+          observer.finishEnumerating(upTo: Self.page(pageIndex + 1))
+        }).store(in: &cancellableBag)
+  }
+
+  private func references(for remoteFilesAttributes: [FileAttributes]) -> [BlinkItemReference] {
+    // 3.1 Collect all current file references
+    return remoteFilesAttributes.map { attrs -> BlinkItemReference in
+      // 3.2 Match local and remote files, and upsert accordingly
+      let fileIdentifier = BlinkItemIdentifier(parentItemIdentifier: self.identifier,
+                                               filename: attrs[.name] as! String)
+      self.seenNames?.insert(fileIdentifier.filename)
+      // Find a local file that matches the remote.
+      let localAttrs = self.localFilesAttributes[fileIdentifier.filename]
+
+      if let reference = self.cache.reference(identifier: fileIdentifier) {
+        reference.updateAttributes(remote: attrs, local: localAttrs)
+        return reference
+      } else {
+        let ref = BlinkItemReference(fileIdentifier,
+                                     remote: attrs,
+                                     local: localAttrs,
+                                     cache: self.cache)
+
+        // Store the reference in the internal DB for later usage.
+        self.cache.store(reference: ref)
+        return ref
+      }
+    }
+  }
+
+  // Continue the current listing if the page follows it, or start a new one.
+  private func listingPager(startingAt pageIndex: Int) -> AnyPublisher<DirectoryPager, Error> {
+    if let pager = self.pager,
+       pager.nextPage == pageIndex {
+      return .just(pager)
+    }
+    self.pager?.cancel()
+    self.pager = nil
 
     // We use the local files and the representation of the remotes to construct the view of the system.
     // It is a simpler way to warm up the local cache without having a persistent representation.
     var containerTranslator: Translator!
-    translator
+    return translator
       .flatMap { t -> AnyPublisher<FileAttributes, Error> in
         containerTranslator = t
         return t.stat()
@@ -111,52 +209,42 @@ class FileProviderEnumerator: NSObject, NSFileProviderEnumerator {
         }
         return containerTranslator
       }
-      .flatMap {
-        // 2. Stat both local and remote files.
-        // For remote, if the file is a link, then stat to know the real attributes
-        Publishers.Zip($0.isDirectory ? $0.directoryFilesAndAttributesResolvingLinks() : AnyPublisher($0.stat().collect()),
-                         Local().walkTo(self.identifier.url.path)
-                        .flatMap { $0.isDirectory ? $0.directoryFilesAndAttributes() : AnyPublisher($0.stat().collect()) }
-                          .catch { _ in AnyPublisher.just([]) })
-      }
-      .map { (remoteFilesAttributes, localFilesAttributes) -> [BlinkItemReference] in
-        // 3.1 Collect all current file references
-        return remoteFilesAttributes.map { attrs -> BlinkItemReference in
-          // 3.2 Match local and remote files, and upsert accordingly
-          let fileIdentifier = BlinkItemIdentifier(parentItemIdentifier: self.identifier,
-                                                   filename: attrs[.name] as! String)
-          // Find a local file that matches the remote.
-          let localAttrs = localFilesAttributes.first(where: { $0[.name] as! String == fileIdentifier.filename })
-
-          if let reference = self.cache.reference(identifier: fileIdentifier) {
-            reference.updateAttributes(remote: attrs, local: localAttrs)
-            return reference
-          } else {
-            let ref = BlinkItemReference(fileIdentifier,
-                                         remote: attrs,
-                                         local: localAttrs,
-                                         cache: self.cache)
-
-            // Store the reference in the internal DB for later usage.
-            self.cache.store(reference: ref)
-            return ref
+      .flatMap { t in
+        Local().walkTo(self.identifier.url.path)
+          .flatMap { $0.isDirectory ? $0.directoryFilesAndAttributes() : AnyPublisher($0.stat().collect()) }
+          .catch { _ in AnyPublisher.just([]) }
+          .map { localFilesAttributes -> DirectoryPager in
+            // Index local files by name, so matching them with the remotes is a lookup.
+            self.localFilesAttributes = Dictionary(
+              localFilesAttributes.map { ($0[.name] as! String, $0) },
+              uniquingKeysWith: { first, _ in first }
+            )
+
+            let listing = t.isDirectory ?
+              t.directoryFilesAndAttributes(batchSize: self.pageSize) :
+              AnyPublisher(t.stat().collect())
+            let pager = DirectoryPager(listing, container: t, startingAt: pageIndex)
+            self.pager = pager
+            // Only a listing from the start can tell what is gone.
+            self.seenNames = (pageIndex == 0 && t.isDirectory) ? Set<String>() : nil
+            return pager
           }
-        }
       }
-      .sink(
-        receiveCompletion: { completion in
-        switch completion {
-          case .failure(let error):
-            self.log.error("\(error)")
-            observer.finishEnumeratingWithError(error)
-          case .finished:
-            observer.finishEnumerating(upTo: nil)
-          }
-        },
-        receiveValue: {
-          self.log.info("Enumerated \($0.count) items")
-          observer.didEnumerate($0)
-        }).store(in: &cancellableBag)
+      .eraseToAnyPublisher()
+  }
+
+  private static func pageIndex(_ page: NSFileProviderPage) -> Int {
+    // Initial pages are system defined. Anything else is a page we handed out.
+    guard let str = String(data: page.rawValue, encoding: .utf8),
+          str.hasPrefix(pagePrefix),
+          let idx = Int(str.dropFirst(pagePrefix.count)) else {
+      return 0
+    }
+    return idx
+  }
+
+  private static func page(_ idx: Int) -> NSFileProviderPage {
+    NSFileProviderPage("\(pagePrefix)\(idx)".data(using: .utf8)!)
   }
 
   func enumerateChanges(for observer: NSFileProviderChangeObserver, from anchor: NSFileProviderSyncAnchor) {
@@ -171,26 +259,90 @@ class FileProviderEnumerator: NSObject, NSFileProviderEnumerator {
      */
     // Schedule changes
 
-    let anchor = UInt(String(data: anchor.rawValue, encoding: .utf8)!)!
+    guard let anchorValue = String(data: anchor.rawValue, encoding: .utf8),
+          let anchor = UInt(anchorValue) else {
+      observer.finishEnumeratingWithError(NSFileProviderError(.syncAnchorExpired))
+      return
+    }
     self.log.info("Enumerating changes at \(anchor) anchor")
-    
-    guard let ref = self.cache.reference(identifier: self.identifier) else {
-      observer.finishEnumeratingWithError("Op not supported")
+
+    guard let changes = self.cache.itemStore.changes(container: self.identifier, since: anchor) else {
+      self.log.info("Anchor \(anchor) expired")
+      observer.finishEnumeratingWithError(NSFileProviderError(.syncAnchorExpired))
       return
     }
-    
-    if let updatedItems = self.cache.updatedItems(container: self.identifier, since: anchor) {
-      // Atm only update changes, no deletion as we don't provide tombstone values.
+
+    let updatedItems = changes.updated.compactMap {
+      self.cache.reference(identifier: BlinkItemIdentifier(parentItemIdentifier: self.identifier, filename: $0))
+    }
+    if !updatedItems.isEmpty {
       self.log.info("\(updatedItems.count) items updated.")
       observer.didUpdate(updatedItems)
-    } else if anchor < ref.syncAnchor {
-      observer.didUpdate([ref])
     }
-    
-    let newAnchor = ref.syncAnchor
-    let data = "\(newAnchor)".data(using: .utf8)
-    
+
+    if !changes.deleted.isEmpty {
+      self.log.info("\(changes.deleted.count) items deleted.")
+      observer.didDeleteItems(withIdentifiers: changes.deleted.map {
+        BlinkItemIdentifier(parentItemIdentifier: self.identifier, filename: $0).itemIdentifier
+      })
+    }
+
+    let data = "\(changes.anchor)".data(using: .utf8)
     observer.finishEnumeratingChanges(upTo: NSFileProviderSyncAnchor(data!), moreComing: false)
+
+    // The system only asks for changes once it has the items, so this is the chance to
+    // look for differences on the remote without a full enumeration.
+    refresh()
+  }
+
+  // List the remote in the background, and signal the system if anything changed,
+  // so the next change enumeration reports the differences.
+  private func refresh() {
+    guard refreshing == nil,
+          Date().timeIntervalSince(lastRefresh) > refreshInterval else {
+      return
+    }
+
+    let anchor = self.cache.itemStore.anchor(container: self.identifier)
+    var seen = Set<String>()
+
+    refreshing = translator
+      .flatMap { t -> AnyPublisher<[FileAttributes], Error> in
+        guard t.isDirectory else {
+          return .just([])
+        }
+        return t.directoryFilesAndAttributes(batchSize: self.pageSize)
+          .flatMap(maxPublishers: .max(1)) { t.resolvingLinks($0) }
+          .eraseToAnyPublisher()
+      }
+      .sink(
+        receiveCompletion: { completion in
+          self.refreshing = nil
+          self.lastRefresh = Date()
+          if case .failure(let error) = completion {
+            self.log.error("Refresh failed - \(error)")
+            return
+          }
+
+          self.cache.itemStore.finishListing(container: self.identifier, seen: seen)
+          if self.cache.itemStore.anchor(container: self.identifier) != anchor {
+            self.signalChanges()
+          }
+        },
+        receiveValue: { batch in
+          batch.forEach { seen.insert($0[.name] as! String) }
+          _ = self.references(for: batch)
+        })
+  }
+
+  private func signalChanges() {
+    guard let fpm = NSFileProviderManager(for: domain) else {
+      return
+    }
+
+    fpm.signalEnumerator(for: enumeratedItemIdentifier, completionHandler: { error in
+      self.log.info("Enumerator Signaled with \(error?.localizedDescription ?? "no error")")
+    })
   }
 
 
@@ -219,13 +371,91 @@ class FileProviderEnumerator: NSObject, NSFileProviderEnumerator {
   */
   func currentSyncAnchor(completionHandler: @escaping (NSFileProviderSyncAnchor?) -> Void) {
 
-    guard let ref = self.cache.reference(identifier: self.identifier) else {
-      completionHandler(nil)
-      return
-    }
-    self.log.info("Requested anchor \(ref.syncAnchor)")
+    let anchor = self.cache.itemStore.anchor(container: self.identifier)
+    self.log.info("Requested anchor \(anchor)")
 
-    let data = "\(ref.syncAnchor)".data(using: .utf8)
+    let data = "\(anchor)".data(using: .utf8)
     completionHandler(NSFileProviderSyncAnchor(data!))
   }
 }
+
+// Pulls one batch of a directory listing at a time, so each page of the enumeration only
+// holds its own items, and the remote listing only advances as the system requests pages.
+class DirectoryPager: Subscriber {
+  typealias Input = [FileAttributes]
+  typealias Failure = Error
+
+  let container: Translator
+  private(set) var nextPage: Int
+  private var subscription: Subscription? = nil
+  private var completion: Subscribers.Completion<Error>? = nil
+  private var promise: ((Result<[FileAttributes]?, Error>) -> Void)? = nil
+  private let queue = DispatchQueue(label: "DirectoryPager")
+
+  init(_ listing: AnyPublisher<[FileAttributes], Error>, container: Translator, startingAt page: Int) {
+    self.container = container
+    self.nextPage = page
+    // Skip the batches that were already reported on previous pages.
+    listing.dropFirst(page).subscribe(self)
+  }
+
+  // Next batch of the listing, or nil once it has been exhausted.
+  func next() -> AnyPublisher<[FileAttributes]?, Error> {
+    Future { promise in
+      self.queue.async {
+        if let completion = self.completion {
+          Self.resolve(promise, with: completion)
+          return
+        }
+        self.promise = promise
+        self.subscription?.request(.max(1))
+      }
+    }.eraseToAnyPublisher()
+  }
+
+  func cancel() {
+    queue.async {
+      self.subscription?.cancel()
+      self.subscription = nil
+    }
+  }
+
+  func receive(subscription: Subscription) {
+    queue.async {
+      self.subscription = subscription
+      if self.promise != nil {
+        subscription.request(.max(1))
+      }
+    }
+  }
+
+  func receive(_ input: [FileAttributes]) -> Subscribers.Demand {
+    queue.async {
+      self.nextPage += 1
+      self.promise?(.success(input))
+      self.promise = nil
+    }
+    return .none
+  }
+
+  func receive(completion: Subscribers.Completion<Error>) {
+    queue.async {
+      self.completion = completion
+      self.subscription = nil
+      if let promise = self.promise {
+        Self.resolve(promise, with: completion)
+        self.promise = nil
+      }
+    }
+  }
+
+  private static func resolve(_ promise: (Result<[FileAttributes]?, Error>) -> Void,
+                              with completion: Subscribers.Completion<Error>) {
+    switch completion {
+    case .finished:
+      promise(.success(nil))
+    case .failure(let error):
+      promise(.failure(error))
+    }
+  }
+}
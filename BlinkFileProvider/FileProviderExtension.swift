@@ -45,6 +45,7 @@ class FileProviderExtension: NSFileProviderExtension {
   var fileManager = FileManager()
   var cache = FileTranslatorCache()
   var cancellableBag: Set<AnyCancellable> = []
+  let uploader = FileUploader()
   let copyArguments = CopyArguments(inplace: true,
                                     preserve: [.permissions, .timestamp],
                                     checkTimes: true)
@@ -366,41 +367,37 @@ class FileProviderExtension: NSFileProviderExtension {
 
 
     // - create a fresh background NSURLSessionTask and schedule it to upload the current modifications
-    // 1. Translator for local target path
+    // Editors save often, so wait for the changes to settle before uploading.
     let localFileURLPath = url.path
-    let srcTranslator = Local().cloneWalkTo(localFileURLPath)
-
-    // 2. Translator for remote file path
     let itemIdentifier = blinkItemReference.itemIdentifier
-    let destTranslator = self.cache.rootTranslator(for: BlinkItemIdentifier(itemIdentifier))
-      .flatMap { $0.cloneWalkTo(BlinkItemIdentifier(blinkItemReference.parentItemIdentifier).path) }
-    
-    // 3. Upload
-    let c = destTranslator.flatMap { remotePathTranslator in
-        return srcTranslator.flatMap{ localFileTranslator -> CopyProgressInfoPublisher in
-          // 3. Start copy
-          return remotePathTranslator.copy(from: [localFileTranslator],
-                                           args: self.copyArguments)
-        }
-      }.sink { completion in
-        // 4. Update reference and notify
-        if case let .failure(error) = completion {
-          log.error("Upload failed \(localFileURLPath)- \(error)")
-          blinkItemReference.uploadCompleted(error)
+    uploader.schedule(itemIdentifier.rawValue) {
+      // 1. Translator for remote file path
+      let destTranslator = self.cache.rootTranslator(for: BlinkItemIdentifier(itemIdentifier))
+        .flatMap { $0.cloneWalkTo(BlinkItemIdentifier(blinkItemReference.parentItemIdentifier).path) }
+      
+      // 2. Upload
+      let c = destTranslator.flatMap { remotePathTranslator in
+          self.uploader.upload(localFileURLPath, to: remotePathTranslator, name: url.lastPathComponent)
+        }.sink { completion in
+          // 3. Update reference and notify
+          if case let .failure(error) = completion {
+            log.error("Upload failed \(localFileURLPath)- \(error)")
+            blinkItemReference.uploadCompleted(error)
+            
+            self.signalEnumerator(for: blinkItemReference.parentItemIdentifier)
+            return
+          }
           
+          blinkItemReference.uploadCompleted(nil)
           self.signalEnumerator(for: blinkItemReference.parentItemIdentifier)
-          return
-        }
-
-        blinkItemReference.uploadCompleted(nil)
-        self.signalEnumerator(for: blinkItemReference.parentItemIdentifier)
-
-        log.info("Upload completed \(localFileURLPath)")
-      } receiveValue: { _ in }
-    
-    blinkItemReference.uploadStarted(c)
-    
-    self.signalEnumerator(for: blinkItemReference.parentItemIdentifier)
+          
+          log.info("Upload completed \(localFileURLPath)")
+        } receiveValue: { _ in }
+      
+      blinkItemReference.uploadStarted(c)
+      
+      self.signalEnumerator(for: blinkItemReference.parentItemIdentifier)
+    }
   }
 
   override func createDirectory(withName directoryName: String,
@@ -508,52 +505,10 @@ class FileProviderExtension: NSFileProviderExtension {
       return
     }
 
-    let recursive = true
-
-    func delete(_ translators: [Translator]) -> AnyPublisher<Void, Error> {
-      translators.publisher
-        .flatMap(maxPublishers: .max(1)) { t -> AnyPublisher<Void, Error> in
-          print(t.current)
-          if t.fileType == .typeDirectory {
-            return [deleteDirectoryContent(t), AnyPublisher(t.rmdir().map {_ in})]
-              .compactMap { $0 }
-              .publisher
-              .flatMap(maxPublishers: .max(1)) { $0 }
-              .collect()
-              .map {_ in}
-              .eraseToAnyPublisher()
-          }
-
-          return AnyPublisher(t.remove().map { _ in })
-        }.eraseToAnyPublisher()
-    }
-
-    func deleteDirectoryContent(_ t: Translator) -> AnyPublisher<Void, Error>? {
-      if recursive == false {
-        return nil
-      }
-
-      return t.directoryFilesAndAttributes().flatMap {
-        $0.compactMap { i -> FileAttributes? in
-          if (i[.name] as! String) == "." || (i[.name] as! String) == ".." {
-            return nil
-          } else {
-            return i
-          }
-        }.publisher
-      }
-      .flatMap {
-        t.cloneWalkTo($0[.name] as! String) }
-      .collect()
-      .flatMap {
-        delete($0) }
-      .eraseToAnyPublisher()
-    }
-
     self.cache.rootTranslator(for: blinkItemIdentifier)
       .flatMap {
-        $0.cloneWalkTo(blinkItemIdentifier.path)
-          .flatMap { delete([$0]) }
+        $0.cloneWalkTo(entry: blinkItemIdentifier.path)
+          .flatMap { $0.removeTree() }
       }
       .sink(
         receiveCompletion: { completion in
@@ -41,7 +41,7 @@ import UniformTypeIdentifiers
 // Goal is to bridge the Identifier to the underlying BlinkFiles system, and to offer
 // Representations of the item.
 final class BlinkItemReference: NSObject {
-  private let identifier: BlinkItemIdentifier
+  let identifier: BlinkItemIdentifier
   var remote: BlinkFiles.FileAttributes?
   var local: BlinkFiles.FileAttributes?
   var parentItem: BlinkItemReference?
@@ -57,7 +57,7 @@ final class BlinkItemReference: NSObject {
   var isUploaded: Bool = false
   var uploadingError: Error? = nil
 
-  var syncAnchor: UInt = 0
+  private let itemStore: FileProviderItemStore
     
   // MARK: - Enumerator Entry Point:
   // Requires attributes. If you only have the Identifier, you need to go to the DB.
@@ -69,6 +69,7 @@ final class BlinkItemReference: NSObject {
     self.remote = remote
     self.identifier = itemIdentifier
     self.local = local
+    self.itemStore = cache.itemStore
 
     super.init()
     
@@ -83,14 +84,17 @@ final class BlinkItemReference: NSObject {
       self.local = local
     }
     evaluate()
-    updateSyncAnchor()
+    updateSyncAnchor(force: false)
   }
   
   // Sync anchor of the container is increased when an item inside it changes.
-  // The sync anchor for an item itself is the one that updated the parent.
-  private func updateSyncAnchor() {
-    self.parentItem?.syncAnchor += 1
-    self.syncAnchor = self.parentItem?.syncAnchor ?? self.syncAnchor + 1
+  // Attribute updates only count if they differ from the stored ones, while
+  // transfer state changes are always reported.
+  private func updateSyncAnchor(force: Bool = true) {
+    guard identifier.itemIdentifier != .rootContainer else {
+      return
+    }
+    itemStore.update(identifier, attributes: remote ?? primary, force: force)
   }
 
   private func evaluate() {
@@ -0,0 +1,283 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import CryptoKit
+import FileProvider
+import Foundation
+
+import BlinkFiles
+
+
+// On-disk store of the items the FileProvider has seen, so they survive extension restarts.
+// Items are kept per container, with the sync anchor at which each one last changed.
+// Items that disappear from a container become tombstones, so change enumerations
+// can report deletions and not just updates.
+final class FileProviderItemStore {
+  struct Item: Codable, Equatable {
+    var type: String?
+    var size: UInt64?
+    var permissions: Int16?
+    var modified: Date?
+    var created: Date?
+
+    init(_ attrs: FileAttributes) {
+      self.type = (attrs[.type] as? FileAttributeType)?.rawValue
+      self.size = (attrs[.size] as? NSNumber)?.uint64Value
+      self.permissions = (attrs[.posixPermissions] as? NSNumber)?.int16Value
+      self.modified = attrs[.modificationDate] as? Date
+      self.created = attrs[.creationDate] as? Date
+    }
+
+    func attributes(name: String) -> FileAttributes {
+      var attrs: FileAttributes = [.name: name]
+      if let type = type {
+        attrs[.type] = FileAttributeType(rawValue: type)
+      }
+      if let size = size {
+        attrs[.size] = NSNumber(value: size)
+      }
+      if let permissions = permissions {
+        attrs[.posixPermissions] = NSNumber(value: permissions)
+      }
+      if let modified = modified {
+        attrs[.modificationDate] = modified
+      }
+      if let created = created {
+        attrs[.creationDate] = created
+      }
+      return attrs
+    }
+  }
+
+  struct Entry: Codable {
+    var item: Item
+    var anchor: UInt
+  }
+
+  struct Container: Codable {
+    var anchor: UInt = 0
+    var entries: [String: Entry] = [:]
+    // Deleted item names, with the anchor at which they were deleted.
+    var tombstones: [String: UInt] = [:]
+    // Anchors below this one cannot be enumerated anymore, as their tombstones were dropped.
+    var oldestAnchor: UInt = 0
+  }
+
+  struct Changes {
+    let updated: [String]
+    let deleted: [String]
+    let anchor: UInt
+  }
+
+  let url: URL
+  let maxTombstones = 1000
+  private var containers: [String: Container] = [:]
+  private var dirty = Set<String>()
+  private let queue = DispatchQueue(label: "FileProviderItemStore")
+  private let saveQueue = DispatchQueue(label: "FileProviderItemStore.save")
+
+  init(at url: URL) {
+    self.url = url
+    try? FileManager.default.createDirectory(at: url, withIntermediateDirectories: true, attributes: nil)
+  }
+
+  static let `default`: FileProviderItemStore = {
+    let storageURL = NSFileProviderManager.default.documentStorageURL
+    return FileProviderItemStore(at: storageURL.deletingLastPathComponent().appendingPathComponent("Item Store"))
+  }()
+
+  func attributes(for identifier: BlinkItemIdentifier) -> FileAttributes? {
+    let (key, name) = Self.location(identifier)
+    guard !name.isEmpty else {
+      return nil
+    }
+    return queue.sync {
+      loadContainer(key).entries[name]?.item.attributes(name: name)
+    }
+  }
+
+  func anchor(container: BlinkItemIdentifier) -> UInt {
+    queue.sync { loadContainer(Self.key(container)).anchor }
+  }
+
+  // Upsert the item. The anchor only moves if the attributes changed, or if forced
+  // because some other state of the item (like a transfer) changed.
+  @discardableResult
+  func update(_ identifier: BlinkItemIdentifier, attributes: FileAttributes, force: Bool = false) -> Bool {
+    let (key, name) = Self.location(identifier)
+    guard !name.isEmpty else {
+      return false
+    }
+    let item = Item(attributes)
+
+    return queue.sync {
+      var container = loadContainer(key)
+      if !force, let entry = container.entries[name], entry.item == item {
+        return false
+      }
+      container.anchor += 1
+      container.entries[name] = Entry(item: item, anchor: container.anchor)
+      container.tombstones.removeValue(forKey: name)
+      store(container, at: key)
+      return true
+    }
+  }
+
+  func remove(_ identifier: BlinkItemIdentifier) {
+    let (key, name) = Self.location(identifier)
+    guard !name.isEmpty else {
+      return
+    }
+
+    queue.sync {
+      var container = loadContainer(key)
+      guard container.entries.removeValue(forKey: name) != nil else {
+        return
+      }
+      container.anchor += 1
+      container.tombstones[name] = container.anchor
+      store(container, at: key)
+    }
+    // Anything below a removed directory goes with it.
+    removeContainer(identifier)
+  }
+
+  // A full listing of the container has completed. Items not seen on it are gone.
+  func finishListing(container identifier: BlinkItemIdentifier, seen names: Set<String>) {
+    let key = Self.key(identifier)
+    var removed = [String]()
+
+    queue.sync {
+      var container = loadContainer(key)
+      removed = container.entries.keys.filter { !names.contains($0) }
+      guard !removed.isEmpty else {
+        return
+      }
+      container.anchor += 1
+      for name in removed {
+        container.entries.removeValue(forKey: name)
+        container.tombstones[name] = container.anchor
+      }
+      store(container, at: key)
+    }
+
+    removed.forEach {
+      removeContainer(BlinkItemIdentifier(parentItemIdentifier: identifier, filename: $0))
+    }
+  }
+
+  // Changes within the container since the anchor, or nil if the anchor is too old
+  // to know what was deleted since then.
+  func changes(container identifier: BlinkItemIdentifier, since anchor: UInt) -> Changes? {
+    queue.sync {
+      let container = loadContainer(Self.key(identifier))
+      if anchor < container.oldestAnchor || anchor > container.anchor {
+        return nil
+      }
+      return Changes(updated: container.entries.filter { $0.value.anchor > anchor }.map { $0.key },
+                     deleted: container.tombstones.filter { $0.value > anchor }.map { $0.key },
+                     anchor: container.anchor)
+    }
+  }
+
+  private func removeContainer(_ identifier: BlinkItemIdentifier) {
+    let key = Self.key(identifier)
+    queue.sync {
+      containers.removeValue(forKey: key)
+      dirty.remove(key)
+    }
+    saveQueue.async {
+      try? FileManager.default.removeItem(at: self.fileURL(key))
+    }
+  }
+
+  private func loadContainer(_ key: String) -> Container {
+    if let container = containers[key] {
+      return container
+    }
+    var container = Container()
+    if let data = try? Data(contentsOf: fileURL(key)),
+       let stored = try? PropertyListDecoder().decode(Container.self, from: data) {
+      container = stored
+    }
+    containers[key] = container
+    return container
+  }
+
+  private func store(_ container: Container, at key: String) {
+    var container = container
+    if container.tombstones.count > maxTombstones {
+      // Drop the oldest tombstones. Enumerations from before them have to start over.
+      let sorted = container.tombstones.sorted { $0.value < $1.value }
+      let drop = sorted.prefix(container.tombstones.count - maxTombstones)
+      drop.forEach { container.tombstones.removeValue(forKey: $0.key) }
+      container.oldestAnchor = (drop.last?.value ?? container.oldestAnchor)
+    }
+    containers[key] = container
+    scheduleSave(key)
+  }
+
+  // Coalesce writes, as enumerations update many items in a row.
+  private func scheduleSave(_ key: String) {
+    guard !dirty.contains(key) else {
+      return
+    }
+    dirty.insert(key)
+    saveQueue.asyncAfter(deadline: .now() + 1) {
+      let container: Container? = self.queue.sync {
+        self.dirty.remove(key)
+        return self.containers[key]
+      }
+      guard let container = container,
+            let data = try? PropertyListEncoder().encode(container) else {
+        return
+      }
+      try? data.write(to: self.fileURL(key), options: .atomic)
+    }
+  }
+
+  private func fileURL(_ key: String) -> URL {
+    let digest = Insecure.SHA1.hash(data: Data(key.utf8))
+    let name = digest.map { String(format: "%02x", $0) }.joined()
+    return url.appendingPathComponent(name)
+  }
+
+  private static func key(_ container: BlinkItemIdentifier) -> String {
+    "\(container.encodedRootPath)/\(container.path)"
+  }
+
+  // Container key and name of the item within it.
+  private static func location(_ identifier: BlinkItemIdentifier) -> (String, String) {
+    let parentPath = (identifier.path as NSString).deletingLastPathComponent
+    return ("\(identifier.encodedRootPath)/\(parentPath)", identifier.filename)
+  }
+}
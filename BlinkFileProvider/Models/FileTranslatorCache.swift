@@ -65,9 +65,12 @@ final class FileTranslatorCache {
   //static let shared = FileTranslatorCache()
   private var translators: [String: TranslatorControl] = [:]
   private var references: [String: BlinkItemReference] = [:]
-  private var fileList = [String: [BlinkItemReference]]()
+  // Persistent view of the items, used to answer for them after a restart and to track changes.
+  let itemStore: FileProviderItemStore
 
-  init() {}
+  init(itemStore: FileProviderItemStore = .default) {
+    self.itemStore = itemStore
+  }
 
   func rootTranslator(for identifier: BlinkItemIdentifier) -> AnyPublisher<Translator, Error> {
     let encodedRootPath = identifier.encodedRootPath
@@ -135,22 +138,31 @@ final class FileTranslatorCache {
     print("storing File BlinkItemReference : \(reference.itemIdentifier.rawValue)")
     self.references[reference.itemIdentifier.rawValue] = reference
     if reference.itemIdentifier != .rootContainer {
-      if var list = self.fileList[reference.parentItemIdentifier.rawValue] {
-        list.append(reference)
-        self.fileList[reference.parentItemIdentifier.rawValue] = list
-      } else {
-        self.fileList[reference.parentItemIdentifier.rawValue] = [reference]
-      }
+      itemStore.update(reference.identifier, attributes: reference.remote ?? reference.primary)
     }
   }
   
   func remove(reference: BlinkItemReference) {
     self.references.removeValue(forKey: reference.itemIdentifier.rawValue)
+    itemStore.remove(reference.identifier)
   }
 
   func reference(identifier: BlinkItemIdentifier) -> BlinkItemReference? {
     print("requesting File BlinkItemReference : \(identifier.itemIdentifier.rawValue)")
-    return self.references[identifier.itemIdentifier.rawValue]
+    if let reference = self.references[identifier.itemIdentifier.rawValue] {
+      return reference
+    }
+
+    // Rebuild the reference from the store, as it may come from a previous run.
+    guard let remote = itemStore.attributes(for: identifier) else {
+      return nil
+    }
+    var local = try? FileManager.default.attributesOfItem(atPath: identifier.url.path)
+    local?[.name] = identifier.filename
+
+    let reference = BlinkItemReference(identifier, remote: remote, local: local, cache: self)
+    self.references[identifier.itemIdentifier.rawValue] = reference
+    return reference
   }
 
   func reference(url: URL) -> BlinkItemReference? {
@@ -170,12 +182,6 @@ final class FileTranslatorCache {
 
     return self.references[String(cleanPath)]
   }
-  
-  func updatedItems(container: BlinkItemIdentifier, since anchor: UInt) -> [BlinkItemReference]? {
-    self.fileList[container.itemIdentifier.rawValue]?.filter {
-      anchor < $0.syncAnchor
-    }
-  }
 }
 
 
@@ -183,16 +189,15 @@ class SSHClientConfigProvider {
   
   static func config(host title: String) throws -> (String, SSHClientConfig) {
    
-    // NOTE This is just regular config initialization. Usually happens on AppDelegate, but the
-    // FileProvider doesn't get another chance.
-    BKHosts.loadHosts()
-    BKPubKey.loadIDS()
-    
-    let bkConfig = try BKConfig()
+    // NOTE The stores are usually loaded on AppDelegate, but the FileProvider doesn't
+    // get another chance. They are reloaded only when the app changed them.
+    let bkConfig = try BKConfig(reloadingStores: true)
     let agent = SSHAgent()
     let consts: [SSHAgentConstraint] = [SSHConstraintTrustedConnectionOnly()]
 
-    let host = try bkConfig.bkSSHHost(title)
+    var host = try bkConfig.bkSSHHost(title)
+    // The choice is recorded by the app, which owns the hosts.
+    _ = BKHosts.applyAdaptiveCompression(to: &host, alias: title)
     
     if let signers = bkConfig.signer(forHost: host) {
       signers.forEach { (signer, name) in
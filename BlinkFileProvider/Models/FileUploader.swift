@@ -0,0 +1,301 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+import Combine
+import CryptoKit
+import Foundation
+
+import BlinkFiles
+
+
+// Uploads the local changes of provided items. Bursts of changes are coalesced,
+// and a file this provider uploaded before only sends the blocks that changed
+// since. Those blocks are written in place, so while a patch runs, or if it is
+// interrupted, the remote file mixes old and new blocks. Any other upload is
+// written under a temporary name and renamed over the original, so the remote
+// never holds half of it.
+// Uploads work on a snapshot of the local file, as the editor may still write it
+// meanwhile, and stream it block by block, as the extension has little memory.
+final class FileUploader {
+  static let blockSize = 256 * 1024
+
+  // What the last upload left at a remote path.
+  struct Uploaded {
+    let size: Int
+    let modified: TimeInterval
+    let hashes: [Data]
+  }
+
+  struct UploadError: Error {
+    let msg: String
+  }
+
+  let debounce: DispatchTimeInterval
+  private let _queue = DispatchQueue(label: "sh.blink.fileprovider.uploader")
+  private var _pending = [String: DispatchWorkItem]()
+  private var _uploaded = [String: Uploaded]()
+  private let _snapshots = FileManager.default.temporaryDirectory.appendingPathComponent("Uploads")
+
+  init(debounce: DispatchTimeInterval = .seconds(2)) {
+    self.debounce = debounce
+  }
+
+  // Runs the upload once no other change for the same key arrives within the window.
+  func schedule(_ key: String, _ upload: @escaping () -> Void) {
+    _queue.async {
+      self._pending[key]?.cancel()
+      let work = DispatchWorkItem {
+        self._pending[key] = nil
+        DispatchQueue.global(qos: .utility).async(execute: upload)
+      }
+      self._pending[key] = work
+      self._queue.asyncAfter(deadline: .now() + self.debounce, execute: work)
+    }
+  }
+
+  func upload(_ localPath: String, to directory: Translator, name: String) -> AnyPublisher<Void, Error> {
+    let remotePath = (directory.current as NSString).appendingPathComponent(name)
+
+    // A copy of the file is private to the upload, so it can be mapped and read while
+    // the original is truncated or rewritten. On APFS it is a clone, not a second copy.
+    let snapshot = _snapshots.appendingPathComponent(UUID().uuidString).path
+    let hashes: [Data]
+    let size: Int
+    let localAttributes: FileAttributes
+    do {
+      try FileManager.default.createDirectory(at: _snapshots, withIntermediateDirectories: true)
+      localAttributes = try FileManager.default.attributesOfItem(atPath: localPath)
+      try FileManager.default.copyItem(atPath: localPath, toPath: snapshot)
+      let content = try Data(contentsOf: URL(fileURLWithPath: snapshot), options: .alwaysMapped)
+      hashes = Self.hashes(content)
+      size = content.count
+    } catch {
+      try? FileManager.default.removeItem(atPath: snapshot)
+      return .fail(error: error)
+    }
+
+    let modified = localAttributes[.modificationDate] as? Date ?? Date()
+    var attributes: FileAttributes = [.modificationDate: modified]
+    attributes[.posixPermissions] = localAttributes[.posixPermissions]
+
+    let record = Uploaded(size: size,
+                          modified: floor(modified.timeIntervalSince1970),
+                          hashes: hashes)
+    // Forget the previous upload while this one runs, it may leave anything behind.
+    let previous = _queue.sync { _uploaded.removeValue(forKey: remotePath) }
+
+    let replace = Deferred {
+      self.replace(name, in: directory, from: snapshot, attributes: attributes)
+    }
+
+    let upload: AnyPublisher<Void, Error>
+    if let previous = previous,
+       let ranges = Self.changedRanges(from: previous, to: hashes, size: size) {
+      upload = directory.cloneWalkTo(name)
+        .flatMap { file in
+          file.stat().tryMap { remote -> Translator in
+            // Only patch the file as the previous upload left it.
+            guard
+              let size = remote[.size] as? NSNumber, size.intValue == previous.size,
+              let date = remote[.modificationDate] as? Date,
+              floor(date.timeIntervalSince1970) == previous.modified
+            else {
+              throw UploadError(msg: "Remote file changed")
+            }
+            return file
+          }
+        }
+        .flatMap { file in
+          self.patch(file, ranges: ranges, from: snapshot)
+            .flatMap { file.wstat(attributes) }
+        }
+        .map { _ in () }
+        .catch { _ in replace }
+        .eraseToAnyPublisher()
+    } else {
+      upload = replace.eraseToAnyPublisher()
+    }
+
+    return upload
+      .handleEvents(receiveCompletion: { completion in
+        try? FileManager.default.removeItem(atPath: snapshot)
+        if case .finished = completion {
+          self._queue.async { self._uploaded[remotePath] = record }
+        }
+      }, receiveCancel: {
+        try? FileManager.default.removeItem(atPath: snapshot)
+      })
+      .eraseToAnyPublisher()
+  }
+
+  private func openLocal(_ path: String) -> AnyPublisher<File, Error> {
+    Local().cloneWalkTo(path).flatMap { $0.open(flags: O_RDONLY) }.eraseToAnyPublisher()
+  }
+
+  // Writes the changed ranges in place, one block at a time.
+  private func patch(_ translator: Translator, ranges: [Range<Int>], from localPath: String) -> AnyPublisher<Void, Error> {
+    let blocks = ranges.flatMap { range in
+      stride(from: range.lowerBound, to: range.upperBound, by: Self.blockSize).map {
+        $0..<min($0 + Self.blockSize, range.upperBound)
+      }
+    }
+
+    return openLocal(localPath)
+      .flatMap { local -> AnyPublisher<Bool, Error> in
+        translator.open(flags: O_WRONLY)
+          .flatMap { file -> AnyPublisher<Void, Error> in
+            guard let seeker = file as? Seeker, let localSeeker = local as? Seeker else {
+              return file.close()
+                .tryMap { _ in throw UploadError(msg: "Ranged writes not supported") }
+                .eraseToAnyPublisher()
+            }
+
+            return blocks.publisher
+              .setFailureType(to: Error.self)
+              .flatMap(maxPublishers: .max(1)) { block -> AnyPublisher<Int, Error> in
+                do {
+                  try localSeeker.seek(to: UInt64(block.lowerBound))
+                  try seeker.seek(to: UInt64(block.lowerBound))
+                } catch {
+                  return .fail(error: error)
+                }
+                return local.read(max: block.count)
+                  .flatMap { data in file.write(data, max: data.count) }
+                  .reduce(0, +)
+                  .eraseToAnyPublisher()
+              }
+              .collect()
+              .flatMap { _ in file.close() }
+              .tryCatch { error in
+                file.close().tryMap { _ -> Bool in throw error }
+              }
+              .map { _ in () }
+              .eraseToAnyPublisher()
+          }
+          .flatMap { _ in local.close() }
+          .tryCatch { error in
+            local.close().tryMap { _ -> Bool in throw error }
+          }
+          .eraseToAnyPublisher()
+      }
+      .map { _ in () }
+      .eraseToAnyPublisher()
+  }
+
+  // Streams the whole content next to the file, then renames it over.
+  private func replace(_ name: String,
+                       in directory: Translator,
+                       from localPath: String,
+                       attributes: FileAttributes) -> AnyPublisher<Void, Error> {
+    let tempName = ".\(name).blink-upload"
+
+    return directory.clone().create(name: tempName, flags: O_WRONLY | O_TRUNC, mode: S_IRUSR | S_IWUSR)
+      .flatMap { file -> AnyPublisher<Bool, Error> in
+        self.openLocal(localPath)
+          .flatMap { local -> AnyPublisher<Bool, Error> in
+            (local as! WriterTo).writeTo(file)
+              .reduce(0, +)
+              .flatMap { _ in local.close() }
+              .tryCatch { error in
+                local.close().tryMap { _ -> Bool in throw error }
+              }
+              .eraseToAnyPublisher()
+          }
+          .flatMap { _ in file.close() }
+          .tryCatch { error in
+            file.close().tryMap { _ -> Bool in throw error }
+          }
+          .eraseToAnyPublisher()
+      }
+      .flatMap { _ in directory.cloneWalkTo(tempName) }
+      .flatMap { temp in
+        temp.wstat(attributes)
+          .flatMap { _ in self.rename(temp, over: name, in: directory) }
+      }
+      .eraseToAnyPublisher()
+  }
+
+  // SFTPv3 servers refuse to rename over an existing file. moveTree then replaces it
+  // on the remote side, which is a POSIX rename. Without that, the original is
+  // moved aside and only removed once the new file is in place.
+  private func rename(_ temp: Translator, over name: String, in directory: Translator) -> AnyPublisher<Void, Error> {
+    let backupName = ".\(name).blink-backup"
+
+    let swap = directory.cloneWalkTo(name)
+      .flatMap { $0.wstat([.name: backupName]) }
+      .flatMap { _ in
+        temp.wstat([.name: name])
+          .catch { error in
+            // Put the original back.
+            directory.cloneWalkTo(backupName)
+              .flatMap { $0.wstat([.name: name]) }
+              .tryMap { _ -> Bool in throw error }
+          }
+      }
+      .flatMap { _ in directory.cloneWalkTo(backupName) }
+      .flatMap { $0.remove() }
+      .map { _ in () }
+
+    return temp.moveTree(to: name)
+      .catch { _ in swap }
+      .eraseToAnyPublisher()
+  }
+
+  static func hashes(_ content: Data) -> [Data] {
+    stride(from: 0, to: content.count, by: blockSize).map { offset in
+      Data(SHA256.hash(data: content[offset..<min(offset + blockSize, content.count)]))
+    }
+  }
+
+  // Ranges of the new content to write over the previous upload, or nil if
+  // it is not worth patching.
+  static func changedRanges(from previous: Uploaded, to hashes: [Data], size: Int) -> [Range<Int>]? {
+    // A shorter file would need a truncate.
+    guard size >= previous.size else {
+      return nil
+    }
+
+    var ranges = [Range<Int>]()
+    for (idx, hash) in hashes.enumerated() where idx >= previous.hashes.count || previous.hashes[idx] != hash {
+      let range = (idx * blockSize)..<min((idx + 1) * blockSize, size)
+      if let last = ranges.last, last.upperBound == range.lowerBound {
+        ranges[ranges.count - 1] = last.lowerBound..<range.upperBound
+      } else {
+        ranges.append(range)
+      }
+    }
+
+    let changed = ranges.reduce(0) { $0 + $1.count }
+    return changed > size / 2 ? nil : ranges
+  }
+}
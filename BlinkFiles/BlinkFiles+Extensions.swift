@@ -37,6 +37,16 @@ public extension Translator {
     let t = self.clone()
     return t.walkTo(path)
   }
+
+  // Walks to the path without following it if it is a link. Translators whose walk
+  // does not resolve links already do so.
+  func cloneWalkTo(entry path: String) -> AnyPublisher<Translator, Error> {
+    let t = self.clone()
+    guard let walker = t as? EntryWalker else {
+      return t.walkTo(path)
+    }
+    return walker.walkTo(entry: path)
+  }
 }
 
 extension Translator {
@@ -78,23 +88,47 @@ extension Translator {
 extension Translator {
   public func directoryFilesAndAttributesResolvingLinks() -> AnyPublisher<[FileAttributes], Error> {
     directoryFilesAndAttributes()
-      .flatMap { filesAttributes -> AnyPublisher<[FileAttributes], Never> in
-        filesAttributes.publisher
-          .flatMap { attrs -> AnyPublisher<FileAttributes, Never> in
-            guard let type = attrs[.type] as? FileAttributeType,
-                  let name = attrs[.name] as? String,
-                  type == .typeSymbolicLink else {
-              return .just(attrs)
-            }
-
-            return cloneWalkTo(name)
-              .flatMap { $0.stat() }
-              .catch { _ in Just(attrs) }
-              .eraseToAnyPublisher()
-          }.map { $0 }
-          .collect()
+      .flatMap { resolvingLinks($0) }
+      .eraseToAnyPublisher()
+  }
+
+  // Replace the attributes of symbolic links within the current directory with the ones from their targets.
+  public func resolvingLinks(_ filesAttributes: [FileAttributes]) -> AnyPublisher<[FileAttributes], Error> {
+    if let resolver = self as? LinkResolver {
+      return resolver.resolvingLinks(filesAttributes)
+    }
+
+    return filesAttributes.publisher
+      .flatMap { attrs -> AnyPublisher<FileAttributes, Never> in
+        guard let type = attrs[.type] as? FileAttributeType,
+              let name = attrs[.name] as? String,
+              type == .typeSymbolicLink else {
+          return .just(attrs)
+        }
+
+        return cloneWalkTo(name)
+          .flatMap { $0.stat() }
+          .catch { _ in Just(attrs) }
           .eraseToAnyPublisher()
-      }.eraseToAnyPublisher()
+      }.map { $0 }
+      .collect()
+      .setFailureType(to: Error.self)
+      .eraseToAnyPublisher()
+  }
+
+  // List the directory in batches of the given size, streaming them when the Translator supports it.
+  public func directoryFilesAndAttributes(batchSize: Int) -> AnyPublisher<[FileAttributes], Error> {
+    if let streamer = self as? DirectoryStreamer {
+      return streamer.directoryFilesAndAttributes(batchSize: batchSize)
+    }
+
+    return directoryFilesAndAttributes()
+      .flatMap { filesAttributes in
+        stride(from: 0, to: filesAttributes.count, by: batchSize)
+          .map { Array(filesAttributes[$0..<min($0 + batchSize, filesAttributes.count)]) }
+          .publisher
+      }
+      .eraseToAnyPublisher()
   }
 
   public func mkdir(name: String) -> AnyPublisher<Translator, Error> {
@@ -110,3 +144,86 @@ extension Translator {
       }.eraseToAnyPublisher()
   }
 }
+
+extension Translator {
+  // Removes the object, and everything under it if it is a directory. When the
+  // Translator cannot do it on its side, the tree is walked a directory at a
+  // time, handing up to maxConcurrent of its files to remove(). Whether those
+  // overlap depends on the Translator, SFTP removes are one round-trip each.
+  // Reach the object with cloneWalkTo(entry:), so a link is removed and not its target.
+  public func removeTree(maxConcurrent: Int = 16) -> AnyPublisher<Void, Error> {
+    guard let treeOperator = treeOperator else {
+      return removeEntries(maxConcurrent: maxConcurrent)
+    }
+
+    return treeOperator.removeTree()
+      .catch { _ in self.removeEntries(maxConcurrent: maxConcurrent) }
+      .eraseToAnyPublisher()
+  }
+
+  // Decorators only operate on trees when the Translator they wrap does.
+  fileprivate var treeOperator: TreeOperator? {
+    if let caching = self as? CachingTranslator {
+      return caching.wrappedTreeOperator
+    }
+    return self as? TreeOperator
+  }
+
+  fileprivate func removeEntries(maxConcurrent: Int) -> AnyPublisher<Void, Error> {
+    guard fileType == .typeDirectory else {
+      return remove().map { _ in () }.eraseToAnyPublisher()
+    }
+
+    return directoryFilesAndAttributes()
+      .flatMap { filesAttributes -> AnyPublisher<Void, Error> in
+        let entries = filesAttributes.filter {
+          let name = $0[.name] as? String
+          return name != nil && name != "." && name != ".."
+        }
+        let isDirectory = { (attrs: FileAttributes) in
+          (attrs[.type] as? FileAttributeType) == .typeDirectory
+        }
+
+        // Listings may report links with the type of their target. The entry walk
+        // tells them apart, and links are then removed as files, without following them.
+        let files = entries.filter { !isDirectory($0) }
+          .publisher
+          .setFailureType(to: Error.self)
+          .flatMap(maxPublishers: .max(maxConcurrent)) { attrs in
+            self.cloneWalkTo(entry: attrs[.name] as! String)
+              .flatMap { $0.removeEntries(maxConcurrent: maxConcurrent) }
+          }
+        let directories = entries.filter(isDirectory)
+          .publisher
+          .setFailureType(to: Error.self)
+          .flatMap(maxPublishers: .max(1)) { attrs in
+            self.cloneWalkTo(entry: attrs[.name] as! String)
+              .flatMap { $0.removeEntries(maxConcurrent: maxConcurrent) }
+          }
+
+        return files
+          .append(directories)
+          .collect()
+          .map { _ in () }
+          .eraseToAnyPublisher()
+      }
+      .flatMap { _ in self.rmdir() }
+      .map { _ in () }
+      .eraseToAnyPublisher()
+  }
+
+  // Moves the object to the path, relative to its directory or absolute. The
+  // rename is tried first, and the Translator moves it on its side if refused,
+  // like when replacing an existing object.
+  public func moveTree(to path: String) -> AnyPublisher<Void, Error> {
+    let rename = wstat([.name: path]).map { _ in () }
+
+    guard let treeOperator = treeOperator else {
+      return rename.eraseToAnyPublisher()
+    }
+
+    return rename
+      .catch { _ in treeOperator.moveTree(to: path) }
+      .eraseToAnyPublisher()
+  }
+}
@@ -45,6 +45,47 @@ public extension BlinkFilesAttributeKey {
 
 public typealias FileAttributes = [BlinkFilesAttributeKey: Any]
 
+// Translators that can list a directory progressively. Each demanded value is a batch
+// of up to batchSize entries, so big directories never need to be held in memory at once.
+public protocol DirectoryStreamer {
+  func directoryFilesAndAttributes(batchSize: Int) -> AnyPublisher<[FileAttributes], Error>
+}
+
+// Translators that can resolve the links on a listing of their current directory by themselves,
+// cheaper than walking to each one of them.
+public protocol LinkResolver {
+  func resolvingLinks(_ filesAttributes: [FileAttributes]) -> AnyPublisher<[FileAttributes], Error>
+}
+
+// Translators that can walk to a path without following its last component, like
+// lstat, so a link is reached itself and not its target. Removals and moves need
+// it, as they must apply to the link.
+public protocol EntryWalker {
+  func walkTo(entry path: String) -> AnyPublisher<Translator, Error>
+}
+
+// Translators that can remove or move a whole tree with a single operation on
+// their side, instead of one request per entry. The current path is taken as is,
+// so it should come from an entry walk.
+public protocol TreeOperator {
+  func removeTree() -> AnyPublisher<Void, Error>
+  func moveTree(to path: String) -> AnyPublisher<Void, Error>
+}
+
+// Entry within a tree, with its path relative to the root of the walk. A directory
+// is always delivered before anything under it.
+public struct TreeEntry {
+  public let path: String
+  public let attributes: FileAttributes
+  public let translator: Translator
+}
+
+// Translators that can walk everything under their current directory as a single
+// stream, cheaper than listing and walking to each directory in turn.
+public protocol TreeWalker {
+  func walkTree() -> AnyPublisher<TreeEntry, Error>
+}
+
 public protocol Translator: CopierFrom {
   var fileType: FileAttributeType { get }
   var isDirectory: Bool { get }
@@ -104,6 +145,11 @@ public protocol File: Reader, Writer {
   func close() -> AnyPublisher<Bool, Error>
 }
 
+// Files that can move their position, so reads and writes can start anywhere on the object.
+public protocol Seeker {
+  func seek(to offset: UInt64) throws
+}
+
 // The Copy algorithms will report the progress of each file as it gets copied.
 // As they are recursive, we provide information on what file is being reported.
 // Report progress as (name, total bytes written, length)
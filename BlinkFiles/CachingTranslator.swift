@@ -0,0 +1,306 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2021 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+import Combine
+
+// Stat, listing and walk results shared by a CachingTranslator and its clones.
+// Entries are kept per absolute path for ttl seconds, up to maxEntries.
+// Results are only stored if nothing was invalidated since their request started.
+public class TranslatorCache {
+  enum Kind {
+    case stat
+    case listing
+    case walk
+  }
+
+  struct Key: Hashable {
+    let kind: Kind
+    let path: String
+  }
+
+  private struct Entry {
+    let value: Any
+    let expires: Date
+  }
+
+  public let ttl: TimeInterval
+  public let maxEntries: Int
+  public private(set) var hits = 0
+  public private(set) var misses = 0
+  private var entries: [Key: Entry] = [:]
+  private var currentGeneration: UInt64 = 0
+  private let queue = DispatchQueue(label: "TranslatorCache")
+
+  public init(ttl: TimeInterval = 10, maxEntries: Int = 10_000) {
+    self.ttl = ttl
+    self.maxEntries = maxEntries
+  }
+
+  func get<T>(_ kind: Kind, path: String) -> T? {
+    queue.sync {
+      let key = Key(kind: kind, path: path)
+      guard let entry = entries[key], entry.expires > Date() else {
+        entries.removeValue(forKey: key)
+        misses += 1
+        return nil
+      }
+      hits += 1
+      return entry.value as? T
+    }
+  }
+
+  var generation: UInt64 {
+    queue.sync { currentGeneration }
+  }
+
+  func set(_ kind: Kind, path: String, value: Any, generation: UInt64) {
+    queue.sync {
+      guard generation == currentGeneration else {
+        return
+      }
+      if entries.count >= maxEntries {
+        let now = Date()
+        entries = entries.filter { $0.value.expires > now }
+        if entries.count >= maxEntries {
+          entries.removeAll()
+        }
+      }
+      entries[Key(kind: kind, path: path)] = Entry(value: value, expires: Date(timeIntervalSinceNow: ttl))
+    }
+  }
+
+  // Drop the path, anything below it, and the listing of its parent.
+  public func invalidate(path: String) {
+    let parent = (path as NSString).deletingLastPathComponent
+    let prefix = path.hasSuffix("/") ? path : path + "/"
+
+    queue.sync {
+      currentGeneration += 1
+      entries.removeValue(forKey: Key(kind: .listing, path: parent))
+      entries = entries.filter { (key, _) in
+        key.path != path && !key.path.hasPrefix(prefix)
+      }
+    }
+  }
+
+  public func invalidateAll() {
+    queue.sync {
+      currentGeneration += 1
+      entries.removeAll()
+    }
+  }
+}
+
+// Wraps any Translator to answer repeated stat, listing and walk requests from
+// a TranslatorCache. Operations through the wrapper that modify a path drop it
+// from the cache once they complete. Changes made by other means, including
+// writes to a File already open, are only seen after the ttl.
+public class CachingTranslator: Translator {
+  private(set) var wrapped: Translator
+  public let cache: TranslatorCache
+
+  public var fileType: FileAttributeType { wrapped.fileType }
+  public var isDirectory: Bool { wrapped.isDirectory }
+  public var current: String { wrapped.current }
+  public var isConnected: Bool { wrapped.isConnected }
+
+  public init(_ translator: Translator, cache: TranslatorCache = TranslatorCache()) {
+    self.wrapped = translator
+    self.cache = cache
+  }
+
+  public func clone() -> Translator {
+    CachingTranslator(wrapped.clone(), cache: cache)
+  }
+
+  public func walkTo(_ path: String) -> AnyPublisher<Translator, Error> {
+    let absPath = path.starts(with: "/") ?
+      (path as NSString).standardizingPath :
+      ((current as NSString).appendingPathComponent(path) as NSString).standardizingPath
+
+    // Hand out clones, so the cached Translator never moves.
+    if let t: Translator = cache.get(.walk, path: absPath) {
+      wrapped = t.clone()
+      return .just(self)
+    }
+
+    let generation = cache.generation
+    return wrapped.walkTo(path)
+      .map { t -> Translator in
+        self.cache.set(.walk, path: absPath, value: t.clone(), generation: generation)
+        self.wrapped = t
+        return self
+      }.eraseToAnyPublisher()
+  }
+
+  public func directoryFilesAndAttributes() -> AnyPublisher<[FileAttributes], Error> {
+    let path = current
+    if let filesAttributes: [FileAttributes] = cache.get(.listing, path: path) {
+      return .just(filesAttributes)
+    }
+
+    let generation = cache.generation
+    return wrapped.directoryFilesAndAttributes()
+      .map { filesAttributes in
+        self.cache.set(.listing, path: path, value: filesAttributes, generation: generation)
+        return filesAttributes
+      }.eraseToAnyPublisher()
+  }
+
+  public func stat() -> AnyPublisher<FileAttributes, Error> {
+    let path = current
+    if let attrs: FileAttributes = cache.get(.stat, path: path) {
+      return .just(attrs)
+    }
+
+    let generation = cache.generation
+    return wrapped.stat()
+      .map { attrs in
+        self.cache.set(.stat, path: path, value: attrs, generation: generation)
+        return attrs
+      }.eraseToAnyPublisher()
+  }
+
+  public func create(name: String, flags: Int32, mode: mode_t) -> AnyPublisher<File, Error> {
+    invalidating(childPath(name), wrapped.create(name: name, flags: flags, mode: mode))
+  }
+
+  public func mkdir(name: String, mode: mode_t) -> AnyPublisher<Translator, Error> {
+    invalidating(childPath(name), wrapped.mkdir(name: name, mode: mode))
+      .map { t -> Translator in
+        self.wrapped = t
+        return self
+      }.eraseToAnyPublisher()
+  }
+
+  public func open(flags: Int32) -> AnyPublisher<File, Error> {
+    if (flags & O_ACCMODE) == O_RDONLY && (flags & O_TRUNC) == 0 {
+      return wrapped.open(flags: flags)
+    }
+    return invalidating(current, wrapped.open(flags: flags))
+  }
+
+  public func remove() -> AnyPublisher<Bool, Error> {
+    invalidating(current, wrapped.remove())
+  }
+
+  public func rmdir() -> AnyPublisher<Bool, Error> {
+    invalidating(current, wrapped.rmdir())
+  }
+
+  public func wstat(_ attrs: FileAttributes) -> AnyPublisher<Bool, Error> {
+    guard let newName = attrs[.name] as? String else {
+      return invalidating(current, wrapped.wstat(attrs))
+    }
+
+    let newPath = newName.starts(with: "/") ? newName :
+      ((current as NSString).deletingLastPathComponent as NSString).appendingPathComponent(newName)
+    return invalidating(newPath, invalidating(current, wrapped.wstat(attrs)))
+  }
+
+  func childPath(_ name: String) -> String {
+    (current as NSString).appendingPathComponent(name)
+  }
+
+  // Drop the path when the operation is done, whatever the outcome, as it may
+  // have been modified anyway.
+  func invalidating<T>(_ path: String, _ operation: AnyPublisher<T, Error>) -> AnyPublisher<T, Error> {
+    cache.invalidate(path: path)
+    return operation
+      .handleEvents(receiveCompletion: { _ in self.cache.invalidate(path: path) },
+                    receiveCancel: { self.cache.invalidate(path: path) })
+      .eraseToAnyPublisher()
+  }
+}
+
+// Keep the extension points of the wrapped Translator.
+extension CachingTranslator: DirectoryStreamer {
+  public func directoryFilesAndAttributes(batchSize: Int) -> AnyPublisher<[FileAttributes], Error> {
+    if let filesAttributes: [FileAttributes] = cache.get(.listing, path: current) {
+      return stride(from: 0, to: filesAttributes.count, by: batchSize)
+        .map { Array(filesAttributes[$0..<min($0 + batchSize, filesAttributes.count)]) }
+        .publisher
+        .setFailureType(to: Error.self)
+        .eraseToAnyPublisher()
+    }
+
+    return wrapped.directoryFilesAndAttributes(batchSize: batchSize)
+  }
+}
+
+extension CachingTranslator: LinkResolver {
+  public func resolvingLinks(_ filesAttributes: [FileAttributes]) -> AnyPublisher<[FileAttributes], Error> {
+    wrapped.resolvingLinks(filesAttributes)
+  }
+}
+
+// Walks to entries through the wrapped Translator, so links stay links.
+extension CachingTranslator: EntryWalker {
+  public func walkTo(entry path: String) -> AnyPublisher<Translator, Error> {
+    guard let walker = wrapped as? EntryWalker else {
+      return walkTo(path)
+    }
+    return walker.walkTo(entry: path)
+      .map { t -> Translator in
+        self.wrapped = t
+        return self
+      }.eraseToAnyPublisher()
+  }
+}
+
+// Not a TreeOperator conformance, so wrapping a Translator without one keeps the
+// generic paths of removeTree and moveTree, and their errors.
+extension CachingTranslator {
+  var wrappedTreeOperator: TreeOperator? {
+    guard let treeOperator = wrapped as? TreeOperator else {
+      return nil
+    }
+    return CachingTreeOperator(translator: self, wrapped: treeOperator)
+  }
+}
+
+private struct CachingTreeOperator: TreeOperator {
+  let translator: CachingTranslator
+  let wrapped: TreeOperator
+
+  func removeTree() -> AnyPublisher<Void, Error> {
+    translator.invalidating(translator.current, wrapped.removeTree())
+  }
+
+  func moveTree(to path: String) -> AnyPublisher<Void, Error> {
+    let current = translator.current
+    let newPath = path.starts(with: "/") ? path :
+      ((current as NSString).deletingLastPathComponent as NSString).appendingPathComponent(path)
+    return translator.invalidating(newPath, translator.invalidating(current, wrapped.moveTree(to: path)))
+  }
+}
@@ -96,6 +96,14 @@ extension Translator {
   fileprivate func copyElement(from t: Translator, args: CopyArguments) -> CopyProgressInfoPublisher {
     return Just(t)
       .flatMap() { $0.stat() }
+      .flatMap { self.copyElement(from: t, attributes: $0, args: args) }
+      .eraseToAnyPublisher()
+  }
+
+  fileprivate func copyElement(from t: Translator,
+                               attributes attrs: FileAttributes,
+                               args: CopyArguments) -> CopyProgressInfoPublisher {
+    return Just(attrs)
       .tryMap { attrs -> (String, NSNumber, FileAttributes) in
         guard let name = attrs[FileAttributeKey.name] as? String else {
           throw CopyError(msg: "No name provided")
@@ -120,28 +128,36 @@ extension Translator {
           let mode = passingAttributes[FileAttributeKey.posixPermissions] as? NSNumber ?? NSNumber(value: Int16(0o755))
           return self.copyDirectory(as: name, from: t, mode: mode, args: args)
         default:
-          let copyFilePublisher = self.copyFile(from: t, name: name, size: size, attributes: passingAttributes)
-          
-          // When checkTimes, copy the file only if the modificationDate is different
-          if args.checkTimes {
-            let fileTranslator = self.isDirectory ? self.cloneWalkTo(name) : .just(self)
-            return fileTranslator
-              .flatMap { $0.stat() }
-              .catch { _ in Just([:]) }
-              .flatMap { localAttributes -> CopyProgressInfoPublisher in
-                if let localModificationDate = localAttributes[.modificationDate] as? NSDate,
-                   localModificationDate == (passingAttributes[.modificationDate] as? NSDate) {
-                  let fullFile = (self.current as NSString).appendingPathComponent(name)
-                  return .just(CopyProgressInfo(name: fullFile, written: 0, size: size.uint64Value))
-                }
-                return copyFilePublisher
-              }.eraseToAnyPublisher()
-          }
-          
-          return copyFilePublisher
+          return self.copyRegularFile(from: t, name: name, size: size, attributes: passingAttributes, args: args)
         }
       }.eraseToAnyPublisher()
   }
+
+  fileprivate func copyRegularFile(from t: Translator,
+                                   name: String,
+                                   size: NSNumber,
+                                   attributes passingAttributes: FileAttributes,
+                                   args: CopyArguments) -> CopyProgressInfoPublisher {
+    let copyFilePublisher = self.copyFile(from: t, name: name, size: size, attributes: passingAttributes)
+
+    // When checkTimes, copy the file only if the modificationDate is different
+    if args.checkTimes {
+      let fileTranslator = self.isDirectory ? self.cloneWalkTo(name) : .just(self)
+      return fileTranslator
+        .flatMap { $0.stat() }
+        .catch { _ in Just([:]) }
+        .flatMap { localAttributes -> CopyProgressInfoPublisher in
+          if let localModificationDate = localAttributes[.modificationDate] as? NSDate,
+             localModificationDate == (passingAttributes[.modificationDate] as? NSDate) {
+            let fullFile = (self.current as NSString).appendingPathComponent(name)
+            return .just(CopyProgressInfo(name: fullFile, written: 0, size: size.uint64Value))
+          }
+          return copyFilePublisher
+        }.eraseToAnyPublisher()
+    }
+
+    return copyFilePublisher
+  }
   
   fileprivate func copyDirectory(as name: String,
                                  from t: Translator,
@@ -159,6 +175,13 @@ extension Translator {
       directory = self.clone().mkdir(name: name, mode: mode_t(truncating: mode))
     }
     
+    if let walker = t as? TreeWalker {
+      return directory
+        .flatMap { dir in dir.copyTree(from: walker, args: args) }
+        .eraseToAnyPublisher()
+    }
+
+    // Children are walked to as they are copied, instead of holding all of them upfront.
     return directory
       .flatMap { dir -> CopyProgressInfoPublisher in
         t.directoryFilesAndAttributes().flatMap {
@@ -169,9 +192,10 @@ extension Translator {
               return i
             }
           }.publisher
-        }.flatMap { t.cloneWalkTo($0[.name] as! String) }
-        .collect()
-        .flatMap { dir.copy(from: $0, args: args) }.eraseToAnyPublisher()
+        }.flatMap(maxPublishers: .max(1)) {
+          t.cloneWalkTo($0[.name] as! String)
+            .flatMap { dir.copy(from: [$0], args: args) }
+        }.eraseToAnyPublisher()
       }.eraseToAnyPublisher()
     
 //    return t.directoryFilesAndAttributes().flatMap {
@@ -186,6 +210,51 @@ extension Translator {
 //    .collect()
 //    .flatMap { self.copy(from: $0) }.eraseToAnyPublisher()
   }
+
+  // Copy everything under the walker's directory into self, as the walk delivers it.
+  // Entries come with their attributes, so they are copied without further stats, and
+  // only the destination directories are kept to place what comes under them.
+  fileprivate func copyTree(from walker: TreeWalker, args: CopyArguments) -> CopyProgressInfoPublisher {
+    var directories: [String: Translator] = ["": self]
+
+    return walker.walkTree()
+      .flatMap(maxPublishers: .max(1)) { entry -> CopyProgressInfoPublisher in
+        let parentPath = (entry.path as NSString).deletingLastPathComponent
+        guard let parent = directories[parentPath] else {
+          return .fail(error: CopyError(msg: "Could not find destination for \(entry.path)"))
+        }
+        let name = (entry.path as NSString).lastPathComponent
+        let passingAttributes = args.preserve.filter(entry.attributes)
+
+        switch entry.translator.fileType {
+        case .typeDirectory:
+          let mode = passingAttributes[FileAttributeKey.posixPermissions] as? NSNumber ?? NSNumber(value: Int16(0o755))
+          let directory: AnyPublisher<Translator, Error>
+          if args.checkTimes {
+            directory = parent.cloneWalkTo(name)
+              .tryCatch { _ in parent.clone().mkdir(name: name, mode: mode_t(truncating: mode)) }
+              .eraseToAnyPublisher()
+          } else {
+            directory = parent.clone().mkdir(name: name, mode: mode_t(truncating: mode))
+          }
+
+          return directory
+            .flatMap { dir -> CopyProgressInfoPublisher in
+              directories[entry.path] = dir
+              return Empty().eraseToAnyPublisher()
+            }.eraseToAnyPublisher()
+        case .typeRegular:
+          let size = entry.attributes[.size] as? NSNumber ?? 0
+          return parent.copyRegularFile(from: entry.translator,
+                                        name: name,
+                                        size: size,
+                                        attributes: passingAttributes,
+                                        args: args)
+        default:
+          return Empty().eraseToAnyPublisher()
+        }
+      }.eraseToAnyPublisher()
+  }
 }
 
 fileprivate enum FileState {
@@ -52,13 +52,22 @@ public class Local : Translator {
   let root: String
   public private(set) var current: String
 
+  // Default local path
+  static let documentsPath = NSSearchPathForDirectoriesInDomains(.documentDirectory, .userDomainMask, true)[0]
+
   public init() {
-    // Default local path
-    self.root    = NSSearchPathForDirectoriesInDomains(.documentDirectory, .userDomainMask, true)[0]
+    self.root    = Local.documentsPath
     self.fileType = .typeDirectory
     self.current = root
   }
 
+  // For paths already known to exist, like the ones coming from a listing.
+  convenience init(at path: String, fileType: FileAttributeType) {
+    self.init()
+    self.current = path
+    self.fileType = fileType
+  }
+
   public func clone() -> Translator {
     let cl = Local()
     cl.current  = self.current
@@ -125,13 +134,16 @@ public class Local : Translator {
       return fileAttributes(atPath: current).map { [$0] }.eraseToAnyPublisher()
     }
 
-    return fileManager().tryMap { try $0.contentsOfDirectory(atPath: self.current) }
-      .mapError { _ in LocalFileError(msg: "Could not get contents of directory") }
-      .flatMap { fileNames -> AnyPublisher<[FileAttributes], Error> in
-        return fileNames.publisher.flatMap {
-          self.fileAttributes(atPath: (self.current as NSString).appendingPathComponent($0))
-        }.collect().eraseToAnyPublisher()
-      }.eraseToAnyPublisher()
+    return Just(current).tryMap { path -> [FileAttributes] in
+      var filesAttributes: [FileAttributes] = []
+      try LocalDirectory.read(atPath: path, batchSize: 256) {
+        filesAttributes.append(contentsOf: $0)
+        return true
+      }
+      return filesAttributes
+    }
+    .mapError { _ in LocalFileError(msg: "Could not get contents of directory") }
+    .eraseToAnyPublisher()
   }
 
   //    // TODO Change permissions to more generic open options
@@ -256,12 +268,44 @@ public class Local : Translator {
   }
 }
 
+extension Local: TreeWalker {
+  public func walkTree() -> AnyPublisher<TreeEntry, Error> {
+    if fileType != .typeDirectory {
+      return fail(msg: "Not a directory")
+    }
+
+    return LocalTreeWalker(root: current).walk()
+  }
+}
+
+extension Local: EntryWalker {
+  // The walk reports links with the type of their target. Here the last component
+  // is not resolved, so a link is a .typeSymbolicLink.
+  public func walkTo(entry path: String) -> AnyPublisher<Translator, Error> {
+    var absPath = (path as NSString).standardizingPath
+    if !path.starts(with: "/") {
+      absPath = (current as NSString).appendingPathComponent(absPath)
+    }
+
+    return fileManager().flatMap { fm -> AnyPublisher<Translator, Error> in
+      guard let attrs = try? fm.attributesOfItem(atPath: absPath),
+            let type = attrs[.type] as? FileAttributeType else {
+        return self.fail(msg: "No such file or directory.")
+      }
+      self.fileType = type
+      self.current = absPath
+      return self.publisher()
+    }.eraseToAnyPublisher()
+  }
+}
+
 public class LocalFile : File {
   let channel: DispatchIO
   let fd: Int32
   let blockSize = 1024 * 1024
   var offset: Int64 = 0
   let queue: DispatchQueue
+  let region: MappedRegion?
 
   init(at path: String, flags: Int32) throws {
     // Not sure if this can be nil, while errno is not
@@ -278,6 +322,8 @@ public class LocalFile : File {
     self.fd = fd
     self.channel = channel
     self.queue = queue
+    // Read-only regular files are served straight from a mapping.
+    self.region = (flags & O_ACCMODE) == O_RDONLY ? MappedRegion(fd: fd) : nil
 
     // Avoid small local reads or writes.
     self.channel.setLimit(lowWater: blockSize)
@@ -303,6 +349,12 @@ extension LocalFile: Reader, WriterTo {
   // Lock once the demand has been satistied, and unlock once there is new demand
   // If demand is unlimited, you will never lock.
   public func read(max length: Int) -> AnyPublisher<DispatchData, Error> {
+    if let region = region {
+      let data = region.slice(from: offset, max: length)
+      offset += Int64(data.count)
+      return .just(data)
+    }
+
     return readLoop(max: length)
       .reduce(DispatchData.empty) { prevValue, newValue -> DispatchData in
         var n = prevValue
@@ -312,6 +364,13 @@ extension LocalFile: Reader, WriterTo {
   }
 
   public func writeTo(_ w: Writer) -> AnyPublisher<Int, Error> {
+    if region != nil {
+      return mappedReadLoop()
+        .flatMap(maxPublishers: .max(1)) { data in
+          return w.write(data, max: data.count)
+        }.eraseToAnyPublisher()
+    }
+
     // TODO It blocks with big files, and it may block with the Dispatch streams too
     // A new block may be received, before the readLoop goes to send downstream.
     // The new block will block the queue, and hence it will never go down.
@@ -324,6 +383,11 @@ extension LocalFile: Reader, WriterTo {
       }.eraseToAnyPublisher()
   }
 
+  // Streams the rest of the file one block per demand, instead of reducing it like read(max:).
+  public func readBlocks() -> AnyPublisher<DispatchData, Error> {
+    region != nil ? mappedReadLoop() : readLoop(max: SSIZE_MAX)
+  }
+
   func readLoop(max length: Int) -> AnyPublisher<DispatchData, Error> {
     let io = self.channel
     let subj = PassthroughSubject<DispatchData, Error>()
@@ -367,6 +431,8 @@ extension LocalFile: Reader, WriterTo {
       }
 
       offset += Int64(data.count)
+      // Keep the file position, so the next read continues from here.
+      self.offset = offset
       // done and data.count == 0 is indicator of EOF with no more data, so finish.
       let eof = done && data.count == 0
       guard !eof else {
@@ -377,7 +443,7 @@ extension LocalFile: Reader, WriterTo {
       print("Sending \(data.count)")
       subj.send(data)
 
-      if done && offset == length {
+      if done && offset - startOffset == length {
         print("Completed")
         return subj.send(completion: .finished)
       }
@@ -412,7 +478,8 @@ extension LocalFile: Reader, WriterTo {
       }
     }
 
-    var offset: off_t = 0
+    let startOffset: off_t = self.offset
+    var offset: off_t = startOffset
     func onRequest(_ demand: Subscribers.Demand) {
       // Create a semaphore if necessary for the specified demand
       // No demand, no scheduling.
@@ -426,7 +493,7 @@ extension LocalFile: Reader, WriterTo {
       if demand == Subscribers.Demand.unlimited {
         // NOTE Unlimited read is memory heavy. Dispatch will load as much as it can in memory,
         // independently of high - low water marks.
-        io.read(offset: 0, length: length, queue: self.queue, ioHandler: ioHandler)
+        io.read(offset: offset, length: length, queue: self.queue, ioHandler: ioHandler)
       } else {
         // blockSize is coincidental with the demand, as we have set that value as the lower water mark.
         io.read(offset: offset, length: blockSize, queue: self.queue, ioHandler: ioHandler)
@@ -439,6 +506,116 @@ extension LocalFile: Reader, WriterTo {
       receiveRequest: onRequest
     ).eraseToAnyPublisher()
   }
+
+  // Slices are only cut when there is demand for them, so there is nothing to throttle.
+  // Each slice references the mapping, which stays alive until the last one is released.
+  func mappedReadLoop() -> AnyPublisher<DispatchData, Error> {
+    guard let region = region else {
+      return .fail(error: LocalFileError(msg: "File is not mapped"))
+    }
+
+    let subj = PassthroughSubject<DispatchData, Error>()
+    var pending = Subscribers.Demand.none
+    var canceled = false
+
+    func drain() {
+      while pending > 0 && !canceled {
+        let data = region.slice(from: offset, max: blockSize)
+        guard data.count > 0 else {
+          return subj.send(completion: .finished)
+        }
+
+        pending -= 1
+        offset += Int64(data.count)
+        region.willNeed(from: offset, length: blockSize * MappedRegion.readAheadBlocks)
+        subj.send(data)
+        if offset >= region.size {
+          return subj.send(completion: .finished)
+        }
+      }
+    }
+
+    return subj.handleEvents(
+      receiveCancel: { self.queue.async { canceled = true } },
+      receiveRequest: { demand in
+        // Dispatch so the subject has registered the demand before we send.
+        self.queue.async {
+          pending += demand
+          drain()
+        }
+      }
+    ).eraseToAnyPublisher()
+  }
+}
+
+// Read-only, shared mapping of a whole regular file. Pages are faulted in by the
+// kernel on access and can be dropped again under pressure, so uploads do not hold
+// the file in memory.
+// Note the mapping reflects the size at open. As with any mapping, truncating the file
+// while it is being read is not supported.
+final class MappedRegion {
+  static let readAheadBlocks = 4
+  static let pageSize = Int(getpagesize())
+
+  let base: UnsafeMutableRawPointer
+  let size: Int
+
+  init?(fd: Int32) {
+    var st = stat()
+    guard fstat(fd, &st) == 0,
+          (st.st_mode & S_IFMT) == S_IFREG,
+          st.st_size > 0 else {
+      return nil
+    }
+
+    let size = Int(st.st_size)
+    guard let base = mmap(nil, size, PROT_READ, MAP_SHARED, fd, 0),
+          base != MAP_FAILED else {
+      return nil
+    }
+
+    madvise(base, size, MADV_SEQUENTIAL)
+    self.base = base
+    self.size = size
+  }
+
+  // Slices end on a page boundary (blockSize multiple) unless at EOF, so a seek to
+  // an unaligned offset realigns on the first slice.
+  func slice(from offset: Int64, max length: Int) -> DispatchData {
+    let start = Int(offset)
+    guard start < size, length > 0 else {
+      return .empty
+    }
+
+    var end = start + min(length, size - start)
+    if length >= MappedRegion.pageSize {
+      let aligned = (end / MappedRegion.pageSize) * MappedRegion.pageSize
+      if aligned > start && end < size {
+        end = aligned
+      }
+    }
+
+    let buf = UnsafeRawBufferPointer(start: base + start, count: end - start)
+    return DispatchData(bytesNoCopy: buf, deallocator: .custom(nil, { _ = self }))
+  }
+
+  func willNeed(from offset: Int64, length: Int) {
+    let start = (Int(offset) / MappedRegion.pageSize) * MappedRegion.pageSize
+    guard start < size else {
+      return
+    }
+    madvise(base + start, min(length, size - start), MADV_WILLNEED)
+  }
+
+  deinit {
+    munmap(base, size)
+  }
+}
+
+extension LocalFile: Seeker {
+  public func seek(to offset: UInt64) throws {
+    self.offset = Int64(offset)
+  }
 }
 
 extension LocalFile: Writer {
@@ -0,0 +1,310 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2021 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+import Combine
+
+// Lists a directory with readdir, and stats its entries relative to the directory
+// descriptor instead of resolving a full path through FileManager for each one.
+enum LocalDirectory {
+  // Entries are handed over in batches of up to batchSize. Returning false from
+  // receive stops the listing.
+  static func read(atPath path: String,
+                   batchSize: Int,
+                   _ receive: ([FileAttributes]) -> Bool) throws {
+    guard let dir = opendir(path) else {
+      throw LocalFileError(msg: "Could not open directory. \(String(cString: strerror(errno)))")
+    }
+    defer { closedir(dir) }
+    let fd = dirfd(dir)
+
+    var batch: [FileAttributes] = []
+    batch.reserveCapacity(batchSize)
+    while let entry = readdir(dir) {
+      let name = withUnsafeBytes(of: entry.pointee.d_name) {
+        String(cString: $0.bindMemory(to: CChar.self).baseAddress!)
+      }
+      if name == "." || name == ".." {
+        continue
+      }
+
+      // The entry may be gone by the time we stat it.
+      guard let attrs = attributes(of: name, type: entry.pointee.d_type, at: fd) else {
+        continue
+      }
+
+      batch.append(attrs)
+      if batch.count == batchSize {
+        guard receive(batch) else {
+          return
+        }
+        batch.removeAll(keepingCapacity: true)
+      }
+    }
+
+    if !batch.isEmpty {
+      _ = receive(batch)
+    }
+  }
+
+  // Only links need to be followed, so d_type saves resolving everything else.
+  // Like the rest of Local, links report the attributes of their target, or the
+  // ones of the link itself when dangling.
+  static func attributes(of name: String, type: UInt8, at fd: Int32) -> FileAttributes? {
+    var st = stat()
+    if Int32(type) == DT_LNK && fstatat(fd, name, &st, 0) == 0 {
+      return attributes(name: name, st)
+    }
+    guard fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 else {
+      return nil
+    }
+    return attributes(name: name, st)
+  }
+
+  static func attributes(name: String, _ st: stat) -> FileAttributes {
+    var item: FileAttributes = [.name: name]
+
+    switch st.st_mode & S_IFMT {
+    case S_IFREG:
+      item[.type] = FileAttributeType.typeRegular
+    case S_IFDIR:
+      item[.type] = FileAttributeType.typeDirectory
+    case S_IFLNK:
+      item[.type] = FileAttributeType.typeSymbolicLink
+    case S_IFCHR:
+      item[.type] = FileAttributeType.typeCharacterSpecial
+    case S_IFBLK:
+      item[.type] = FileAttributeType.typeBlockSpecial
+    case S_IFSOCK:
+      item[.type] = FileAttributeType.typeSocket
+    default:
+      item[.type] = FileAttributeType.typeUnknown
+    }
+
+    item[.size] = NSNumber(value: UInt64(st.st_size))
+    item[.posixPermissions] = NSNumber(value: Int16(truncatingIfNeeded: st.st_mode & 0o7777))
+    item[.ownerAccountID] = NSNumber(value: st.st_uid)
+    item[.groupOwnerAccountID] = NSNumber(value: st.st_gid)
+    item[.modificationDate] = NSDate(timeIntervalSince1970: interval(st.st_mtimespec))
+    item[.creationDate] = NSDate(timeIntervalSince1970: interval(st.st_birthtimespec))
+
+    return item
+  }
+
+  static func interval(_ ts: timespec) -> TimeInterval {
+    TimeInterval(ts.tv_sec) + TimeInterval(ts.tv_nsec) / 1_000_000_000
+  }
+}
+
+// Walks a local tree with a few threads listing directories at the same time.
+// Entries go through a buffer of up to capacity, drained only as the subscriber
+// asks for them, so the walk never gets further ahead of its consumer than that,
+// whatever the size of the tree.
+final class LocalTreeWalker {
+  let root: String
+  let threads: Int
+  let capacity: Int
+
+  // Directories waiting to be listed, relative to root. Guarded by work.
+  private let work = NSCondition()
+  private var pendingDirectories: [String] = [""]
+  private var listing = 0
+  private var canceled = false
+  private var started = false
+
+  // Entries waiting for demand. Guarded by queue.
+  private let queue = DispatchQueue(label: "LocalTreeWalker")
+  private let slots: DispatchSemaphore
+  private let subject = PassthroughSubject<TreeEntry, Error>()
+  private var buffer: [TreeEntry] = []
+  private var head = 0
+  private var demand = Subscribers.Demand.none
+  private var completion: Subscribers.Completion<Error>? = nil
+
+  init(root: String, threads: Int = 4, capacity: Int = 1024) {
+    self.root = root
+    self.threads = threads
+    self.capacity = capacity
+    self.slots = DispatchSemaphore(value: capacity)
+  }
+
+  func walk() -> AnyPublisher<TreeEntry, Error> {
+    subject.handleEvents(
+      receiveCancel: { self.cancel() },
+      receiveRequest: { demand in
+        // Dispatch so the subject has registered the demand before we send.
+        self.queue.async {
+          self.demand += demand
+          self.start()
+          self.drain()
+        }
+      }
+    ).eraseToAnyPublisher()
+  }
+
+  private func start() {
+    guard !started else {
+      return
+    }
+    started = true
+
+    for _ in 0..<threads {
+      DispatchQueue.global(qos: .utility).async { self.runWorker() }
+    }
+  }
+
+  private func runWorker() {
+    while let dir = nextDirectory() {
+      let error = list(dir)
+      finishDirectory(error: error)
+    }
+  }
+
+  private func nextDirectory() -> String? {
+    work.lock()
+    defer { work.unlock() }
+
+    while pendingDirectories.isEmpty && listing > 0 && !canceled {
+      work.wait()
+    }
+    if canceled || pendingDirectories.isEmpty {
+      return nil
+    }
+
+    listing += 1
+    return pendingDirectories.removeLast()
+  }
+
+  private func finishDirectory(error: Error?) {
+    work.lock()
+    defer { work.unlock() }
+
+    listing -= 1
+    if let error = error, !canceled {
+      canceled = true
+      queue.async { self.finish(.failure(error)) }
+      // Release the workers still waiting for room.
+      slots.signal()
+    } else if listing == 0 && pendingDirectories.isEmpty && !canceled {
+      queue.async { self.finish(.finished) }
+    }
+    work.broadcast()
+  }
+
+  private func list(_ dir: String) -> Error? {
+    let path = (root as NSString).appendingPathComponent(dir)
+
+    do {
+      try LocalDirectory.read(atPath: path, batchSize: 64) { batch in
+        for attrs in batch {
+          slots.wait()
+          if isCanceled() {
+            slots.signal()
+            return false
+          }
+
+          let name = attrs[.name] as! String
+          let entryPath = dir.isEmpty ? name : (dir as NSString).appendingPathComponent(name)
+          let type = attrs[.type] as! FileAttributeType
+          let entry = TreeEntry(path: entryPath,
+                                attributes: attrs,
+                                translator: Local(at: (path as NSString).appendingPathComponent(name),
+                                                  fileType: type))
+          // Queued before the directory is handed out, so it is always delivered
+          // before its contents.
+          queue.async {
+            self.buffer.append(entry)
+            self.drain()
+          }
+
+          if type == .typeDirectory {
+            work.lock()
+            pendingDirectories.append(entryPath)
+            work.signal()
+            work.unlock()
+          }
+        }
+        return true
+      }
+    } catch {
+      return error
+    }
+
+    return nil
+  }
+
+  private func isCanceled() -> Bool {
+    work.lock()
+    defer { work.unlock() }
+    return canceled
+  }
+
+  private func cancel() {
+    work.lock()
+    canceled = true
+    work.broadcast()
+    work.unlock()
+    // Wake up a worker waiting for room. Each one that wakes up passes it on.
+    slots.signal()
+  }
+
+  private func finish(_ completion: Subscribers.Completion<Error>) {
+    if case .failure = completion {
+      buffer.removeAll()
+      head = 0
+    }
+    self.completion = completion
+    drain()
+  }
+
+  private func drain() {
+    while demand > 0 && head < buffer.count {
+      demand -= 1
+      let entry = buffer[head]
+      head += 1
+      slots.signal()
+      subject.send(entry)
+    }
+
+    if head == buffer.count {
+      buffer.removeAll(keepingCapacity: true)
+      head = 0
+      if let completion = completion {
+        self.completion = nil
+        subject.send(completion: completion)
+      }
+    } else if head >= capacity {
+      buffer.removeFirst(head)
+      head = 0
+    }
+  }
+}
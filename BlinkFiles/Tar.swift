@@ -0,0 +1,691 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2021 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+import Combine
+
+// ustar archives produced and consumed as streams, so a whole tree can travel over a
+// single channel to or from a tar on the other side. Long names are written as GNU
+// longname entries, which every common tar reads. On the way in, pax path, size and
+// linkpath records are understood as well.
+public enum Tar {
+  static let blockSize = 512
+  static let zeroChunk = 1024 * 1024
+
+  // Archive the items, each under its own name, into w. Files are reported under base,
+  // where the archive is going to be unpacked.
+  public static func pack(_ ts: [Translator], into w: Writer, reportingUnder base: String) -> CopyProgressInfoPublisher {
+    ts.publisher
+      .setFailureType(to: Error.self)
+      .flatMap(maxPublishers: .max(1)) { entries(of: $0) }
+      .flatMap(maxPublishers: .max(1)) { entry in
+        pack(entry, into: w, reportingAs: (base as NSString).appendingPathComponent(entry.path))
+      }
+      .append(Deferred { writeZeros(2 * blockSize, into: w) }.flatMap { _ in Empty<CopyProgressInfo, Error>() })
+      .eraseToAnyPublisher()
+  }
+
+  static func entries(of t: Translator) -> AnyPublisher<TreeEntry, Error> {
+    let name = (t.current as NSString).lastPathComponent
+
+    return t.stat()
+      .flatMap { attrs -> AnyPublisher<TreeEntry, Error> in
+        let root = TreeEntry(path: name, attributes: attrs, translator: t)
+        guard t.fileType == .typeDirectory else {
+          return .just(root)
+        }
+        guard let walker = t as? TreeWalker else {
+          return .fail(error: LocalFileError(msg: "Cannot walk \(t.current) to archive it"))
+        }
+
+        return Just(root).setFailureType(to: Error.self)
+          .append(walker.walkTree().map {
+            TreeEntry(path: (name as NSString).appendingPathComponent($0.path),
+                      attributes: $0.attributes,
+                      translator: $0.translator)
+          })
+          .eraseToAnyPublisher()
+      }.eraseToAnyPublisher()
+  }
+
+  static func pack(_ entry: TreeEntry, into w: Writer, reportingAs name: String) -> CopyProgressInfoPublisher {
+    switch entry.translator.fileType {
+    case .typeDirectory:
+      let header = headers(path: entry.path + "/", attributes: entry.attributes, type: UInt8(ascii: "5"), size: 0)
+      return w.write(header, max: header.count)
+        .flatMap { _ in Empty<CopyProgressInfo, Error>() }
+        .eraseToAnyPublisher()
+    case .typeRegular:
+      let size = (entry.attributes[.size] as? NSNumber)?.uint64Value ?? 0
+      let header = headers(path: entry.path, attributes: entry.attributes, type: UInt8(ascii: "0"), size: size)
+      let body = BodyWriter(w, size: size)
+
+      let contents: CopyProgressInfoPublisher
+      if size == 0 {
+        contents = Empty().eraseToAnyPublisher()
+      } else {
+        contents = entry.translator.open(flags: O_RDONLY)
+          .flatMap { file -> CopyProgressInfoPublisher in
+            (file as! WriterTo).writeTo(body)
+              .map { CopyProgressInfo(name: name, written: UInt64($0), size: size) }
+              .append(Deferred { file.close() }.flatMap { _ in Empty<CopyProgressInfo, Error>() })
+              .eraseToAnyPublisher()
+          }.eraseToAnyPublisher()
+      }
+
+      return w.write(header, max: header.count)
+        .flatMap { _ in Empty<CopyProgressInfo, Error>() }
+        .append(contents)
+        .append(Deferred { body.finish() }.flatMap { _ in Empty<CopyProgressInfo, Error>() })
+        .append(CopyProgressInfo(name: name, written: 0, size: size))
+        .eraseToAnyPublisher()
+    default:
+      // Links were already followed by the walk. Anything else has no contents to copy.
+      return Empty().eraseToAnyPublisher()
+    }
+  }
+
+  static func writeZeros(_ count: Int, into w: Writer) -> AnyPublisher<Int, Error> {
+    stride(from: 0, to: count, by: zeroChunk).publisher
+      .setFailureType(to: Error.self)
+      .flatMap(maxPublishers: .max(1)) { offset -> AnyPublisher<Int, Error> in
+        let length = min(zeroChunk, count - offset)
+        return w.write(zeros(length), max: length)
+      }
+      .reduce(0, +)
+      .eraseToAnyPublisher()
+  }
+
+  static func zeros(_ count: Int) -> DispatchData {
+    [UInt8](repeating: 0, count: count).withUnsafeBytes { DispatchData(bytes: $0) }
+  }
+
+  static func padding(for size: UInt64) -> Int {
+    let rest = Int(size % UInt64(blockSize))
+    return rest == 0 ? 0 : blockSize - rest
+  }
+
+  // Header blocks for the entry, preceded by a longname entry when the path does not fit.
+  static func headers(path: String, attributes: FileAttributes, type: UInt8, size: UInt64) -> DispatchData {
+    let mode = (attributes[.posixPermissions] as? NSNumber)?.intValue ?? (type == UInt8(ascii: "5") ? 0o755 : 0o644)
+    let uid = (attributes[.ownerAccountID] as? NSNumber)?.intValue ?? 0
+    let gid = (attributes[.groupOwnerAccountID] as? NSNumber)?.intValue ?? 0
+    let mtime = Int((attributes[.modificationDate] as? Date)?.timeIntervalSince1970 ?? Date().timeIntervalSince1970)
+
+    var blocks: [UInt8] = []
+    let bytes = Array(path.utf8)
+    var name = bytes
+    var prefix: [UInt8] = []
+
+    if bytes.count > 100 {
+      if let split = splitPoint(bytes) {
+        prefix = Array(bytes[..<split])
+        name = Array(bytes[(split + 1)...])
+      } else {
+        let longName = bytes + [0]
+        blocks += header(name: Array("././@LongLink".utf8), prefix: [], mode: 0, uid: 0, gid: 0,
+                         size: UInt64(longName.count), mtime: 0, type: UInt8(ascii: "L"))
+        blocks += longName + [UInt8](repeating: 0, count: padding(for: UInt64(longName.count)))
+        name = Array(bytes.prefix(100))
+      }
+    }
+
+    blocks += header(name: name, prefix: prefix, mode: mode, uid: uid, gid: gid, size: size, mtime: mtime, type: type)
+    return blocks.withUnsafeBytes { DispatchData(bytes: $0) }
+  }
+
+  // Where to cut a long path into the ustar prefix and name fields, if it fits at all.
+  static func splitPoint(_ bytes: [UInt8]) -> Int? {
+    let slash = UInt8(ascii: "/")
+    for i in stride(from: min(bytes.count - 2, 155), through: 1, by: -1) where bytes[i] == slash {
+      if bytes.count - i - 1 <= 100 {
+        return i
+      }
+      return nil
+    }
+    return nil
+  }
+
+  static func header(name: [UInt8], prefix: [UInt8], mode: Int, uid: Int, gid: Int,
+                     size: UInt64, mtime: Int, type: UInt8, linkName: [UInt8] = []) -> [UInt8] {
+    var h = [UInt8](repeating: 0, count: blockSize)
+
+    func put(_ bytes: [UInt8], at offset: Int, width: Int) {
+      for (i, b) in bytes.prefix(width).enumerated() {
+        h[offset + i] = b
+      }
+    }
+
+    // Octal, NUL terminated. Values too big for the field go in base-256.
+    func number(_ value: UInt64, at offset: Int, width: Int) {
+      let digits = String(value, radix: 8)
+      if digits.count < width {
+        let padded = String(repeating: "0", count: width - 1 - digits.count) + digits
+        put(Array(padded.utf8), at: offset, width: width - 1)
+      } else {
+        h[offset] = 0x80
+        var v = value
+        for i in stride(from: offset + width - 1, to: offset, by: -1) {
+          h[i] = UInt8(v & 0xff)
+          v >>= 8
+        }
+      }
+    }
+
+    put(name, at: 0, width: 100)
+    number(UInt64(mode & 0o7777), at: 100, width: 8)
+    number(UInt64(max(uid, 0)), at: 108, width: 8)
+    number(UInt64(max(gid, 0)), at: 116, width: 8)
+    number(size, at: 124, width: 12)
+    number(UInt64(max(mtime, 0)), at: 136, width: 12)
+    put([UInt8](repeating: UInt8(ascii: " "), count: 8), at: 148, width: 8)
+    h[156] = type
+    put(linkName, at: 157, width: 100)
+    put(Array("ustar".utf8) + [0], at: 257, width: 6)
+    put(Array("00".utf8), at: 263, width: 2)
+    put(prefix, at: 345, width: 155)
+
+    let checksum = h.reduce(0) { $0 + Int($1) }
+    put(Array(String(format: "%06o", checksum).utf8) + [0, UInt8(ascii: " ")], at: 148, width: 8)
+
+    return h
+  }
+
+  static func number(_ field: ArraySlice<UInt8>) -> UInt64 {
+    guard let first = field.first else {
+      return 0
+    }
+    if first & 0x80 != 0 {
+      return field.dropFirst().reduce(UInt64(first & 0x7f)) { ($0 << 8) | UInt64($1) }
+    }
+
+    var value: UInt64 = 0
+    for b in field {
+      if b >= UInt8(ascii: "0") && b <= UInt8(ascii: "7") {
+        value = value * 8 + UInt64(b - UInt8(ascii: "0"))
+      } else if b == 0 || (b == UInt8(ascii: " ") && value > 0) {
+        break
+      }
+    }
+    return value
+  }
+
+  static func string(_ field: ArraySlice<UInt8>) -> String {
+    String(decoding: field.prefix { $0 != 0 }, as: UTF8.self)
+  }
+}
+
+// Cuts or fills the contents of a file to the size announced in its header, in case
+// the file changed in between, and pads them to the block.
+fileprivate final class BodyWriter: Writer {
+  let w: Writer
+  let size: UInt64
+  var written: UInt64 = 0
+
+  init(_ w: Writer, size: UInt64) {
+    self.w = w
+    self.size = size
+  }
+
+  func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    let count = min(buf.count, length)
+    let n = Int(min(UInt64(count), size - written))
+    written += UInt64(n)
+    if n == 0 {
+      return .just(count)
+    }
+
+    let data = n == buf.count ? buf : buf.subdata(in: 0..<n)
+    return w.write(data, max: n)
+      .map { _ in count }
+      .eraseToAnyPublisher()
+  }
+
+  func finish() -> AnyPublisher<Int, Error> {
+    let missing = Int(size - written)
+    written = size
+    return Tar.writeZeros(missing + Tar.padding(for: size), into: w)
+  }
+}
+
+// Unpacks an archive written to it into a local directory. Entries that would land
+// outside of it are refused, and symbolic links are only created once everything
+// else is in place, so no file is ever written through a link from the archive.
+public final class TarExtractor: Writer {
+  private enum Extension {
+    case longName
+    case longLink
+    case pax
+  }
+
+  private enum State {
+    case header
+    case contents(UInt64)
+    case extended(Extension, UInt64, [UInt8])
+    case skip(UInt64)
+    case end
+  }
+
+  private struct OpenFile {
+    let fd: Int32
+    let path: String
+    let size: UInt64
+    let mode: mode_t
+    let mtime: time_t
+    var written: UInt64 = 0
+    var reported: UInt64 = 0
+  }
+
+  let root: String
+  let preserve: CopyAttributesFlag
+  private let queue = DispatchQueue(label: "TarExtractor")
+  private var state = State.header
+  private var headerBuffer: [UInt8] = []
+  private var zeroBlocks = 0
+  private var nextPath: String? = nil
+  private var nextLinkPath: String? = nil
+  private var nextSize: UInt64? = nil
+  private var file: OpenFile? = nil
+  private var directories: [(path: String, mode: mode_t, mtime: time_t)] = []
+  private var links: [(path: String, target: String)] = []
+  private var progress: [CopyProgressInfo] = []
+  private let progressLock = NSLock()
+
+  public init(into t: Translator, preserve: CopyAttributesFlag) throws {
+    guard t is Local, t.isDirectory else {
+      throw LocalFileError(msg: "Archives can only be unpacked into a local directory")
+    }
+    self.root = t.current
+    self.preserve = preserve
+    headerBuffer.reserveCapacity(Tar.blockSize)
+  }
+
+  deinit {
+    if let file = file {
+      Darwin.close(file.fd)
+    }
+  }
+
+  public func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    let data = buf.count > length ? buf.subdata(in: 0..<length) : buf
+
+    // Off the channel loop, as this is where the disk is written.
+    return Just(data)
+      .receive(on: queue)
+      .tryMap { data -> Int in
+        for region in data.regions {
+          try region.withUnsafeBytes { try self.consume($0) }
+        }
+        self.reportWritten()
+        return data.count
+      }.eraseToAnyPublisher()
+  }
+
+  // Unpack everything r writes, reporting the files as they are written.
+  public func unpack(from r: WriterTo) -> CopyProgressInfoPublisher {
+    r.writeTo(self)
+      .flatMap { _ in self.takeProgress().publisher.setFailureType(to: Error.self) }
+      .append(Deferred {
+        Just(()).setFailureType(to: Error.self).receive(on: self.queue).flatMap { self.finish() }
+      })
+      .eraseToAnyPublisher()
+  }
+
+  // Progress for what was unpacked since the last call. Downstream of write, we may
+  // be running on the queue already.
+  private func takeProgress() -> [CopyProgressInfo] {
+    progressLock.lock()
+    defer {
+      progress.removeAll()
+      progressLock.unlock()
+    }
+    return progress
+  }
+
+  // Once the archive is over, create the links and settle the directories.
+  private func finish() -> CopyProgressInfoPublisher {
+    switch state {
+    case .end:
+      break
+    case .header where headerBuffer.isEmpty && zeroBlocks > 0:
+      break
+    default:
+      return .fail(error: LocalFileError(msg: "Archive ended unexpectedly"))
+    }
+
+    for link in links {
+      unlink(link.path)
+      if symlink(link.target, link.path) != 0 {
+        return .fail(error: LocalFileError(msg: "Could not create link \(link.path). \(String(cString: strerror(errno)))"))
+      }
+    }
+
+    // Children first, as creating entries changes the modification time of their parent.
+    for dir in directories.reversed() {
+      if preserve.contains(.permissions) {
+        chmod(dir.path, dir.mode)
+      }
+      if preserve.contains(.timestamp) {
+        var times = [timeval(tv_sec: dir.mtime, tv_usec: 0), timeval(tv_sec: dir.mtime, tv_usec: 0)]
+        utimes(dir.path, &times)
+      }
+    }
+
+    return Empty().eraseToAnyPublisher()
+  }
+
+  private func consume(_ bytes: UnsafeRawBufferPointer) throws {
+    var offset = 0
+
+    while offset < bytes.count {
+      let available = bytes.count - offset
+
+      switch state {
+      case .end:
+        // Trailing blocks after the end of the archive.
+        return
+      case .header:
+        let n = min(Tar.blockSize - headerBuffer.count, available)
+        headerBuffer.append(contentsOf: bytes[offset..<(offset + n)])
+        offset += n
+        if headerBuffer.count == Tar.blockSize {
+          try parseHeader()
+          headerBuffer.removeAll(keepingCapacity: true)
+        }
+      case .contents(let remaining):
+        let n = Int(min(UInt64(available), remaining))
+        try writeContents(bytes.baseAddress! + offset, count: n)
+        offset += n
+        if remaining == UInt64(n) {
+          try closeFile()
+        } else {
+          state = .contents(remaining - UInt64(n))
+        }
+      case .extended(let kind, let remaining, var data):
+        let n = Int(min(UInt64(available), remaining))
+        data.append(contentsOf: bytes[offset..<(offset + n)])
+        offset += n
+        if remaining == UInt64(n) {
+          apply(kind, data)
+          state = skipPadding(for: UInt64(data.count))
+        } else {
+          state = .extended(kind, remaining - UInt64(n), data)
+        }
+      case .skip(let remaining):
+        let n = Int(min(UInt64(available), remaining))
+        offset += n
+        state = remaining == UInt64(n) ? .header : .skip(remaining - UInt64(n))
+      }
+    }
+  }
+
+  private func skipPadding(for size: UInt64) -> State {
+    let padding = Tar.padding(for: size)
+    return padding == 0 ? .header : .skip(UInt64(padding))
+  }
+
+  private func parseHeader() throws {
+    let h = headerBuffer[...]
+    if h.allSatisfy({ $0 == 0 }) {
+      zeroBlocks += 1
+      if zeroBlocks == 2 {
+        state = .end
+      }
+      return
+    }
+    zeroBlocks = 0
+
+    var sum = h.reduce(0) { $0 + Int($1) }
+    sum -= h[148..<156].reduce(0) { $0 + Int($1) } - 8 * Int(UInt8(ascii: " "))
+    guard UInt64(sum) == Tar.number(h[148..<156]) else {
+      throw LocalFileError(msg: "Invalid archive header")
+    }
+
+    let type = h[156]
+    let size = nextSize ?? Tar.number(h[124..<136])
+    var name = Tar.string(h[0..<100])
+    let prefix = Tar.string(h[345..<500])
+    if Tar.string(h[257..<262]) == "ustar" && !prefix.isEmpty {
+      name = prefix + "/" + name
+    }
+    let path = nextPath ?? name
+    let linkPath = nextLinkPath ?? Tar.string(h[157..<257])
+    let mode = mode_t(Tar.number(h[100..<108]) & 0o7777)
+    let mtime = time_t(Tar.number(h[136..<148]))
+
+    // Extended headers only apply to the entry right after them.
+    switch type {
+    case UInt8(ascii: "L"):
+      state = .extended(.longName, size, [])
+      return
+    case UInt8(ascii: "K"):
+      state = .extended(.longLink, size, [])
+      return
+    case UInt8(ascii: "x"):
+      state = .extended(.pax, size, [])
+      return
+    default:
+      nextPath = nil
+      nextLinkPath = nil
+      nextSize = nil
+    }
+
+    guard let localPath = try self.localPath(path) else {
+      // The root of the archive itself.
+      state = size > 0 ? .skip(size + UInt64(Tar.padding(for: size))) : .header
+      return
+    }
+
+    switch type {
+    case UInt8(ascii: "5"):
+      try makeDirectory(localPath)
+      directories.append((localPath, mode, mtime))
+      state = .header
+    case UInt8(ascii: "0"), 0, UInt8(ascii: "7"):
+      try openFile(localPath, size: size, mode: mode, mtime: mtime)
+      if size == 0 {
+        try closeFile()
+      } else {
+        state = .contents(size)
+      }
+    case UInt8(ascii: "1"):
+      guard let target = try self.localPath(linkPath) else {
+        throw LocalFileError(msg: "Invalid hard link \(path)")
+      }
+      try makeHardLink(localPath, to: target)
+      // Some archivers repeat the contents of the target, which is already in place.
+      state = size > 0 ? .skip(size + UInt64(Tar.padding(for: size))) : .header
+    case UInt8(ascii: "2"):
+      links.append((localPath, linkPath))
+      state = .header
+    default:
+      // Devices, fifos and global headers are not unpacked.
+      state = size > 0 ? .skip(size + UInt64(Tar.padding(for: size))) : .header
+    }
+  }
+
+  private func apply(_ kind: Extension, _ data: [UInt8]) {
+    switch kind {
+    case .longName:
+      nextPath = Tar.string(data[...])
+    case .longLink:
+      nextLinkPath = Tar.string(data[...])
+    case .pax:
+      // Records are "<length> <key>=<value>\n"
+      var offset = 0
+      while offset < data.count {
+        guard let space = data[offset...].firstIndex(of: UInt8(ascii: " ")),
+              let length = Int(String(decoding: data[offset..<space], as: UTF8.self)),
+              length > 0, offset + length <= data.count else {
+          return
+        }
+        let record = String(decoding: data[(space + 1)..<(offset + length - 1)], as: UTF8.self)
+        if let eq = record.firstIndex(of: "=") {
+          let value = String(record[record.index(after: eq)...])
+          switch record[..<eq] {
+          case "path": nextPath = value
+          case "linkpath": nextLinkPath = value
+          case "size": nextSize = UInt64(value)
+          default: break
+          }
+        }
+        offset += length
+      }
+    }
+  }
+
+  // Path under root for the entry. Nil for the root itself.
+  private func localPath(_ path: String) throws -> String? {
+    let components = path.split(separator: "/").filter { $0 != "." }
+    if components.contains("..") {
+      throw LocalFileError(msg: "Refusing to unpack \(path) outside of \(root)")
+    }
+    if components.isEmpty {
+      return nil
+    }
+    return (root as NSString).appendingPathComponent(components.joined(separator: "/"))
+  }
+
+  private func makeDirectory(_ path: String) throws {
+    var isDir: ObjCBool = false
+    if FileManager.default.fileExists(atPath: path, isDirectory: &isDir) && isDir.boolValue {
+      return
+    }
+    do {
+      try FileManager.default.createDirectory(atPath: path, withIntermediateDirectories: true)
+    } catch {
+      throw LocalFileError(msg: "Could not create directory \(path). \(error.localizedDescription)")
+    }
+  }
+
+  private func openFile(_ path: String, size: UInt64, mode: mode_t, mtime: time_t) throws {
+    var fd = Darwin.open(path, O_WRONLY | O_CREAT | O_TRUNC, 0o644)
+    if fd < 0 && errno == ENOENT {
+      // Archives do not always carry the directories.
+      try makeDirectory((path as NSString).deletingLastPathComponent)
+      fd = Darwin.open(path, O_WRONLY | O_CREAT | O_TRUNC, 0o644)
+    }
+    guard fd >= 0 else {
+      throw LocalFileError(msg: "Could not create file \(path). \(String(cString: strerror(errno)))")
+    }
+    file = OpenFile(fd: fd, path: path, size: size, mode: mode, mtime: mtime)
+  }
+
+  // Hard links point to a file earlier in the archive, so the target is already
+  // unpacked. Where the volume cannot link it, the entry gets a copy instead.
+  private func makeHardLink(_ path: String, to target: String) throws {
+    var st = stat()
+    guard lstat(target, &st) == 0, (st.st_mode & S_IFMT) == S_IFREG else {
+      throw LocalFileError(msg: "Could not link \(path). \(target) is not a file in the archive")
+    }
+
+    if path == target {
+      return
+    }
+    unlink(path)
+    var rc = linkat(AT_FDCWD, target, AT_FDCWD, path, 0)
+    if rc != 0 && errno == ENOENT {
+      try makeDirectory((path as NSString).deletingLastPathComponent)
+      rc = linkat(AT_FDCWD, target, AT_FDCWD, path, 0)
+    }
+    if rc != 0 {
+      let linkError = String(cString: strerror(errno))
+      do {
+        try FileManager.default.copyItem(atPath: target, toPath: path)
+      } catch {
+        throw LocalFileError(msg: "Could not link \(path). \(linkError)")
+      }
+    }
+
+    report(CopyProgressInfo(name: path, written: 0, size: UInt64(st.st_size)))
+  }
+
+  private func writeContents(_ bytes: UnsafeRawPointer, count: Int) throws {
+    guard var f = file else {
+      return
+    }
+
+    var done = 0
+    while done < count {
+      let rc = Darwin.write(f.fd, bytes + done, count - done)
+      if rc < 0 {
+        if errno == EINTR {
+          continue
+        }
+        throw LocalFileError(msg: "Could not write \(f.path). \(String(cString: strerror(errno)))")
+      }
+      done += rc
+    }
+    f.written += UInt64(count)
+    file = f
+  }
+
+  private func closeFile() throws {
+    guard let f = file else {
+      return
+    }
+    file = nil
+    reportWritten(f)
+
+    if preserve.contains(.permissions) {
+      fchmod(f.fd, f.mode)
+    }
+    if preserve.contains(.timestamp) {
+      var times = [timeval(tv_sec: f.mtime, tv_usec: 0), timeval(tv_sec: f.mtime, tv_usec: 0)]
+      futimes(f.fd, &times)
+    }
+    if Darwin.close(f.fd) != 0 {
+      throw LocalFileError(msg: "Could not write \(f.path). \(String(cString: strerror(errno)))")
+    }
+
+    report(CopyProgressInfo(name: f.path, written: 0, size: f.size))
+    state = skipPadding(for: f.size)
+  }
+
+  private func report(_ info: CopyProgressInfo) {
+    progressLock.lock()
+    progress.append(info)
+    progressLock.unlock()
+  }
+
+  // One report per file and write, instead of one per region.
+  private func reportWritten(_ f: OpenFile? = nil) {
+    guard var f = f ?? file, f.written > f.reported else {
+      return
+    }
+    report(CopyProgressInfo(name: f.path, written: f.written - f.reported, size: f.size))
+    f.reported = f.written
+    if file?.fd == f.fd {
+      file = f
+    }
+  }
+}
@@ -73,4 +73,140 @@ class BlinkFilesTests: XCTestCase {
     
     wait(for: [expectMatches], timeout: 3)
   }
+
+  func testCachingTranslatorInvalidatesOnCreate() throws {
+    let root = (NSTemporaryDirectory() as NSString).appendingPathComponent("cachingTranslator")
+    try? FileManager.default.removeItem(atPath: root)
+    try FileManager.default.createDirectory(atPath: root, withIntermediateDirectories: true)
+
+    let cache = TranslatorCache(ttl: 60)
+    let t = CachingTranslator(Local(), cache: cache)
+    var listings: [Int] = []
+
+    let expectListed = expectation(description: "Listed")
+    let c = t.walkTo(root)
+      .flatMap { dir in
+        dir.directoryFilesAndAttributes()
+          .flatMap { first -> AnyPublisher<[FileAttributes], Error> in
+            listings.append(first.count)
+            return dir.directoryFilesAndAttributes()
+          }
+          .flatMap { second -> AnyPublisher<[FileAttributes], Error> in
+            listings.append(second.count)
+            return dir.clone().create(name: "file", flags: O_WRONLY, mode: S_IRWXU)
+              .flatMap { $0.close() }
+              .flatMap { _ in dir.directoryFilesAndAttributes() }
+              .eraseToAnyPublisher()
+          }
+      }
+      .assertNoFailure()
+      .sink(receiveCompletion: { _ in
+        expectListed.fulfill()
+      }, receiveValue: { third in
+        listings.append(third.count)
+      })
+
+    wait(for: [expectListed], timeout: 3)
+    c.cancel()
+
+    XCTAssertEqual(listings, [0, 0, 1])
+    // Second listing comes from the cache. First and last go to the Translator.
+    XCTAssertEqual(cache.hits, 1)
+  }
+
+  func testCachingTranslatorKeepsRenameErrors() throws {
+    let root = (NSTemporaryDirectory() as NSString).appendingPathComponent("cachingTranslatorMove")
+    try? FileManager.default.removeItem(atPath: root)
+    try FileManager.default.createDirectory(atPath: root, withIntermediateDirectories: true)
+    XCTAssertTrue(FileManager.default.createFile(atPath: (root as NSString).appendingPathComponent("a"), contents: nil))
+
+    let t = CachingTranslator(Local())
+    // Local cannot operate on trees, and neither can its wrapper.
+    XCTAssertNil(t as Any as? TreeOperator)
+
+    let expectFailed = expectation(description: "Move failed")
+    let c = t.walkTo((root as NSString).appendingPathComponent("a"))
+      .flatMap { $0.moveTree(to: "missing/b") }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTAssertTrue(error is LocalFileError)
+          XCTAssertNotEqual((error as? LocalFileError)?.msg, "Translator cannot operate on trees")
+        } else {
+          XCTFail("Move should fail")
+        }
+        expectFailed.fulfill()
+      }, receiveValue: {})
+
+    wait(for: [expectFailed], timeout: 3)
+    c.cancel()
+  }
+
+  func testTarRoundTrip() throws {
+    let fm = FileManager.default
+    let base = (NSTemporaryDirectory() as NSString).appendingPathComponent("tarRoundTrip")
+    let source = (base as NSString).appendingPathComponent("tree")
+    let destination = (base as NSString).appendingPathComponent("out")
+    try? fm.removeItem(atPath: base)
+    let longDir = String(repeating: "d", count: 90) + "/" + String(repeating: "e", count: 90)
+    try fm.createDirectory(atPath: (source as NSString).appendingPathComponent(longDir), withIntermediateDirectories: true)
+    try fm.createDirectory(atPath: destination, withIntermediateDirectories: true)
+    let files = [
+      "empty": Data(),
+      "small": Data("hello".utf8),
+      "\(longDir)/\(String(repeating: "f", count: 120))": Data((0..<100_000).map { UInt8($0 % 251) })
+    ]
+    for (name, contents) in files {
+      XCTAssertTrue(fm.createFile(atPath: (source as NSString).appendingPathComponent(name), contents: contents))
+    }
+
+    let archive = ArchiveBuffer()
+    let expectUnpacked = expectation(description: "Unpacked")
+    let c = Local().cloneWalkTo(source)
+      .flatMap { Tar.pack([$0], into: archive, reportingUnder: "/") }
+      .collect()
+      .map { _ -> Void in
+        // A hard link to a file already in the archive, before the end blocks.
+        let end = archive.data.count - 2 * Tar.blockSize
+        archive.data = archive.data.subdata(in: 0..<end)
+        let link = Tar.header(name: Array("tree/hard".utf8), prefix: [], mode: 0o644, uid: 0, gid: 0,
+                              size: 0, mtime: 0, type: UInt8(ascii: "1"), linkName: Array("tree/small".utf8))
+        archive.data.append((link + [UInt8](repeating: 0, count: 2 * Tar.blockSize)).withUnsafeBytes { DispatchData(bytes: $0) })
+      }
+      .flatMap { _ in Local().cloneWalkTo(destination) }
+      .flatMap { try! TarExtractor(into: $0, preserve: [.permissions]).unpack(from: archive) }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("Round trip failed \(error)")
+        }
+        expectUnpacked.fulfill()
+      }, receiveValue: { _ in })
+
+    wait(for: [expectUnpacked], timeout: 5)
+    c.cancel()
+
+    XCTAssertEqual(archive.data.count % 512, 0)
+    for (name, contents) in files {
+      let path = ((destination as NSString).appendingPathComponent("tree") as NSString).appendingPathComponent(name)
+      XCTAssertEqual(fm.contents(atPath: path), contents, name)
+    }
+    let tree = (destination as NSString).appendingPathComponent("tree")
+    let hard = (tree as NSString).appendingPathComponent("hard")
+    XCTAssertEqual(fm.contents(atPath: hard), files["small"])
+    XCTAssertEqual(try fm.attributesOfItem(atPath: hard)[.systemFileNumber] as? NSNumber,
+                   try fm.attributesOfItem(atPath: (tree as NSString).appendingPathComponent("small"))[.systemFileNumber] as? NSNumber)
+  }
+}
+
+// Keeps what is written to it, and writes it all again on demand.
+class ArchiveBuffer: Writer, WriterTo {
+  var data = DispatchData.empty
+
+  func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    data.append(buf)
+    return .just(buf.count)
+  }
+
+  func writeTo(_ w: Writer) -> AnyPublisher<Int, Error> {
+    w.write(data, max: data.count)
+  }
 }
@@ -90,4 +90,35 @@ class CopyFilesTests: XCTestCase {
     
     wait(for: [expectStructureCopied], timeout: 1000)
   }
+
+  func testWalkTreeDeliversParentsFirst() throws {
+    let root = (NSTemporaryDirectory() as NSString).appendingPathComponent("walkTree")
+    let fm = FileManager.default
+    try? fm.removeItem(atPath: root)
+    for i in 0..<20 {
+      let dir = (root as NSString).appendingPathComponent("d\(i)/e\(i)")
+      try fm.createDirectory(atPath: dir, withIntermediateDirectories: true)
+      XCTAssertTrue(fm.createFile(atPath: (dir as NSString).appendingPathComponent("f"), contents: Data("x".utf8)))
+    }
+
+    let expectWalked = self.expectation(description: "Tree Walked")
+    var seen = Set<String>()
+
+    let c = Local().cloneWalkTo(root)
+      .flatMap { ($0 as! TreeWalker).walkTree() }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("Crash \(error)")
+        }
+        expectWalked.fulfill()
+      }, receiveValue: { entry in
+        let parent = (entry.path as NSString).deletingLastPathComponent
+        XCTAssertTrue(parent.isEmpty || seen.contains(parent), "\(entry.path) before its parent")
+        seen.insert(entry.path)
+      })
+
+    wait(for: [expectWalked], timeout: 10)
+    c.cancel()
+    XCTAssertEqual(seen.count, 60)
+  }
 }
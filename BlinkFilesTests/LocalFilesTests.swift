@@ -162,6 +162,31 @@ class LocalFilesTests: XCTestCase {
     waitForExpectations(timeout: 15, handler: nil)
   }
   
+  func testMappedFileWriteTo() throws {
+    let path = (NSTemporaryDirectory() as NSString).appendingPathComponent("mapped")
+    let size = 3 * 1024 * 1024 + 123
+    XCTAssertTrue(FileManager.default.createFile(atPath: path, contents: Data(count: size)))
+
+    let expectation = self.expectation(description: "Buffer Complete")
+    let buffer = MemoryBuffer(fast: true)
+
+    Local().walkTo(path)
+      .flatMap { $0.open(flags: O_RDONLY) }
+      .flatMap { file -> AnyPublisher<Int, Error> in
+        XCTAssertNotNil((file as! LocalFile).region, "Read-only file should be mapped.")
+        return (file as! WriterTo).writeTo(buffer)
+      }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("Could not copy mapped file \(error)")
+        }
+        XCTAssertEqual(buffer.count, size)
+        expectation.fulfill()
+      }, receiveValue: { _ in }).store(in: &cancellableBag)
+
+    waitForExpectations(timeout: 5, handler: nil)
+  }
+
   // WriteToWriter
   // Hash check for result
   func testFileWriteToWriter() throws {
@@ -223,6 +248,69 @@ class LocalFilesTests: XCTestCase {
     
     waitForExpectations(timeout: 2, handler: nil)
   }
+
+  func testRemoveTree() throws {
+    let root = (NSTemporaryDirectory() as NSString).appendingPathComponent("removeTree")
+    let fm = FileManager.default
+    try? fm.removeItem(atPath: root)
+    for dir in ["a", "a/b", "c"] {
+      try fm.createDirectory(atPath: (root as NSString).appendingPathComponent(dir), withIntermediateDirectories: true)
+    }
+    for file in ["f1", "a/f2", "a/b/f3", "c/f4"] {
+      XCTAssertTrue(fm.createFile(atPath: (root as NSString).appendingPathComponent(file), contents: Data("x".utf8)))
+    }
+
+    let expectation = self.expectation(description: "Tree removed")
+
+    Local().walkTo(root)
+      .flatMap { $0.removeTree() }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("Could not remove tree \(error)")
+        }
+        expectation.fulfill()
+      }, receiveValue: {}).store(in: &cancellableBag)
+
+    waitForExpectations(timeout: 5, handler: nil)
+    XCTAssertFalse(fm.fileExists(atPath: root))
+  }
+
+  func testRemoveTreeKeepsLinkTargets() throws {
+    let tmp = NSTemporaryDirectory() as NSString
+    let root = tmp.appendingPathComponent("removeTreeLinks")
+    let outside = tmp.appendingPathComponent("removeTreeOutside")
+    let fm = FileManager.default
+    for dir in [root, outside] {
+      try? fm.removeItem(atPath: dir)
+      try fm.createDirectory(atPath: (dir as NSString).appendingPathComponent("a"), withIntermediateDirectories: true)
+    }
+    let outsideFile = (outside as NSString).appendingPathComponent("a/keep")
+    XCTAssertTrue(fm.createFile(atPath: outsideFile, contents: Data("x".utf8)))
+    try fm.createSymbolicLink(atPath: (root as NSString).appendingPathComponent("a/dirLink"), withDestinationPath: outside)
+    try fm.createSymbolicLink(atPath: (root as NSString).appendingPathComponent("fileLink"), withDestinationPath: outsideFile)
+    let topLink = tmp.appendingPathComponent("removeTreeTopLink")
+    try? fm.removeItem(atPath: topLink)
+    try fm.createSymbolicLink(atPath: topLink, withDestinationPath: outside)
+
+    let expectation = self.expectation(description: "Trees removed")
+
+    // Removing a link to a directory removes the link only.
+    Local().cloneWalkTo(entry: topLink)
+      .flatMap { $0.removeTree() }
+      .flatMap { Local().cloneWalkTo(entry: root) }
+      .flatMap { $0.removeTree() }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("Could not remove tree \(error)")
+        }
+        expectation.fulfill()
+      }, receiveValue: {}).store(in: &cancellableBag)
+
+    waitForExpectations(timeout: 5, handler: nil)
+    XCTAssertFalse(fm.fileExists(atPath: root))
+    XCTAssertNil(try? fm.destinationOfSymbolicLink(atPath: topLink))
+    XCTAssertTrue(fm.fileExists(atPath: outsideFile))
+  }
 }
 
 class MemoryBuffer: Writer {
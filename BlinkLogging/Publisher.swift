@@ -33,11 +33,53 @@
 import Foundation
 import Combine
 
+// Log records are staged in a preallocated buffer and written to the file
+// in a single write once the buffer fills up or after a short interval.
+// Producers never block on the file. If the buffer reaches its cap before it
+// can be written, records are dropped and the count is logged on the next write.
+// Files rotate at a size cap, keeping a few previous ones, optionally compressed.
 public class FileLogging {
-  private let h: FileHandle
+  public struct Options {
+    // Rotate once the file reaches this size.
+    public var maxFileSize: UInt64 = 1 * 1024 * 1024
+    // Rotated files kept next to the current one, as <name>.1, <name>.2...
+    public var maxRotatedFiles = 3
+    // Compress the rotated files with zlib, as <name>.1.zlib...
+    public var compressRotated = false
+    // Write once this many bytes are staged.
+    public var flushSize = 64 * 1024
+    // Or once this time has passed since the first staged record.
+    public var flushInterval: TimeInterval = 0.5
+    // Drop records once this many bytes are staged.
+    public var maxStagedSize = 1 * 1024 * 1024
+    
+    public init() {}
+  }
+  
+  private var h: FileHandle
+  private let url: URL
+  let options: Options
   let queue = DispatchQueue(label: "FileLogging")
   
-  public init(to url: URL) throws {
+  private let lock = NSLock()
+  // Records waiting to be written, and the buffer being written. They are swapped on flush.
+  private var staged = Data()
+  private var writing = Data()
+  private var flushScheduled = false
+  private var droppedSinceFlush = 0
+  public private(set) var droppedRecords = 0
+  private var fileSize: UInt64 = 0
+  
+  public init(to url: URL, options: Options = Options()) throws {
+    self.url = url
+    self.options = options
+    self.h = try FileLogging.open(url)
+    self.fileSize = h.seekToEndOfFile()
+    self.staged.reserveCapacity(options.maxStagedSize)
+    self.writing.reserveCapacity(options.maxStagedSize)
+  }
+  
+  private static func open(_ url: URL) throws -> FileHandle {
     let fm = FileManager.default
     
     let attrs: [FileAttributeKey : Any] = [.protectionKey: FileProtectionType.none]
@@ -50,30 +92,116 @@ public class FileLogging {
       try fm.setAttributes(attrs, ofItemAtPath: url.path)
     }
     
-    self.h = try FileHandle(forWritingTo: url)
-    h.truncateFile(atOffset: 0)
-    //h.seekToEndOfFile()
+    return try FileHandle(forWritingTo: url)
+  }
+  
+  // Stage a record to be written. Safe to call from any thread.
+  func append(_ record: String) {
+    let utf8 = record.utf8
+    var flushNow = false
+    var scheduleFlush = false
+    
+    lock.lock()
+    if staged.count + utf8.count > options.maxStagedSize {
+      droppedSinceFlush += 1
+      droppedRecords += 1
+    } else {
+      staged.append(contentsOf: utf8)
+    }
+    if staged.count >= options.flushSize {
+      flushNow = true
+    } else if !flushScheduled {
+      flushScheduled = true
+      scheduleFlush = true
+    }
+    lock.unlock()
+    
+    if flushNow {
+      queue.async { self.flush() }
+    } else if scheduleFlush {
+      queue.asyncAfter(deadline: .now() + options.flushInterval) { self.flush() }
+    }
+  }
+  
+  // Write all staged records. Runs on the queue.
+  func flush() {
+    lock.lock()
+    swap(&staged, &writing)
+    flushScheduled = false
+    let dropped = droppedSinceFlush
+    droppedSinceFlush = 0
+    lock.unlock()
+    
+    if dropped > 0 {
+      writing.append(contentsOf: "FileLogging - Dropped \(dropped) records\n".utf8)
+    }
+    guard !writing.isEmpty else {
+      return
+    }
+    
+    if fileSize > 0 && fileSize + UInt64(writing.count) > options.maxFileSize {
+      rotate()
+    }
+    write(writing)
+    writing.removeAll(keepingCapacity: true)
   }
   
-  func write(_ data: Data) {
+  private func write(_ data: Data) {
     do {
       try h.write(contentsOf: data)
+      fileSize += UInt64(data.count)
     } catch {
       debugPrint("Failed to write log: ", error)
     }
   }
+  
+  private func rotatedURL(_ idx: Int) -> URL {
+    let rotated = url.appendingPathExtension("\(idx)")
+    return options.compressRotated ? rotated.appendingPathExtension("zlib") : rotated
+  }
+  
+  // Shift the rotated files, move the current one to <name>.1 and start a new one.
+  private func rotate() {
+    let fm = FileManager.default
+    try? h.close()
+    
+    if options.maxRotatedFiles > 0 {
+      try? fm.removeItem(at: rotatedURL(options.maxRotatedFiles))
+      for idx in stride(from: options.maxRotatedFiles - 1, through: 1, by: -1) {
+        try? fm.moveItem(at: rotatedURL(idx), to: rotatedURL(idx + 1))
+      }
+      if options.compressRotated {
+        if let data = try? NSData(contentsOf: url).compressed(using: .zlib) {
+          try? data.write(to: rotatedURL(1))
+        }
+        try? fm.removeItem(at: url)
+      } else {
+        try? fm.moveItem(at: url, to: rotatedURL(1))
+      }
+    } else {
+      try? fm.removeItem(at: url)
+    }
+    
+    do {
+      h = try FileLogging.open(url)
+      h.truncateFile(atOffset: 0)
+    } catch {
+      debugPrint("Failed to rotate log: ", error)
+    }
+    fileSize = 0
+  }
+  
+  deinit {
+    // Nothing else holds the logger here, so there are no flushes in progress.
+    flush()
+  }
 }
 
 extension Publisher {
   public func sinkToFile(_ file: FileLogging) throws -> AnyCancellable where Self.Output == [BlinkLogKeys:Any] {
-    // TODO receive(on:)
-    return receive(on: file.queue)
-      .sink(receiveCompletion: { _ in},
-                receiveValue: { string in
-      let string = "\(string[.message] as? String ?? "")\n"
-      if let data = (string).data(using: .utf8) {
-        file.write(data)
-      }
+    return sink(receiveCompletion: { _ in },
+                receiveValue: { log in
+      file.append("\(log[.message] as? String ?? "")\n")
     })
   }
 
@@ -111,6 +111,28 @@ class BlinkLoggingTests: XCTestCase {
     XCTAssert(result == "\(message[0])\n\(message[1])\n", "TestFileLogger got \n\(result)")
   }
 
+  func testFileLoggerRotation() throws {
+    let tmpDir = NSTemporaryDirectory()
+    let fileName = NSUUID().uuidString
+    let fileURL = NSURL.fileURL(withPathComponents: [tmpDir, fileName])!
+    var options = FileLogging.Options()
+    options.maxFileSize = 8
+    options.maxRotatedFiles = 1
+    options.flushSize = 1
+    let file = try FileLogging(to: fileURL, options: options)
+    let log = BlinkLogger(handlers: [ { try $0.sinkToFile(file) } ])
+    
+    log.send("line1")
+    sleep(1)
+    log.send("line2")
+    sleep(1)
+
+    let result = try String(contentsOf: fileURL)
+    let rotated = try String(contentsOf: fileURL.appendingPathExtension("1"))
+    XCTAssert(result == "line2\n", "TestFileLoggerRotation got \n\(result)")
+    XCTAssert(rotated == "line1\n", "TestFileLoggerRotation rotated \n\(rotated)")
+  }
+
   func testLogLevel() throws {
     let filteredMessages = ["info", "warn"]
 
@@ -349,5 +349,29 @@ class CompletionTests: XCTestCase {
     assert(token.isRedirect == true)
 
   }
+
+  func testRemoteLocation() {
+    assert(RemotePathCompleter.location("foo") == nil)
+    assert(RemotePathCompleter.location("./foo:bar") == nil)
+    assert(RemotePathCompleter.location("local:host:/tmp") == nil)
+
+    var location = RemotePathCompleter.location("host:")!
+    assert(location.prefix == "host:")
+    assert(location.hostPath == "host")
+    assert(location.directory == "")
+    assert(location.partial == "")
+
+    location = RemotePathCompleter.location("user@host:/var/lo")!
+    assert(location.prefix == "user@host:")
+    assert(location.hostPath == "user@host")
+    assert(location.directory == "/var/")
+    assert(location.partial == "lo")
+
+    location = RemotePathCompleter.location("sftp:host:~/src/")!
+    assert(location.prefix == "sftp:host:")
+    assert(location.hostPath == "host")
+    assert(location.directory == "~/src/")
+    assert(location.partial == "")
+  }
   
 }
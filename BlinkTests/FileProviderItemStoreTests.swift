@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import XCTest
+import BlinkFiles
+
+class FileProviderItemStoreTests: XCTestCase {
+  var url: URL!
+
+  // "cm9vdA==" is the encoded root path.
+  let container = BlinkItemIdentifier("cm9vdA==/dir")
+  let file = BlinkItemIdentifier("cm9vdA==/dir/file")
+  let other = BlinkItemIdentifier("cm9vdA==/dir/other")
+
+  override func setUpWithError() throws {
+    url = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+  }
+
+  override func tearDownWithError() throws {
+    try? FileManager.default.removeItem(at: url)
+  }
+
+  func testAttributesAndTombstonesRoundTrip() throws {
+    let modified = Date(timeIntervalSince1970: 1_600_000_000)
+    let store = FileProviderItemStore(at: url)
+
+    XCTAssertTrue(store.update(file, attributes: [.type: FileAttributeType.typeRegular,
+                                                  .size: NSNumber(value: 42),
+                                                  .modificationDate: modified]))
+    XCTAssertTrue(store.update(other, attributes: [.type: FileAttributeType.typeDirectory]))
+    // Same attributes do not move the anchor.
+    XCTAssertFalse(store.update(other, attributes: [.type: FileAttributeType.typeDirectory]))
+    let anchor = store.anchor(container: container)
+    XCTAssertEqual(anchor, 2)
+
+    store.remove(other)
+
+    let changes = try XCTUnwrap(store.changes(container: container, since: anchor))
+    XCTAssertEqual(changes.updated, [])
+    XCTAssertEqual(changes.deleted, ["other"])
+    XCTAssertEqual(changes.anchor, 3)
+
+    // Saves are coalesced, so wait for the container to reach disk.
+    let saved = expectation(for: NSPredicate { _, _ in
+      let files = try? FileManager.default.contentsOfDirectory(atPath: self.url.path)
+      return files?.isEmpty == false
+    }, evaluatedWith: nil)
+    wait(for: [saved], timeout: 5)
+
+    let reloaded = FileProviderItemStore(at: url)
+    let attrs = try XCTUnwrap(reloaded.attributes(for: file))
+    XCTAssertEqual(attrs[.name] as? String, "file")
+    XCTAssertEqual(attrs[.type] as? FileAttributeType, .typeRegular)
+    XCTAssertEqual((attrs[.size] as? NSNumber)?.uint64Value, 42)
+    XCTAssertEqual(attrs[.modificationDate] as? Date, modified)
+    XCTAssertNil(reloaded.attributes(for: other))
+
+    let reloadedChanges = try XCTUnwrap(reloaded.changes(container: container, since: 0))
+    XCTAssertEqual(reloadedChanges.updated, ["file"])
+    XCTAssertEqual(reloadedChanges.deleted, ["other"])
+    XCTAssertNil(reloaded.changes(container: container, since: 10))
+  }
+}
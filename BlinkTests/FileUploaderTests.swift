@@ -0,0 +1,121 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import XCTest
+
+class FileUploaderTests: XCTestCase {
+  let blockSize = FileUploader.blockSize
+
+  func content(blocks: Int, extra: Int = 0) -> Data {
+    Data((0..<(blocks * blockSize + extra)).map { UInt8($0 % 251) })
+  }
+
+  func uploaded(_ content: Data) -> FileUploader.Uploaded {
+    FileUploader.Uploaded(size: content.count, modified: 0, hashes: FileUploader.hashes(content))
+  }
+
+  func ranges(from old: Data, to new: Data) -> [Range<Int>]? {
+    FileUploader.changedRanges(from: uploaded(old), to: FileUploader.hashes(new), size: new.count)
+  }
+
+  func testChangedRangesMergesChangedBlocks() throws {
+    let old = content(blocks: 8)
+    var new = old
+    new[1 * blockSize] ^= 0xff
+    new[2 * blockSize + 10] ^= 0xff
+    new[5 * blockSize + 10] ^= 0xff
+
+    XCTAssertEqual(ranges(from: old, to: new), [(1 * blockSize)..<(3 * blockSize),
+                                               (5 * blockSize)..<(6 * blockSize)])
+    XCTAssertEqual(ranges(from: old, to: old), [])
+  }
+
+  func testChangedRangesOnGrowth() throws {
+    let old = content(blocks: 8, extra: 100)
+    var new = old
+    new.append(Data(repeating: 7, count: blockSize))
+
+    // The last block of the old file changed, and everything after it is new.
+    XCTAssertEqual(ranges(from: old, to: new), [(8 * blockSize)..<new.count])
+  }
+
+  func testChangedRangesOnShrink() throws {
+    let old = content(blocks: 8)
+    XCTAssertNil(ranges(from: old, to: old.prefix(7 * blockSize)))
+  }
+
+  func testChangedRangesWhenMostChanged() throws {
+    let old = content(blocks: 8)
+    var new = old
+    for block in 0..<5 {
+      new[block * blockSize] ^= 0xff
+    }
+    XCTAssertNil(ranges(from: old, to: new))
+
+    // Half of it is still worth a patch.
+    new[4 * blockSize] ^= 0xff
+    XCTAssertEqual(ranges(from: old, to: new), [0..<(4 * blockSize)])
+  }
+
+  func testScheduleCoalescesBursts() throws {
+    let uploader = FileUploader(debounce: .milliseconds(200))
+    let lock = NSLock()
+    var runs = [String]()
+    func run(_ name: String) -> () -> Void {
+      { lock.lock(); runs.append(name); lock.unlock() }
+    }
+
+    for i in 0..<5 {
+      uploader.schedule("a", run("a\(i)"))
+    }
+    uploader.schedule("b", run("b"))
+
+    // Nothing runs within the window.
+    Thread.sleep(forTimeInterval: 0.1)
+    lock.lock()
+    XCTAssertEqual(runs, [])
+    lock.unlock()
+
+    // Then only the last change of each burst runs.
+    Thread.sleep(forTimeInterval: 0.5)
+    lock.lock()
+    XCTAssertEqual(runs.sorted(), ["a4", "b"])
+    lock.unlock()
+
+    // A change after the window starts a new one.
+    uploader.schedule("a", run("a5"))
+    Thread.sleep(forTimeInterval: 0.5)
+    lock.lock()
+    XCTAssertEqual(runs.sorted(), ["a4", "a5", "b"])
+    lock.unlock()
+  }
+}
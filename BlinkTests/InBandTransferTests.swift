@@ -0,0 +1,234 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+import XCTest
+@testable import Blink
+
+// Scripted remote peer, talking to the transfer through a loopback instead of a session.
+class InBandTransferTests: XCTestCase {
+  var root: URL!
+  var transfer: InBandTransfer!
+  var replies = [String]()
+  var onReply: ((String) -> Void)? = nil
+  var allowed = true
+  let lock = NSLock()
+
+  override func setUpWithError() throws {
+    root = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    try FileManager.default.createDirectory(at: root, withIntermediateDirectories: true)
+    transfer = InBandTransfer(root: root.path) { [unowned self] data in
+      let line = String(data: data, encoding: .utf8)!
+      XCTAssert(line.hasPrefix("#BKT ") && line.hasSuffix("\n"))
+      let reply = String(line.dropFirst(5).dropLast())
+      self.lock.lock()
+      self.replies.append(reply)
+      let onReply = self.onReply
+      self.lock.unlock()
+      onReply?(reply)
+    }
+    transfer.authorize = { [unowned self] name, upload, reply in
+      self.lock.lock()
+      let allowed = self.allowed
+      self.lock.unlock()
+      reply(allowed)
+    }
+  }
+
+  override func tearDownWithError() throws {
+    try? FileManager.default.removeItem(at: root)
+  }
+
+  func send(_ frame: String) {
+    transfer.transferFrame(frame.data(using: .utf8)!)
+  }
+
+  func b64(_ str: String) -> String {
+    Data(str.utf8).base64EncodedString()
+  }
+
+  func testDownload() throws {
+    var content = Data()
+    for i in 0..<200_000 {
+      content.append(contentsOf: "line \(i)\n".utf8)
+    }
+    let chunks = stride(from: 0, to: content.count, by: InBandTransfer.chunkSize).map {
+      content.subdata(in: $0..<min($0 + InBandTransfer.chunkSize, content.count))
+    }
+
+    let done = expectation(description: "done")
+    var next = 0
+    var acked = 0
+    // The peer sends as long as the window allows, and continues on each ack.
+    func pump(window: Int) {
+      while next < chunks.count && next - acked < window {
+        let frame = InBandTransfer.encode(chunks[next])
+        send("data;\(next);\(frame.flag);\(frame.payload)")
+        next += 1
+      }
+      if next == chunks.count && acked == chunks.count {
+        send("end;\(chunks.count)")
+      }
+    }
+
+    let peer = DispatchQueue(label: "peer")
+    var window = 0
+    onReply = { reply in
+      peer.async {
+        let args = reply.split(separator: " ")
+        switch args[0] {
+        case "ok":
+          window = Int(args[1])!
+          pump(window: window)
+        case "ack":
+          XCTAssertEqual(Int(args[1]), acked)
+          acked += 1
+          pump(window: window)
+        case "done":
+          XCTAssertEqual(Int(args[1]), content.count)
+          done.fulfill()
+        default:
+          XCTFail("Unexpected reply \(reply)")
+        }
+      }
+    }
+
+    send("send;\(b64("../download.txt"));\(content.count)")
+    wait(for: [done], timeout: 10)
+
+    let received = try Data(contentsOf: root.appendingPathComponent("download.txt"))
+    XCTAssertEqual(received, content)
+  }
+
+  func testUpload() throws {
+    let content = Data((0..<300_000).map { _ in UInt8.random(in: 0...255) })
+    try content.write(to: root.appendingPathComponent("upload.bin"))
+
+    let done = expectation(description: "end")
+    var received = Data()
+    var frames = 0
+    let peer = DispatchQueue(label: "peer")
+    onReply = { reply in
+      peer.async {
+        let args = reply.split(separator: " ").map(String.init)
+        switch args[0] {
+        case "ok":
+          XCTAssertEqual(Int(args[1]), content.count)
+        case "data":
+          XCTAssertEqual(Int(args[1]), frames)
+          received.append(try! InBandTransfer.decode(flag: args[2], payload: args[3]))
+          frames += 1
+          self.send("ack;\(args[1])")
+        case "end":
+          XCTAssertEqual(Int(args[1]), frames)
+          done.fulfill()
+        default:
+          XCTFail("Unexpected reply \(reply)")
+        }
+      }
+    }
+
+    send("recv;\(b64("upload.bin"))")
+    wait(for: [done], timeout: 10)
+    XCTAssertEqual(received, content)
+  }
+
+  func testDeniedTransferAborts() throws {
+    allowed = false
+    try Data("keep".utf8).write(to: root.appendingPathComponent("existing.txt"))
+
+    let aborted = expectation(description: "abort")
+    onReply = { reply in
+      XCTAssertTrue(reply.hasPrefix("abort"), "Unexpected reply \(reply)")
+      aborted.fulfill()
+    }
+
+    send("send;\(b64("existing.txt"));1")
+    wait(for: [aborted], timeout: 5)
+    XCTAssertEqual(try Data(contentsOf: root.appendingPathComponent("existing.txt")), Data("keep".utf8))
+  }
+
+  func testDownloadKeepsExistingFile() throws {
+    try Data("keep".utf8).write(to: root.appendingPathComponent("notes.txt"))
+
+    let done = expectation(description: "done")
+    onReply = { reply in
+      if reply.hasPrefix("ok") {
+        self.send("data;0;-;\(self.b64("new"))")
+      } else if reply.hasPrefix("ack") {
+        self.send("end;1")
+      } else if reply.hasPrefix("done") {
+        done.fulfill()
+      } else {
+        XCTFail("Unexpected reply \(reply)")
+      }
+    }
+
+    send("send;\(b64("notes.txt"));3")
+    wait(for: [done], timeout: 5)
+    XCTAssertEqual(try Data(contentsOf: root.appendingPathComponent("notes.txt")), Data("keep".utf8))
+    XCTAssertEqual(try Data(contentsOf: root.appendingPathComponent("notes 2.txt")), Data("new".utf8))
+
+    // An abort after a send only removes the file the transfer created.
+    let aborted = expectation(description: "abort")
+    transfer.onEvent = { event in
+      if case .failed = event {
+        aborted.fulfill()
+      }
+    }
+    onReply = { reply in
+      if reply.hasPrefix("ok") {
+        self.send("abort")
+      }
+    }
+    send("send;\(b64("notes.txt"));3")
+    wait(for: [aborted], timeout: 5)
+    XCTAssertTrue(FileManager.default.fileExists(atPath: root.appendingPathComponent("notes.txt").path))
+    XCTAssertTrue(FileManager.default.fileExists(atPath: root.appendingPathComponent("notes 2.txt").path))
+    XCTAssertFalse(FileManager.default.fileExists(atPath: root.appendingPathComponent("notes 3.txt").path))
+  }
+
+  func testOutOfOrderAborts() throws {
+    let aborted = expectation(description: "abort")
+    onReply = { reply in
+      if reply.hasPrefix("ok") {
+        self.send("data;1;-;\(self.b64("x"))")
+      } else if reply.hasPrefix("abort") {
+        aborted.fulfill()
+      }
+    }
+
+    send("send;\(b64("partial.txt"));1")
+    wait(for: [aborted], timeout: 5)
+    XCTAssertFalse(FileManager.default.fileExists(atPath: root.appendingPathComponent("partial.txt").path))
+  }
+}
@@ -0,0 +1,139 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2019 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+import XCTest
+@testable import Blink
+
+// The renderer is stood in by a second screen in the alternate buffer, fed
+// only with what the model emits, so frames are checked by replaying them.
+class VTScreenTests: XCTestCase {
+  let rows: Int32 = 10
+  let cols: Int32 = 30
+  var screen: OpaquePointer!
+  var renderer: OpaquePointer!
+
+  override func setUpWithError() throws {
+    screen = vt_screen_new(rows, cols)
+    renderer = vt_screen_new(rows, cols)
+    _ = feed(renderer, "\u{1b}[?1049h")
+  }
+
+  override func tearDownWithError() throws {
+    vt_screen_free(screen)
+    vt_screen_free(renderer)
+  }
+
+  func testOutputPassesThroughOutsideAlternateScreen() throws {
+    let output = "hello\r\n\u{1b}[1;32mworld\u{1b}[0m\r\n"
+    XCTAssertEqual(feed(screen, output), output)
+    XCTAssertFalse(vt_screen_active(screen))
+    XCTAssertFalse(vt_screen_dirty(screen))
+  }
+
+  func testFramesReplayToSameScreen() throws {
+    _ = feed(screen, "\u{1b}[?1049h")
+    XCTAssertTrue(vt_screen_active(screen))
+
+    XCTAssertEqual(feed(screen, "\u{1b}[H\u{1b}[2J\u{1b}[1;31mtitle\u{1b}[0m\u{1b}[3;5Hbody text"), "")
+    XCTAssertTrue(vt_screen_dirty(screen))
+    _ = feed(renderer, frame(screen))
+    XCTAssertFalse(vt_screen_dirty(screen))
+    assertSameScreen()
+    XCTAssertEqual(text(screen, row: 0), "title")
+    XCTAssertEqual(text(screen, row: 2), "    body text")
+
+    // Scrolling inside a region, then a single changed row.
+    _ = feed(screen, "\u{1b}[2;9r\u{1b}[9H\r\nnext line\u{1b}[r\u{1b}[1;7Hx")
+    let delta = frame(screen)
+    XCTAssertFalse(delta.contains("body text"))
+    _ = feed(renderer, delta)
+    assertSameScreen()
+    XCTAssertEqual(text(screen, row: 0), "title x")
+    XCTAssertEqual(text(screen, row: 1), "    body text")
+  }
+
+  func testHandsOverUnsupportedOutput() throws {
+    _ = feed(screen, "\u{1b}[?1049h\u{1b}[Hmodel")
+    // Wide characters are left to the renderer, after the pending frame.
+    let output = feed(screen, "\u{1b}[2H漢字")
+    XCTAssertFalse(vt_screen_active(screen))
+    XCTAssertTrue(output.hasSuffix("漢字"))
+    _ = feed(renderer, output)
+    XCTAssertEqual(text(renderer, row: 0), "model")
+  }
+
+  func testLeavingAlternateScreen() throws {
+    _ = feed(screen, "\u{1b}[?1049h\u{1b}[Hmodel")
+    let output = feed(screen, "\u{1b}[?1049l")
+    XCTAssertFalse(vt_screen_active(screen))
+    XCTAssertTrue(output.hasSuffix("\u{1b}[?1049l"))
+    XCTAssertEqual(feed(screen, "plain"), "plain")
+  }
+
+  private func feed(_ s: OpaquePointer, _ output: String) -> String {
+    var out = vt_buffer()
+    defer { vt_buffer_free(&out) }
+    let bytes = Array(output.utf8)
+    bytes.withUnsafeBufferPointer { p in
+      p.withMemoryRebound(to: CChar.self) { vt_screen_feed(s, $0.baseAddress, $0.count, &out) }
+    }
+    return string(out)
+  }
+
+  private func frame(_ s: OpaquePointer) -> String {
+    var out = vt_buffer()
+    defer { vt_buffer_free(&out) }
+    vt_screen_frame(s, &out)
+    return string(out)
+  }
+
+  private func string(_ out: vt_buffer) -> String {
+    String(decoding: UnsafeRawBufferPointer(start: out.bytes, count: out.len), as: UTF8.self)
+  }
+
+  private func text(_ s: OpaquePointer, row: Int32) -> String {
+    var buf = [CChar](repeating: 0, count: 512)
+    vt_screen_row_text(s, row, &buf, buf.count)
+    return String(cString: buf)
+  }
+
+  private func assertSameScreen(file: StaticString = #filePath, line: UInt = #line) {
+    for row in 0..<rows {
+      XCTAssertEqual(text(screen, row: row), text(renderer, row: row), "row \(row)", file: file, line: line)
+    }
+    var (r1, c1, r2, c2): (Int32, Int32, Int32, Int32) = (0, 0, 0, 0)
+    vt_screen_cursor(screen, &r1, &c1)
+    vt_screen_cursor(renderer, &r2, &c2)
+    XCTAssertEqual([r1, c1], [r2, c2], "cursor", file: file, line: line)
+  }
+}
@@ -66,3 +66,27 @@ hterm.VT.prototype.setDECMode = function(code, state) {
   }
   hterm.VT.prototype.setDECMode_original.call(this, code, state);
 };
+
+// Inline images are decoded natively, and arrive as
+// BlinkImage=<File= params>:<url of the decoded image>
+// Reuse the File= handling, pointing the image at the url instead of a data uri.
+hterm.VT.OSC['1337_original'] = hterm.VT.OSC['1337'];
+hterm.VT.OSC['1337'] = function(parseState) {
+  const match = parseState.args[0].match(/^BlinkImage=([^:]*):(.*)$/m);
+  if (!match) {
+    return hterm.VT.OSC['1337_original'].call(this, parseState);
+  }
+
+  const terminal = this.terminal;
+  const displayImage = terminal.displayImage;
+  terminal.displayImage = function(options, onLoad, onError) {
+    options.uri = match[2];
+    return displayImage.call(this, options, onLoad, onError);
+  };
+  parseState.args[0] = 'File=' + match[1] + ':';
+  try {
+    hterm.VT.OSC['1337_original'].call(this, parseState);
+  } finally {
+    terminal.displayImage = displayImage;
+  }
+};
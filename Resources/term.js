@@ -221,6 +221,10 @@ function term_paste(str) {
   t.onPaste_({text: str || ''});
 }
 
+function term_bracketedPaste() {
+  return !!t.options_.bracketedPaste;
+}
+
 var _utf8TextDecoder = new TextDecoder('utf8');
 function term_write_b64(b64str) {
   var bytes = base64js.toByteArray(b64str); // b64_to_uint8_array(b64str);
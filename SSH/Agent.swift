@@ -55,20 +55,41 @@ public class SSHAgentKey {
 //  var expiration: Int
   public let signer: Signer
   public let name: String
+  // Encoded public key, including its size, as sent on identities requests.
+  let encodedPublicKey: Data?
   
   init(_ key: Signer, named: String, constraints: [SSHAgentConstraint]? = nil) {
     self.signer = key
     self.name = named
     self.constraints = constraints
+    self.encodedPublicKey = try? key.publicKey.encode()
+  }
+  
+  // Public key blob, as received on signature requests.
+  var blob: Data? {
+    encodedPublicKey.map { Data($0[($0.startIndex + 4)...]) }
   }
 }
 
 public class SSHAgent {
-  public private(set) var ring: [SSHAgentKey] = []
+  // Forwarded requests are answered concurrently, off the session thread, so the
+  // ring and its index are only touched under the lock.
+  public var ring: [SSHAgentKey] {
+    ringLock.lock()
+    defer { ringLock.unlock() }
+    return keys
+  }
+  private var keys: [SSHAgentKey] = []
+  // Keys by public key blob, kept along the ring to serve signature requests.
+  private var ringIndex: [Data: SSHAgentKey] = [:]
+  private let ringLock = NSLock()
   // NOTE Instead of the Agent tracking the constraints, we could have a delegate for that.
   // NOTE The Agent name won't be relevant when doing Jumps between hosts, but at least you will know the first originator.
   var superAgent: SSHAgent? = nil
-  var agentForward: Set<AnyCancellable> = []
+  var agentForward: [ObjectIdentifier: AnyCancellable] = [:]
+  // Requests answered at the same time on a forwarded channel.
+  static let forwardWindow = 8
+  static let forwardQueue = DispatchQueue(label: "sh.blink.agent.forward", attributes: .concurrent)
 
   public init() {}
 
@@ -124,25 +145,46 @@ public class SSHAgent {
 
   public func loadKey(_ key: Signer, aka name: String, constraints: [SSHAgentConstraint]? = nil) {
     let cKey = SSHAgentKey(key, named: name, constraints: constraints)
-    for (x, k) in ring.enumerated() {
+    ringLock.lock()
+    defer {
+      if let blob = cKey.blob {
+        ringIndex[blob] = cKey
+      }
+      ringLock.unlock()
+    }
+    for (x, k) in keys.enumerated() {
       if cKey.name == k.name {
         // Replace the key
-        ring[x] = cKey
+        keys[x] = cKey
+        unindex(k)
         return
       }
     }
-    ring.append(cKey)
+    keys.append(cKey)
   }
   
   public func removeKey(_ name: String) -> Signer? {
-    if let idx = ring.firstIndex(where: { $0.name == name }) {
-      let key = ring.remove(at: idx)
+    ringLock.lock()
+    defer { ringLock.unlock() }
+    if let idx = keys.firstIndex(where: { $0.name == name }) {
+      let key = keys.remove(at: idx)
+      unindex(key)
       return key.signer
     } else {
       return nil
     }
   }
 
+  // Called with the ring locked.
+  private func unindex(_ key: SSHAgentKey) {
+    // Another name may still hold the same key.
+    guard let blob = key.blob,
+          ringIndex[blob] === key else {
+      return
+    }
+    ringIndex[blob] = keys.last { $0.blob == blob }
+  }
+
   func request(_ message: Data, context: SSHAgentRequestType, client: SSHClient) throws -> Data {
       switch context {
         case .requestIdentities:
@@ -168,7 +210,12 @@ public class SSHAgent {
 
   func encodedRing() throws -> [Data] {
     (try superAgent?.encodedRing() ?? []) +
-      (try ring.map { (try $0.signer.publicKey.encode()) + SSHEncode.data(from: $0.name) })
+      (try ring.map { key in
+        guard let encodedPublicKey = key.encodedPublicKey else {
+          throw SSHKeyError.general(title: "Could not encode key \(key.name)")
+        }
+        return encodedPublicKey + SSHEncode.data(from: key.name)
+      })
   }
 
   func encodedSignature(_ message: Data, for client: SSHClient) throws -> Data? {
@@ -199,52 +246,78 @@ public class SSHAgent {
   }
 
   fileprivate func lookupKey(blob: Data) -> SSHAgentKey? {
-    // Get rid of the blob size from encode before comparing.
-    ring.first { (try? $0.signer.publicKey.encode()[4...]) == blob }
+    ringLock.lock()
+    defer { ringLock.unlock() }
+    return ringIndex[blob]
   }
 }
 
 extension SSHAgent {
+  // Serve the requests on a forwarded agent channel. Several framed requests may
+  // come on a single read, and they are answered concurrently. The replies are
+  // written back in the order of the requests, as the protocol has no request ids.
   func forward(to stream: Stream) {
-    // Read, process and write
-    // Reads up to max - it may read less if the channel closes before.
-    stream.read(max: 4)
-      .flatMap { data -> AnyPublisher<DispatchData, Error> in
-        var payloadSizeData = data as AnyObject as! Data
-        if data.count < 4 {
-          return .fail(error: SSHError(title: "Agent Channel closed before read could complete"))
-        }
-        let payloadSize = Int(SSHDecode.uint32(&payloadSizeData))
-        return stream.read(max: payloadSize)
+    let id = ObjectIdentifier(stream)
+    var pending = Data()
+
+    agentForward[id] = stream.readChunks()
+      .flatMap(maxPublishers: .max(1)) { data -> AnyPublisher<Data, Error> in
+        pending.append(data as AnyObject as! Data)
+        return SSHAgent.frames(&pending).publisher
+          .setFailureType(to: Error.self)
+          .eraseToAnyPublisher()
       }
-      .flatMap { data -> AnyPublisher<Int, Error> in
-        var payload = data as AnyObject as! Data
-        if data.count < 1 {
-          return .fail(error: SSHError(title: "Agent Channel closed before read could complete"))
-        }
-
-        let typeValue = SSHDecode.uint8(&payload)
-
-        var replyData: Data
-        if let type = SSHAgentRequestType(rawValue: typeValue) {
-          replyData = (try? self.request(payload, context: type, client: stream.client)) ?? errorData
-        } else {
-          replyData = errorData
-        }
-
+      .map { payload -> AnyPublisher<Data, Error> in
+        // The Future starts right away, so the requests within the window run in parallel.
+        Future<Data, Error> { promise in
+          SSHAgent.forwardQueue.async {
+            promise(.success(self.reply(to: payload, client: stream.client)))
+          }
+        }.eraseToAnyPublisher()
+      }
+      .buffer(size: SSHAgent.forwardWindow, prefetch: .keepFull,
+              whenFull: .customError({ SSHKeyError.general(title: "Agent forward window overflow") }))
+      .flatMap(maxPublishers: .max(1)) { $0 }
+      .flatMap(maxPublishers: .max(1)) { replyData -> AnyPublisher<Int, Error> in
         let reply = SSHEncode.data(from: UInt32(replyData.count)) + replyData
         let dd = reply.withUnsafeBytes { DispatchData(bytes: $0) }
         
         return stream.write(dd, max: dd.count)
       }.sink(
         receiveCompletion: { c in
-          // Completion. Log errors and escape
-          if ssh_channel_is_eof(stream.channel) == 0 {
-            self.forward(to: stream)
-          } else {
-            self.agentForward = []
-          }
-        }, receiveValue: { _ in }).store(in: &agentForward)
+          // The channel reached EOF or failed. Log errors and escape
+          self.agentForward[id] = nil
+        }, receiveValue: { _ in })
+  }
+
+  // Extract the complete framed payloads, leaving any partial one in the buffer.
+  static func frames(_ buffer: inout Data) -> [Data] {
+    var payloads: [Data] = []
+    var data = buffer
+    while data.count >= 4 {
+      var header = data
+      let payloadSize = Int(SSHDecode.uint32(&header))
+      guard header.count >= payloadSize else {
+        break
+      }
+      payloads.append(header.prefix(payloadSize))
+      data = header.count == payloadSize ? Data() : header.advanced(by: payloadSize)
+    }
+    buffer = Data(data)
+    return payloads
+  }
+
+  func reply(to message: Data, client: SSHClient) -> Data {
+    var payload = message
+    if payload.count < 1 {
+      return errorData
+    }
+
+    let typeValue = SSHDecode.uint8(&payload)
+    guard let type = SSHAgentRequestType(rawValue: typeValue) else {
+      return errorData
+    }
+    return (try? self.request(payload, context: type, client: client)) ?? errorData
   }
 }
 
@@ -136,15 +136,44 @@ public class SCPClient: CopierFrom, CopierTo {
 
 
 extension SCPClient {
+  // Items walked and stat'ed ahead of the one being transferred.
+  static let prefetchItems = 16
+  // Entries pulled from a directory listing at once.
+  static let walkBatchSize = 256
+
   // Perform copy with SCPClient as Sink, Translator as Source
   public func copy(from ts: [Translator], args: CopyArguments = CopyArguments()) -> CopyProgressInfoPublisher {
+    copy(from: ts.publisher.setFailureType(to: Error.self).eraseToAnyPublisher())
+  }
+
+  fileprivate func copy(from ts: AnyPublisher<Translator, Error>) -> CopyProgressInfoPublisher {
     let directoryLevel = self.currentDirectoryLevel
     
-    return ts.publisher.compactMap { t in
+    return ts.compactMap { t in
       return t.fileType == .typeDirectory || t.fileType == .typeRegular ? t : nil
     }
+    // Stat ahead while the current item is being transferred, so the next one is ready.
+    .flatMap(maxPublishers: .max(SCPClient.prefetchItems)) { t -> AnyPublisher<(Translator, String, NSNumber, NSNumber), Error> in
+      return t.stat().tryMap { attrs in
+        guard let name = attrs[FileAttributeKey.name] as? String else {
+          throw SCPError(msg: "No name provided")
+        }
+        let mode = attrs[FileAttributeKey.posixPermissions] as? NSNumber ??
+          (t.fileType == .typeDirectory ? NSNumber(value: Int16(0o755)) : NSNumber(value: Int16(0o644)))
+        
+        guard let size = attrs[FileAttributeKey.size] as? NSNumber else {
+          throw SCPError(msg: "No size provided")
+        }
+        
+        return (t, name, mode, size)
+      }.eraseToAnyPublisher()
+    }
+    // keepFull never asks for more than fits, so an overflow is a bug. Fail instead of
+    // dropping items from the copy.
+    .buffer(size: SCPClient.prefetchItems, prefetch: .keepFull,
+            whenFull: .customError({ SCPError(msg: "Prefetch buffer overflow") }))
     // Process items one by one, because the directories have a state on SCP.
-    .flatMap(maxPublishers: .max(1)) { t -> CopyProgressInfoPublisher in
+    .flatMap(maxPublishers: .max(1)) { (t, name, mode, size) -> CopyProgressInfoPublisher in
       return self.connection().tryMap { scp -> ssh_scp in
         while directoryLevel < self.currentDirectoryLevel {
           // Go up to the proper level
@@ -156,21 +185,7 @@ extension SCPClient {
           self.currentDirectoryLevel -= 1
         }
         return scp
-      }.flatMap { scp -> AnyPublisher<(String, NSNumber, NSNumber), Error> in
-        return t.stat().tryMap { attrs in
-          guard let name = attrs[FileAttributeKey.name] as? String else {
-            throw SCPError(msg: "No name provided")
-          }
-          let mode = attrs[FileAttributeKey.posixPermissions] as? NSNumber ??
-            (t.fileType == .typeDirectory ? NSNumber(value: Int16(0o755)) : NSNumber(value: Int16(0o644)))
-          
-          guard let size = attrs[FileAttributeKey.size] as? NSNumber else {
-            throw SCPError(msg: "No size provided")
-          }
-          
-          return (name, mode, size)
-        }.eraseToAnyPublisher()
-      }.flatMap { (name, mode, size) -> CopyProgressInfoPublisher in
+      }.flatMap { _ -> CopyProgressInfoPublisher in
         if t.fileType == .typeDirectory {
           return self.connection().tryMap { scp -> Translator in
             let rc = ssh_scp_push_directory(scp, name, mode.int32Value)
@@ -201,19 +216,20 @@ extension SCPClient {
     }.eraseToAnyPublisher()
   }
   
-  // Schedule a copy of all the elements in a directory.
+  // Stream the elements in a directory to the copy as they are walked,
+  // without waiting for the whole listing.
   fileprivate func copyDirectoryFrom(_ t: Translator) -> CopyProgressInfoPublisher {
-    return t.directoryFilesAndAttributes().flatMap {
+    let items = t.directoryFilesAndAttributes(batchSize: SCPClient.walkBatchSize).flatMap {
       $0.compactMap { i -> FileAttributes? in
         if (i[.name] as! String) == "." || (i[.name] as! String) == ".." {
           return nil
         } else { return i }
       }.publisher
     }
-    .flatMap { t.cloneWalkTo($0[.name] as! String) }
-    .collect()
-    .flatMap { self.copy(from: $0) }
+    .flatMap(maxPublishers: .max(SCPClient.prefetchItems)) { t.cloneWalkTo($0[.name] as! String) }
     .eraseToAnyPublisher()
+
+    return copy(from: items)
   }
   
   fileprivate func copyFileFrom(_ t: Translator, name: String, size: NSNumber) -> CopyProgressInfoPublisher {
@@ -419,16 +435,18 @@ extension SCPClient {
         }
       }
       
-      let buf = UnsafeMutableRawBufferPointer.allocate(byteCount: Int(windowAvail), alignment: MemoryLayout<CUnsignedChar>.alignment)
-      let rc = ssh_scp_read(scp, buf.baseAddress, Int(windowAvail))
+      let buf = SCPClient.buffers.take()
+      let rc = ssh_scp_read(scp, buf.baseAddress, min(windowAvail, buf.count))
       if rc == SSH_ERROR {
+        SCPClient.buffers.give(buf)
         pb.send(completion: .failure(SSHError(rc, forSession: self.ssh.session)))
         return
       }
       
       let shrk = buf[0..<Int(rc)]
       let buffer = UnsafeRawBufferPointer(rebasing: shrk)
-      let data = DispatchData(bytesNoCopy: buffer, deallocator: .custom(nil){ buf.deallocate() })
+      // The buffer goes back to the pool once the Writer releases the data.
+      let data = DispatchData(bytesNoCopy: buffer, deallocator: .custom(nil){ SCPClient.buffers.give(buf) })
       pb.send(data)
       
       totalWritten += data.count
@@ -454,3 +472,40 @@ extension SCPClient {
     .eraseToAnyPublisher()
   }
 }
+
+// Fixed size buffers for the reads from the channel, reused across files
+// instead of allocating one on every read.
+final class SCPBufferPool {
+  let bufferSize: Int
+  let maxBuffers: Int
+  private var free: [UnsafeMutableRawBufferPointer] = []
+  private let lock = NSLock()
+
+  init(bufferSize: Int, maxBuffers: Int) {
+    self.bufferSize = bufferSize
+    self.maxBuffers = maxBuffers
+  }
+
+  func take() -> UnsafeMutableRawBufferPointer {
+    lock.lock()
+    defer { lock.unlock() }
+    if let buf = free.popLast() {
+      return buf
+    }
+    return UnsafeMutableRawBufferPointer.allocate(byteCount: bufferSize, alignment: MemoryLayout<CUnsignedChar>.alignment)
+  }
+
+  func give(_ buf: UnsafeMutableRawBufferPointer) {
+    lock.lock()
+    defer { lock.unlock() }
+    if free.count < maxBuffers {
+      free.append(buf)
+    } else {
+      buf.deallocate()
+    }
+  }
+}
+
+extension SCPClient {
+  static let buffers = SCPBufferPool(bufferSize: 65536, maxBuffers: 16)
+}
@@ -0,0 +1,139 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2021 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Combine
+import Foundation
+import BlinkFiles
+
+
+// Trees copied as a single tar stream over an exec channel on the same connection,
+// instead of a round-trip per file and attribute. Hosts need a tar, so check first.
+extension SFTPTranslator {
+  static let tarDone = "BLINK_TAR_DONE"
+  static let tarFailed = "BLINK_TAR_FAILED"
+
+  public func hasTar() -> AnyPublisher<Bool, Error> {
+    execOutput("command -v tar >/dev/null 2>&1 && echo \(Self.tarDone)", timeout: .seconds(10))
+      .map { $0.contains(Self.tarDone) }
+      .catch { _ in Just(false).setFailureType(to: Error.self) }
+      .eraseToAnyPublisher()
+  }
+
+  // Pack the local items and unpack them on the current directory.
+  public func tarPush(_ items: [Translator], preserve: CopyAttributesFlag) -> CopyProgressInfoPublisher {
+    guard isDirectory else {
+      return .fail(error: FileError.Fail(msg: "Not a directory"))
+    }
+
+    // Remote tar restores the modification time and applies the umask by default.
+    var flags = "-x"
+    if !preserve.contains(.timestamp) {
+      flags += "m"
+    }
+    if preserve.contains(.permissions) {
+      flags += "p"
+    }
+    let cmd = "cd \(shellQuoted(path)) && tar \(flags)f - && echo \(Self.tarDone)"
+
+    return sftpClient.client.requestExec(command: cmd)
+      .flatMap { stream -> CopyProgressInfoPublisher in
+        Tar.pack(items, into: stream, reportingUnder: self.path)
+          .append(
+            Deferred { stream.sendEOF() }
+              .flatMap { _ in stream.read(max: SSIZE_MAX) }
+              .flatMap { output -> CopyProgressInfoPublisher in
+                if String(decoding: output, as: UTF8.self).contains(Self.tarDone) {
+                  return Empty().eraseToAnyPublisher()
+                }
+                return self.remoteTarFailure(on: stream)
+              }
+          ).eraseToAnyPublisher()
+      }.eraseToAnyPublisher()
+  }
+
+  // Pack the remote items, all from the same directory, and unpack them into a local directory.
+  public func tarPull(_ items: [Translator], into local: Translator, preserve: CopyAttributesFlag) -> CopyProgressInfoPublisher {
+    let parents = Set(items.map { ($0.current as NSString).deletingLastPathComponent })
+    guard parents.count == 1, let parent = parents.first else {
+      return .fail(error: FileError.Fail(msg: "Items must be in the same directory"))
+    }
+
+    let extractor: TarExtractor
+    do {
+      extractor = try TarExtractor(into: local, preserve: preserve)
+    } catch {
+      return .fail(error: error)
+    }
+
+    // Relative names, so no option or absolute path ever reaches the archive.
+    let names = items
+      .map { shellQuoted("./" + ($0.current as NSString).lastPathComponent) }
+      .joined(separator: " ")
+    // The archive takes stdout, so failures are flagged on stderr.
+    let cmd = "cd \(shellQuoted(parent)) && tar -cf - \(names) || echo \(Self.tarFailed) >&2"
+
+    return sftpClient.client.requestExec(command: cmd)
+      .flatMap { stream -> CopyProgressInfoPublisher in
+        extractor.unpack(from: stream)
+          .append(
+            Deferred { stream.read_err(max: SSIZE_MAX) }
+              .catch { _ in Just(DispatchData.empty).setFailureType(to: Error.self) }
+              .flatMap { output -> CopyProgressInfoPublisher in
+                let message = String(decoding: output, as: UTF8.self)
+                guard message.contains(Self.tarFailed) else {
+                  return Empty().eraseToAnyPublisher()
+                }
+                return .fail(error: FileError.Fail(msg: "Remote tar failed. \(message.replacingOccurrences(of: Self.tarFailed, with: ""))"))
+              }
+          )
+          .catch { error -> CopyProgressInfoPublisher in
+            self.remoteTarFailure(on: stream, otherwise: error)
+          }
+          .eraseToAnyPublisher()
+      }.eraseToAnyPublisher()
+  }
+
+  // What tar said went wrong, when it said anything.
+  private func remoteTarFailure(on stream: Stream, otherwise error: Error? = nil) -> CopyProgressInfoPublisher {
+    stream.read_err(max: SSIZE_MAX)
+      .catch { _ in Just(DispatchData.empty).setFailureType(to: Error.self) }
+      .flatMap { output -> CopyProgressInfoPublisher in
+        let message = String(decoding: output, as: UTF8.self)
+          .replacingOccurrences(of: Self.tarFailed, with: "")
+          .trimmingCharacters(in: .whitespacesAndNewlines)
+        if message.isEmpty, let error = error {
+          return .fail(error: error)
+        }
+        return .fail(error: FileError.Fail(msg: "Remote tar failed. \(message)"))
+      }.eraseToAnyPublisher()
+  }
+}
@@ -441,6 +441,218 @@ public class SFTPTranslator: BlinkFiles.Translator {
   }
 }
 
+extension SFTPTranslator: BlinkFiles.DirectoryStreamer {
+  // Read the directory a batch at a time, only as batches are demanded.
+  public func directoryFilesAndAttributes(batchSize: Int) -> AnyPublisher<[FileAttributes], Error> {
+    if fileType != .typeDirectory {
+      return .fail(error: FileError(title: "Not a directory.", in: session))
+    }
+
+    let pub = PassthroughSubject<[FileAttributes], Error>()
+    var dir: sftp_dir? = nil
+
+    func closeDir() {
+      guard let d = dir else {
+        return
+      }
+      ssh_channel_set_blocking(self.channel, 1)
+      defer { ssh_channel_set_blocking(self.channel, 0) }
+
+      sftp_closedir(d)
+      dir = nil
+    }
+
+    func readBatches(_ demand: Subscribers.Demand) {
+      ssh_channel_set_blocking(self.channel, 1)
+      defer { ssh_channel_set_blocking(self.channel, 0) }
+
+      if dir == nil {
+        guard let d = sftp_opendir(self.sftp, self.path) else {
+          pub.send(completion: .failure(FileError(in: self.session)))
+          return
+        }
+        dir = d
+      }
+
+      var pending = demand
+      while pending > 0 {
+        var batch: [FileAttributes] = []
+        var isComplete = false
+
+        while batch.count < batchSize {
+          guard let pointer = sftp_readdir(self.sftp, dir) else {
+            if sftp_dir_eof(dir) != 1 {
+              // Take the error before closing, so it is not overwritten.
+              let error = FileError(in: self.session)
+              closeDir()
+              pub.send(completion: .failure(error))
+              return
+            }
+            isComplete = true
+            break
+          }
+          batch.append(self.parseItemAttributes(pointer.pointee))
+          sftp_attributes_free(pointer)
+        }
+
+        if !batch.isEmpty {
+          pub.send(batch)
+          pending -= 1
+        }
+
+        if isComplete {
+          closeDir()
+          pub.send(completion: .finished)
+          return
+        }
+      }
+    }
+
+    return
+      .demandingSubject(pub,
+                        receiveRequest: readBatches,
+                        receiveCancel: closeDir,
+                        on: rloop)
+  }
+}
+
+extension SFTPTranslator: BlinkFiles.LinkResolver {
+  // Stat the targets of the links directly by path, all in a single pass on the session.
+  // Walking to each link would canonicalize it, stat it and probe it as a directory,
+  // every one of them a separate round-trip.
+  public func resolvingLinks(_ filesAttributes: [FileAttributes]) -> AnyPublisher<[FileAttributes], Error> {
+    let isLink = { (attrs: FileAttributes) -> Bool in
+      (attrs[.type] as? FileAttributeType) == .typeSymbolicLink
+    }
+    if !filesAttributes.contains(where: isLink) {
+      return .just(filesAttributes)
+    }
+
+    return connection().map { sftp -> [FileAttributes] in
+      ssh_channel_set_blocking(self.channel, 1)
+      defer { ssh_channel_set_blocking(self.channel, 0) }
+
+      return filesAttributes.map { attrs -> FileAttributes in
+        guard isLink(attrs),
+              let name = attrs[.name] as? String else {
+          return attrs
+        }
+
+        // Broken links keep their own attributes.
+        let linkPath = (self.path as NSString).appendingPathComponent(name)
+        guard let pointer = sftp_stat(sftp, linkPath) else {
+          return attrs
+        }
+        var targetAttrs = self.parseItemAttributes(pointer.pointee)
+        sftp_attributes_free(pointer)
+        targetAttrs[.name] = name
+
+        return targetAttrs
+      }
+    }.eraseToAnyPublisher()
+  }
+}
+
+extension SFTPTranslator: BlinkFiles.EntryWalker {
+  // The walk canonicalizes the whole path, which resolves links. Here only the parent
+  // is canonicalized, and the entry within it is lstat'ed.
+  public func walkTo(entry path: String) -> AnyPublisher<Translator, Error> {
+    let name = (path as NSString).lastPathComponent
+    guard !name.isEmpty, name != "/", name != ".", name != "..", name != "~" else {
+      return walkTo(path)
+    }
+    var parent = (path as NSString).deletingLastPathComponent
+    if parent.isEmpty {
+      parent = "."
+    }
+
+    return walkTo(parent)
+      .tryMap { _ -> Translator in
+        ssh_channel_set_blocking(self.channel, 1)
+        defer { ssh_channel_set_blocking(self.channel, 0) }
+
+        let entryPath = (self.path as NSString).appendingPathComponent(name)
+        guard let attrsPtr = sftp_lstat(self.sftp, entryPath) else {
+          throw FileError(title: "\(entryPath) No such file or directory.", in: self.session)
+        }
+        defer { sftp_attributes_free(attrsPtr) }
+
+        switch attrsPtr.pointee.type {
+        case UInt8(SSH_FILEXFER_TYPE_DIRECTORY):
+          self.fileType = .typeDirectory
+        case UInt8(SSH_FILEXFER_TYPE_REGULAR):
+          self.fileType = .typeRegular
+        case UInt8(SSH_FILEXFER_TYPE_SYMLINK):
+          self.fileType = .typeSymbolicLink
+        default:
+          self.fileType = .typeUnknown
+        }
+        self.path = entryPath
+        return self
+      }
+      .eraseToAnyPublisher()
+  }
+}
+
+extension SFTPTranslator: BlinkFiles.TreeOperator {
+  // Hosts may only allow SFTP, and the generic walk takes over when the command fails.
+  // rm and mv do not follow the path they are given, so a link reached with an
+  // entry walk is removed or moved itself.
+  public func removeTree() -> AnyPublisher<Void, Error> {
+    // Never hand the root, or something that did not canonicalize, to rm.
+    guard !path.isEmpty, path != "/", path != rootPath else {
+      return .fail(error: FileError.Fail(msg: "Refusing to remove \(path)"))
+    }
+    // Large trees take a while, but still less than a round-trip per entry.
+    return exec("rm -rf -- \(shellQuoted(path))", timeout: .seconds(120))
+  }
+
+  public func moveTree(to newPath: String) -> AnyPublisher<Void, Error> {
+    let destination = newPath.starts(with: "/") ?
+      newPath :
+      ((path as NSString).deletingLastPathComponent as NSString).appendingPathComponent(newPath)
+    // mv would move the object into an existing directory, so refuse to replace one.
+    let quoted = shellQuoted(destination)
+    return exec("test ! -d \(quoted) && mv -f -- \(shellQuoted(path)) \(quoted)", timeout: .seconds(15))
+  }
+
+  // Runs the command on the host, failing unless it succeeded.
+  private func exec(_ cmd: String, timeout: DispatchQueue.SchedulerTimeType.Stride) -> AnyPublisher<Void, Error> {
+    let done = "BLINK_TREE_DONE"
+    return execOutput("\(cmd) && echo \(done)", timeout: timeout)
+      .tryMap { output in
+        guard output.contains(done) else {
+          throw FileError.Fail(msg: "Remote command failed: \(cmd)")
+        }
+      }
+      .eraseToAnyPublisher()
+  }
+
+  // Runs the command with no input and collects its output. Hosts that force sftp
+  // on every channel would otherwise wait for input, and a command that does not
+  // finish in time fails.
+  func execOutput(_ cmd: String, timeout: DispatchQueue.SchedulerTimeType.Stride) -> AnyPublisher<String, Error> {
+    sftpClient.client.requestExec(command: cmd)
+      .flatMap { stream in
+        stream.sendEOF()
+          .flatMap { _ in stream.read(max: SSIZE_MAX) }
+          .map { output -> String in
+            // Keep the stream until the command is over.
+            _ = stream
+            return String(decoding: output, as: UTF8.self)
+          }
+      }
+      .timeout(timeout, scheduler: DispatchQueue.global(), customError: {
+        FileError.Fail(msg: "Remote command timed out: \(cmd)")
+      })
+      .eraseToAnyPublisher()
+  }
+
+  func shellQuoted(_ path: String) -> String {
+    "'" + path.replacingOccurrences(of: "'", with: "'\\''") + "'"
+  }
+}
+
 public class SFTPFile : BlinkFiles.File {
   var file: sftp_file?
   let sftpClient: SFTPClient
@@ -449,9 +661,12 @@ public class SFTPFile : BlinkFiles.File {
   var session: ssh_session { sftpClient.session }
   var rloop: RunLoop { sftpClient.rloop }
   var log: SSHLogger { get { sftpClient.log } }
+  var stats: SSHClientStats { sftpClient.client.stats }
   
   var inflightReads: [UInt32] = []
   var inflightWrites: [UInt32] = []
+  // Uptime when each request was issued, to measure the round-trip.
+  var requestStarts: [UInt32: UInt64] = [:]
   let blockSize = 32 * 1024
   let maxConcurrentOps = 20
   var demand: Subscribers.Demand = .none
@@ -509,7 +724,7 @@ extension SFTPFile: BlinkFiles.Reader, BlinkFiles.WriterTo {
                         receiveRequest: receiveRequest(_:),
                         on: rloop)
       .flatMap(maxPublishers: .max(1)) { data -> AnyPublisher<Int, Error> in
-        self.log.message("WRITING \(data.count)", SSH_LOG_DEBUG)
+        self.log.trace(.sftpWriting, data.count)
         return w.write(data, max: data.count)
       }
       .print()
@@ -544,7 +759,7 @@ extension SFTPFile: BlinkFiles.Reader, BlinkFiles.WriterTo {
       }
     }
     
-    self.log.message("Scheduled reads \(inflightReads.count). Current demand \(self.demand).", SSH_LOG_DEBUG)
+    self.log.trace(.sftpReadsScheduled, inflightReads.count)
 
     // Schedule more blocks to read. This way data will already be ready when we come back.
     while isComplete == false && inflightReads.count < self.maxConcurrentOps {
@@ -554,6 +769,7 @@ extension SFTPFile: BlinkFiles.Reader, BlinkFiles.WriterTo {
         return
       }
       inflightReads.append(UInt32(asyncRequest))
+      requestStarts[UInt32(asyncRequest)] = DispatchTime.now().uptimeNanoseconds
     }
         
     if let data = data, data.count > 0 {
@@ -564,6 +780,7 @@ extension SFTPFile: BlinkFiles.Reader, BlinkFiles.WriterTo {
       }
     }
     
+    stats.sftpInflight(inflightReads.count)
     self.log.message("Next reads \(inflightReads.count). Current demand \(self.demand).", SSH_LOG_DEBUG)
 
     if isComplete {
@@ -589,23 +806,28 @@ extension SFTPFile: BlinkFiles.Reader, BlinkFiles.WriterTo {
     self.log.message("Reading blocks starting from \(inflightReads[0])", SSH_LOG_DEBUG)
     for (idx, block) in inflightReads.enumerated() {
       let buf = UnsafeMutableRawPointer.allocate(byteCount: self.blockSize, alignment: MemoryLayout<UInt8>.alignment)
-      self.log.message("Reading \(block)", SSH_LOG_TRACE)
+      self.log.trace(.sftpBlockRead, Int(block), level: SSH_LOG_TRACE)
       let nbytes = sftp_async_read(self.file, buf, UInt32(self.blockSize), block)
       if nbytes > 0 {
         let bb = DispatchData(bytesNoCopy: UnsafeRawBufferPointer(start: buf, count: Int(nbytes)),
                               deallocator: .custom(nil, { buf.deallocate() }))
         data.append(bb)
+        if let start = requestStarts.removeValue(forKey: block) {
+          stats.sftpResponse(since: start)
+        }
         
         lastIdx = idx
       } else {
         buf.deallocate()
         if nbytes == SSH_AGAIN {
-            self.log.message("readBlock AGAIN", SSH_LOG_TRACE)
+            self.log.trace(.sftpBlockAgain, level: SSH_LOG_TRACE)
             break
         } else if nbytes < 0 {
           throw FileError(title: "Error while reading blocks", in: session)
         } else if nbytes == 0 {
           inflightReads = []
+          requestStarts = [:]
+          stats.sftpInflight(0)
           return (data, true)
         }
       }
@@ -613,7 +835,7 @@ extension SFTPFile: BlinkFiles.Reader, BlinkFiles.WriterTo {
     
     let blocksRead = lastIdx == -1 ? 0 : lastIdx + 1
     
-    self.log.message("Blocks read \(blocksRead), size \(data.count), last block \(lastIdx == -1 ? 0 : inflightReads[lastIdx])", SSH_LOG_DEBUG)
+    self.log.trace(.sftpBlocksRead, blocksRead, data.count)
     inflightReads = Array(inflightReads[blocksRead...])
     inflightReads += newReads
     
@@ -621,6 +843,19 @@ extension SFTPFile: BlinkFiles.Reader, BlinkFiles.WriterTo {
   }
 }
 
+extension SFTPFile: BlinkFiles.Seeker {
+  // Async reads and writes are scheduled from the file offset, so seek before starting them.
+  public func seek(to offset: UInt64) throws {
+    guard let file = self.file else {
+      throw FileError(title: "File is closed", in: session)
+    }
+
+    if sftp_seek64(file, offset) != 0 {
+      throw FileError(title: "Could not seek file", in: session)
+    }
+  }
+}
+
 extension SFTPFile: BlinkFiles.Writer {
   // TODO Take into account length
   public func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
@@ -638,7 +873,7 @@ extension SFTPFile: BlinkFiles.Writer {
       var written = wn
       var isFinished = false
       
-      self.log.message("Scheduled writes \(inflightWrites.count).", SSH_LOG_DEBUG)
+      self.log.trace(.sftpWritesScheduled, inflightWrites.count)
       
       ssh_channel_set_blocking(self.channel, 1)
       defer { ssh_channel_set_blocking(self.channel, 0) }
@@ -685,9 +920,11 @@ extension SFTPFile: BlinkFiles.Writer {
         }
         
         inflightWrites.append(asyncRequest)
+        requestStarts[asyncRequest] = DispatchTime.now().uptimeNanoseconds
         write = write.subdata(in: length..<write.count)
       }
       
+      stats.sftpInflight(inflightWrites.count)
       self.log.message("New writes \(inflightWrites.count).", SSH_LOG_DEBUG)
 
       if writtenBytes > 0 {
@@ -712,15 +949,17 @@ extension SFTPFile: BlinkFiles.Writer {
     var lastIdx = 0
         
     for block in inflightWrites {
-      self.log.message("sftp_async_write_end sent", SSH_LOG_DEBUG)
       let rc = sftp_async_write_end(self.file, block, 0)
-      self.log.message("sftp_async_write_end \(rc)", SSH_LOG_DEBUG)
+      self.log.trace(.sftpWriteEnd, Int(rc))
       if rc == SSH_AGAIN {
-        self.log.message("Write AGAIN", SSH_LOG_DEBUG)
+        self.log.trace(.sftpWriteAgain)
         break
       } else if rc != SSH_OK {
         throw FileError(title: "Error while writing block", in: session)
       }
+      if let start = requestStarts.removeValue(forKey: block) {
+        stats.sftpResponse(since: start)
+      }
       lastIdx += 1
     }
     
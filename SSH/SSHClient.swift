@@ -57,6 +57,7 @@ public class SSHClient {
   public let host: String
   public let options: SSHClientConfig
   let log: SSHLogger
+  public let stats = SSHClientStats()
   
   public typealias ExecProxyCommandCallback = (String, Int32, Int32) -> Void
   let proxyCb: ExecProxyCommandCallback?
@@ -350,6 +351,35 @@ public class SSHClient {
       .eraseToAnyPublisher()
   }
   
+  /**
+   Compression that would have suited the link better, based on the transfers during the session.
+   
+   Fast links are limited by the CPU time zlib takes, and slow links benefit from sending less.
+   Compression cannot be renegotiated on a live session, so this is meant for the next connection.
+   
+   - Returns: `true` to compress, `false` not to, or nil to keep the current setting.
+   */
+  public func compressionRecommendation() -> Bool? {
+    // Not enough sustained transfers to tell.
+    guard stats.bulkWindows >= SSHClient.minBulkWindows else {
+      return nil
+    }
+    
+    if options.compression {
+      if stats.peakThroughput >= SSHClient.fastLinkThroughput ||
+          stats.bulkCPUUsage >= SSHClient.cpuBoundUsage {
+        return false
+      }
+    } else if stats.peakThroughput < SSHClient.slowLinkThroughput {
+      return true
+    }
+    return nil
+  }
+  static let minBulkWindows = 3
+  static let fastLinkThroughput: Double = 8 * 1024 * 1024
+  static let slowLinkThroughput: Double = 1 * 1024 * 1024
+  static let cpuBoundUsage = 0.7
+  
   /**
    Get the current IP address of the connected session.
    
@@ -857,6 +887,28 @@ public class SSHClient {
       }.reduce(channel) { $1 }.eraseToAnyPublisher()
   }
 
+  // Recent trace of the session, read on its RunLoop as that is where it is written.
+  // Empty unless the session logs at debug level.
+  public func dumpTrace(timeout: TimeInterval = 1) -> [String] {
+    let lock = NSLock()
+    var trace: [String] = []
+    let done = DispatchSemaphore(value: 0)
+
+    self.rloop.perform {
+      let records = self.log.dumpTrace()
+      lock.lock()
+      trace = records
+      lock.unlock()
+      done.signal()
+    }
+    CFRunLoopWakeUp(self.rloop.getCFRunLoop())
+    _ = done.wait(timeout: .now() + timeout)
+
+    lock.lock()
+    defer { lock.unlock() }
+    return trace
+  }
+
   func closeChannel(_ channel: ssh_channel) {
     self.rloop.perform {
       // Keep self so the Session is always deinited after the channels are closed.
@@ -918,20 +970,51 @@ public enum SSHLogLevel: Int {
 public class SSHLogger {
   let verbosity: SSHLogLevel
   let logger: SSHLogPublisher?
+  let traceRing = SSHTraceRing()
   
   public init(verbosity level: SSHLogLevel, logger: SSHLogPublisher?) {
     self.verbosity = level
     self.logger = logger
   }
   
-  public func message(_ message: String, _ level: SSHLogLevel) {
-    self.message(message, Int32(level.rawValue))
+  // Messages are built only when the level is enabled.
+  public func message(_ message: @autoclosure () -> String, _ level: SSHLogLevel) {
+    self.message(message(), Int32(level.rawValue))
   }
   
-  func message(_ message: String, _ level: Int32) {
+  func message(_ message: @autoclosure () -> String, _ level: Int32) {
     if verbosity.rawValue >= level {
+      let message = message()
       print(message)
       logger?.send(message)
     }
   }
+  
+  // Record a hot path event on the trace ring at debug level, where it costs a fixed
+  // size write. Below it, the event costs the level check only. The event is also
+  // logged when its own level is enabled.
+  func trace(_ event: SSHTraceEvent, _ a: Int = 0, _ b: Int = 0, level: Int32 = SSH_LOG_DEBUG) {
+    guard verbosity.rawValue >= SSH_LOG_DEBUG else {
+      return
+    }
+    traceRing.record(event, Int64(a), Int64(b))
+    if verbosity.rawValue >= level {
+      self.message(event.message(Int64(a), Int64(b)), level)
+    }
+  }
+  
+  // Formatted trace, oldest record first. Call it from the session RunLoop.
+  public func dumpTrace() -> [String] {
+    traceRing.dump()
+  }
+  
+  // Send the trace to the log, ie after an error, so the events that led to it are visible.
+  // There is only a trace to send at debug level.
+  func logTrace(_ reason: String) {
+    guard verbosity.rawValue >= SSHLogLevel.debug.rawValue else {
+      return
+    }
+    let trace = ["\(reason). Trace:"] + dumpTrace()
+    self.message(trace.joined(separator: "\n"), SSH_LOG_WARN)
+  }
 }
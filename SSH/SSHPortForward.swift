@@ -67,6 +67,8 @@ public class SSHPortForwardListener {
   var status = CurrentValueSubject<PortForwardState, Error>(.starting)
   
   var connections: [NWConnection] = []
+  public var openConnections: Int { connections.count }
+  public private(set) var totalConnections = 0
   
   public init(on localPort: UInt16, toDestination host: String, on remotePort: UInt16, using client: SSHClient) {
     self.client = client
@@ -215,6 +217,7 @@ public class SSHPortForwardListener {
     }
     
     connections.append(conn)
+    totalConnections += 1
     conn.start(queue: self.queue)
   }
   
@@ -256,6 +259,8 @@ public class SSHPortForwardClient {
   
   var reverseForward: AnyCancellable?
   var streams: [Stream] = []
+  public var openConnections: Int { streams.count }
+  public private(set) var totalConnections = 0
   
   public init(forward address: String, onPort localPort: UInt16,
               toRemotePort remotePort: UInt16, bindAddress: String? = nil, using client: SSHClient) {
@@ -326,6 +331,7 @@ public class SSHPortForwardClient {
     self.log.message("Reverse stream received. Establishing connection and piping stream", SSH_LOG_INFO)
 
     self.streams.append(stream)
+    totalConnections += 1
     let conn = NWConnection(host: self.forwardHost, port: self.localPort, using: .tcp)
     conn.stateUpdateHandler = { [weak self] (state: NWConnection.State) in
       guard let self = self else {
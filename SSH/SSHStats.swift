@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2021 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+
+// Live counters for a connection, to diagnose slow sessions.
+// They are updated from the session RunLoop. Readers on other threads
+// may get slightly stale values, which is fine for reporting.
+public final class SSHClientStats {
+  // Channel reads and writes, across all the streams on the connection.
+  public private(set) var bytesRead = 0
+  public private(set) var bytesWritten = 0
+  public private(set) var reads = 0
+  public private(set) var writes = 0
+  public private(set) var maxReadSize = 0
+  public private(set) var maxWriteSize = 0
+  // Writes waiting for the remote side to open the channel window.
+  public private(set) var windowStalls = 0
+  // Data available on the channel while there was no demand to read it.
+  public private(set) var readStalls = 0
+  
+  // SFTP requests in flight and their round-trip time.
+  public private(set) var sftpInflight = 0
+  public private(set) var sftpMaxInflight = 0
+  public private(set) var sftpResponses = 0
+  private var sftpRTTTotal: UInt64 = 0
+  public private(set) var sftpMaxRTT: UInt64 = 0
+  
+  // Throughput on one second windows of sustained transfer, and the share of
+  // the session thread CPU time spent on them. Compression and ciphers run on
+  // that same thread.
+  public private(set) var bulkWindows = 0
+  public private(set) var peakThroughput: Double = 0
+  private var bulkCPUTotal: Double = 0
+  private var windowStart: UInt64 = 0
+  private var windowCPUStart: UInt64 = 0
+  private var windowBytes = 0
+  static let windowLength: UInt64 = 1_000_000_000
+  static let bulkWindowBytes = 256 * 1024
+  
+  public var sftpAverageRTT: Double {
+    sftpResponses == 0 ? 0 : Double(sftpRTTTotal) / Double(sftpResponses) / 1_000_000
+  }
+  
+  public var bulkCPUUsage: Double {
+    bulkWindows == 0 ? 0 : bulkCPUTotal / Double(bulkWindows)
+  }
+  
+  func read(_ size: Int) {
+    reads += 1
+    bytesRead += size
+    maxReadSize = max(maxReadSize, size)
+    sample(size)
+  }
+  
+  func wrote(_ size: Int) {
+    writes += 1
+    bytesWritten += size
+    maxWriteSize = max(maxWriteSize, size)
+    sample(size)
+  }
+  
+  private func sample(_ size: Int) {
+    let now = DispatchTime.now().uptimeNanoseconds
+    windowBytes += size
+    
+    let elapsed = now - windowStart
+    guard elapsed >= SSHClientStats.windowLength else {
+      return
+    }
+    // Windows that spanned idle time do not tell about the link.
+    if elapsed < 2 * SSHClientStats.windowLength && windowBytes >= SSHClientStats.bulkWindowBytes {
+      let cpu = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID) - windowCPUStart
+      bulkWindows += 1
+      bulkCPUTotal += Double(cpu) / Double(elapsed)
+      peakThroughput = max(peakThroughput, Double(windowBytes) * 1_000_000_000 / Double(elapsed))
+    }
+    
+    windowStart = now
+    windowCPUStart = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID)
+    windowBytes = 0
+  }
+  
+  func windowStalled() {
+    windowStalls += 1
+  }
+  
+  func readStalled() {
+    readStalls += 1
+  }
+  
+  func sftpInflight(_ count: Int) {
+    sftpInflight = count
+    sftpMaxInflight = max(sftpMaxInflight, count)
+  }
+  
+  // Record the response to an SFTP request issued at the given uptime in ns.
+  func sftpResponse(since start: UInt64) {
+    let rtt = DispatchTime.now().uptimeNanoseconds - start
+    sftpResponses += 1
+    sftpRTTTotal += rtt
+    sftpMaxRTT = max(sftpMaxRTT, rtt)
+  }
+  
+  public var snapshot: [String: Any] {
+    [
+      "bytesRead": bytesRead,
+      "bytesWritten": bytesWritten,
+      "reads": reads,
+      "writes": writes,
+      "maxReadSize": maxReadSize,
+      "maxWriteSize": maxWriteSize,
+      "windowStalls": windowStalls,
+      "readStalls": readStalls,
+      "sftpInflight": sftpInflight,
+      "sftpMaxInflight": sftpMaxInflight,
+      "sftpResponses": sftpResponses,
+      "sftpAverageRTTms": sftpAverageRTT,
+      "sftpMaxRTTms": Double(sftpMaxRTT) / 1_000_000,
+      "bulkWindows": bulkWindows,
+      "peakThroughput": peakThroughput,
+      "bulkCPUUsage": bulkCPUUsage
+    ]
+  }
+}
@@ -0,0 +1,132 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// B L I N K
+//
+// Copyright (C) 2016-2021 Blink Mobile Shell Project
+//
+// This file is part of Blink.
+//
+// Blink is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Blink is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Blink. If not, see <http://www.gnu.org/licenses/>.
+//
+// In addition, Blink is also subject to certain additional terms under
+// GNU GPL version 3 section 7.
+//
+// You should have received a copy of these additional terms immediately
+// following the terms and conditions of the GNU General Public License
+// which accompanied the Blink Source Code. If not, see
+// <http://www.github.com/blinksh/blink>.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Foundation
+
+// Hot path events in the SSH stack. They carry up to two integer arguments,
+// and the message is only formatted when the trace is dumped.
+enum SSHTraceEvent: UInt16 {
+  case channelRead = 1
+  case channelEOF
+  case channelData
+  case channelReadStalled
+  case channelBytesRead
+  case channelWindowDepleted
+  case channelWrite
+  case streamStdout
+  case streamStdin
+  case streamStderr
+  case sftpWriting
+  case sftpReadsScheduled
+  case sftpBlockRead
+  case sftpBlockAgain
+  case sftpBlocksRead
+  case sftpWritesScheduled
+  case sftpWriteEnd
+  case sftpWriteAgain
+
+  func message(_ a: Int64, _ b: Int64) -> String {
+    switch self {
+    case .channelRead:           return "Read \(a) async from channel"
+    case .channelEOF:            return "Received EOF on Channel"
+    case .channelData:           return "Reading from channel \(a) out of \(b)"
+    case .channelReadStalled:    return "New reading window \(a)"
+    case .channelBytesRead:      return "Bytes Read \(a)"
+    case .channelWindowDepleted: return "Window depleted"
+    case .channelWrite:          return "Trying to write \(a) with window \(b)"
+    case .streamStdout:          return "Connect \(a) bytes from stdout \(b)"
+    case .streamStdin:           return "Connect \(a) bytes from stdin \(b)"
+    case .streamStderr:          return "Connect \(a) bytes from stderr \(b)"
+    case .sftpWriting:           return "WRITING \(a)"
+    case .sftpReadsScheduled:    return "Scheduled reads \(a)"
+    case .sftpBlockRead:         return "Reading \(a)"
+    case .sftpBlockAgain:        return "readBlock AGAIN"
+    case .sftpBlocksRead:        return "Blocks read \(a), size \(b)"
+    case .sftpWritesScheduled:   return "Scheduled writes \(a)"
+    case .sftpWriteEnd:          return "sftp_async_write_end \(a)"
+    case .sftpWriteAgain:        return "Write AGAIN"
+    }
+  }
+}
+
+// Fixed size binary records on a ring, overwriting the oldest ones.
+// The session records only from its RunLoop, so there is a single writer
+// and recording does not need to lock.
+final class SSHTraceRing {
+  struct Record {
+    var time: UInt64
+    var event: UInt16
+    var a: Int64
+    var b: Int64
+  }
+  
+  let capacity: Int
+  private let records: UnsafeMutablePointer<Record>
+  // Total records written. The next one goes to count % capacity.
+  private var count = 0
+  
+  init(capacity: Int = 4096) {
+    self.capacity = capacity
+    self.records = .allocate(capacity: capacity)
+    self.records.initialize(repeating: Record(time: 0, event: 0, a: 0, b: 0), count: capacity)
+  }
+  
+  deinit {
+    records.deallocate()
+  }
+  
+  @inline(__always)
+  func record(_ event: SSHTraceEvent, _ a: Int64, _ b: Int64) {
+    records[count % capacity] = Record(time: DispatchTime.now().uptimeNanoseconds,
+                                       event: event.rawValue,
+                                       a: a, b: b)
+    count &+= 1
+  }
+  
+  // Format the records from oldest to newest, with the time in ms since the oldest.
+  func dump() -> [String] {
+    let available = min(count, capacity)
+    guard available > 0 else {
+      return []
+    }
+    let first = count - available
+    let start = records[first % capacity].time
+    
+    return (first..<count).compactMap { idx in
+      let r = records[idx % capacity]
+      guard let event = SSHTraceEvent(rawValue: r.event) else {
+        return nil
+      }
+      let elapsed = Double(r.time - start) / 1_000_000
+      return String(format: "%10.3f ", elapsed) + event.message(r.a, r.b)
+    }
+  }
+}
@@ -102,7 +102,7 @@ public class Stream : Reader, Writer, WriterTo {
           }
         }, receiveValue: { written in
           self.stdoutBytes += written
-          self.log.message("Connect \(written) bytes from stdout \(self.stdoutBytes)", SSH_LOG_DEBUG)
+          self.log.trace(.streamStdout, written, self.stdoutBytes)
         })
     
     stdinCancellable = input?.writeTo(instream)
@@ -128,7 +128,7 @@ public class Stream : Reader, Writer, WriterTo {
           }
         }, receiveValue: { written in
           self.stdinBytes += written
-          self.log.message("Connect \(written) bytes from stdin \(self.stdoutBytes)", SSH_LOG_DEBUG)
+          self.log.trace(.streamStdin, written, self.stdinBytes)
         })
     
     if let err = err {
@@ -151,7 +151,7 @@ public class Stream : Reader, Writer, WriterTo {
             }
           }, receiveValue: { written in
             self.stderrBytes += written
-            self.log.message("Connect \(written) bytes from stderr \(self.stderrBytes)", SSH_LOG_DEBUG)
+            self.log.trace(.streamStderr, written, self.stderrBytes)
           })
     }
   }
@@ -176,6 +176,12 @@ public class Stream : Reader, Writer, WriterTo {
     return outstream.writeTo(w)
   }
   
+  // Data from stdout as soon as it is received, until the channel reaches EOF.
+  func readChunks() -> AnyPublisher<DispatchData, Error> {
+    let outstream = OutStream(self)
+    return OutStream.Reading(stream: outstream, length: SSIZE_MAX).publisher
+  }
+  
   public func sendEOF() -> AnyPublisher<Void, Error> {
     return AnyPublisher
       .just(channel)
@@ -282,6 +288,7 @@ extension OutStream: Reader {
     var session: ssh_session { parent.session }
     
     var log: SSHLogger { get { parent.log }}
+    var stats: SSHClientStats { parent.stream.client.stats }
     
     var demand: Subscribers.Demand = .none
     let pb = PassthroughSubject<DispatchData, Error>()
@@ -321,9 +328,9 @@ extension OutStream: Reader {
       let buf = UnsafeMutableRawBufferPointer.allocate(byteCount: Int(size), alignment: MemoryLayout<CUnsignedChar>.alignment)
       
       let rc = ssh_channel_read_nonblocking(self.channel, buf.baseAddress, size, parent.isStderr)
-      log.message("Read \(rc) async from \(channel)", SSH_LOG_DEBUG)
+      log.trace(.channelRead, Int(rc))
       if rc == SSH_EOF || (rc == 0 && ssh_channel_is_eof(channel) != 0) {
-        log.message("Received EOF on Channel", SSH_LOG_DEBUG)
+        log.trace(.channelEOF)
         buf.deallocate()
         complete()
         return
@@ -332,6 +339,7 @@ extension OutStream: Reader {
         buf.deallocate()
       } else if rc < 0 {
         buf.deallocate()
+        log.logTrace("Error while reading")
         pb.send(completion: .failure(SSHError(title: "Error while reading", forSession: self.session)))
         return
       } else if rc > 0 {
@@ -396,20 +404,20 @@ extension OutStream: Reader {
         return 0
       }
       
-      ctxt.log.message("Data callback", SSH_LOG_DEBUG)
       if length == 0 {
         return 0
       }
       
       if ctxt.demand == .none {
-        ctxt.log.message("New reading window \(length)", SSH_LOG_DEBUG)
+        ctxt.log.trace(.channelReadStalled, Int(length))
+        ctxt.stats.readStalled()
         return 0
       }
       // Fix interface on Swift
       let buf = buf!
       
       let count = min(Int(length), ctxt.bytesLeft)
-      ctxt.log.message("Reading from channel \(count) out of \(length)", SSH_LOG_DEBUG)
+      ctxt.log.trace(.channelData, count, Int(length))
       
       let ptBuf = UnsafeRawBufferPointer(start: buf, count: count)
       let data = DispatchData(bytes: ptBuf)
@@ -441,7 +449,8 @@ extension OutStream: Reader {
       pb.send(data)
             
       bytesRead += data.count
-      log.message("Bytes Read \(bytesRead)", SSH_LOG_DEBUG)
+      stats.read(data.count)
+      log.trace(.channelBytesRead, bytesRead)
       
       if bytesLeft != SSIZE_MAX {
         bytesLeft -= data.count
@@ -517,23 +526,26 @@ extension InStream: Writer {
       
       let window = ssh_channel_window_size(self.channel)
       if window == 0 {
-        self.log.message("Window depleted", SSH_LOG_DEBUG)
+        self.log.trace(.channelWindowDepleted)
+        self.client.stats.windowStalled()
         self.rloop.perform { write(data) }
         return
       }
       
       let size: UInt32 = min(UInt32(data.count), window)
       
-      self.log.message("Trying to write \(size) with window \(window)", SSH_LOG_DEBUG)
+      self.log.trace(.channelWrite, Int(size), Int(window))
       let rc = data.withUnsafeBytes { bytes -> Int32 in
         return ssh_channel_write(self.channel, bytes, size)
       }
       
       if rc < 0 {
+        self.log.logTrace("Error while writing")
         pb.send(completion: .failure(SSHError(rc, forSession: self.session)))
         return
       }
       
+      self.client.stats.wrote(Int(rc))
       pb.send(Int(rc))
       let nextData = data.subdata(in: Int(rc)..<data.count)
       